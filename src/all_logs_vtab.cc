@@ -0,0 +1,324 @@
+/**
+ * Copyright (c) 2019, Timothy Stack
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * * Neither the name of Timothy Stack nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+
+#include <future>
+#include <thread>
+
+#include "all_logs_vtab.hh"
+
+using namespace std;
+
+const size_t all_logs_vtab::PARSE_AHEAD_LINES;
+const size_t all_logs_vtab::PARSE_AHEAD_INITIAL_LINES;
+const uint64_t all_logs_vtab::SEQUENTIAL_GAP;
+const size_t all_logs_vtab::PARSE_AHEAD_MIN_SLICE;
+
+static line_range find_body(log_format *format,
+                            uint64_t line_number,
+                            shared_buffer_ref &line)
+{
+    std::vector<logline_value> sub_values;
+    struct line_range retval;
+    string_attrs_t sa;
+
+    format->annotate(line_number, line, sa, sub_values, false);
+
+    retval = find_string_attr_range(sa, &textview_curses::SA_BODY);
+    if (retval.lr_start == -1) {
+        retval.lr_start = 0;
+        retval.lr_end = line.length();
+    }
+
+    return retval;
+}
+
+/**
+ * Parse the body of a message to discover its format and schema.  This
+ * function only touches its arguments, so it can be called from other
+ * threads.
+ */
+static void parse_msg_format(const string &text,
+                             const line_range &body,
+                             string &format_out,
+                             data_parser::schema_id_t &schema_out)
+{
+    data_scanner ds(text, body.lr_start, body.lr_end);
+    data_parser dp(&ds);
+
+    dp.dp_msg_format = &format_out;
+    dp.parse();
+    schema_out = dp.dp_schema_id;
+}
+
+void all_logs_vtab::extract(std::shared_ptr<logfile> lf,
+                            uint64_t line_number,
+                            shared_buffer_ref &line,
+                            std::vector<logline_value> &values)
+{
+    log_format *format = lf->get_format();
+    values.emplace_back(this->alv_value_name, format->get_name(), 0);
+
+    file_entry &fe = this->get_file_entry(lf);
+    off_t offset = (lf->begin() + line_number)->get_offset();
+    uint32_t hash = hash_message(line);
+    const msg_info *mi = this->find_info(fe, line_number, offset, hash);
+    bool sequential = this->is_sequential(lf, fe, line_number);
+
+    fe.fe_last_line = line_number;
+    if (!sequential) {
+        // A lookup of a single line, or a query that skips around, does not
+        // benefit from parsing the lines that follow.
+        fe.fe_parse_ahead = 0;
+    }
+
+    if (mi == nullptr) {
+        msg_info info;
+        string text(line.get_data(), line.length());
+
+        parse_msg_format(text,
+                         find_body(format, line_number, line),
+                         info.mi_format,
+                         info.mi_schema);
+        this->store_info(fe, line_number, offset, hash, info);
+        if (sequential) {
+            fe.fe_parse_ahead = min(PARSE_AHEAD_LINES,
+                                    max(PARSE_AHEAD_INITIAL_LINES,
+                                        fe.fe_parse_ahead * 2));
+            this->parse_ahead(lf, fe, line_number + 1, fe.fe_parse_ahead);
+        }
+        mi = this->find_info(fe, line_number, offset, hash);
+    }
+
+    tmp_shared_buffer tsb(mi->mi_format.c_str());
+
+    values.emplace_back(this->alv_msg_name, tsb.tsb_ref, 1);
+
+    this->alv_schema_manager.invalidate_refs();
+    mi->mi_schema.to_string(this->alv_schema_buffer);
+    shared_buffer_ref schema_ref;
+    schema_ref.share(this->alv_schema_manager,
+                     this->alv_schema_buffer,
+                     data_parser::schema_id_t::STRING_SIZE - 1);
+    values.emplace_back(this->alv_schema_name, schema_ref, 2);
+}
+
+all_logs_vtab::file_entry &
+all_logs_vtab::get_file_entry(const std::shared_ptr<logfile> &lf)
+{
+    auto iter = this->alv_files.find(lf.get());
+
+    if (iter != this->alv_files.end()) {
+        if (!iter->second.fe_file.expired()) {
+            return iter->second;
+        }
+        this->alv_files.erase(iter);
+    }
+
+    // Drop the entries for any files that have been closed, the address of
+    // a closed file can be reused by a new one.
+    for (auto file_iter = this->alv_files.begin();
+         file_iter != this->alv_files.end();) {
+        if (file_iter->second.fe_file.expired()) {
+            file_iter = this->alv_files.erase(file_iter);
+        } else {
+            ++file_iter;
+        }
+    }
+    if (this->alv_files.empty()) {
+        this->alv_infos.clear();
+        this->alv_info_ids.clear();
+    }
+
+    file_entry &retval = this->alv_files[lf.get()];
+
+    retval.fe_file = lf;
+
+    return retval;
+}
+
+uint32_t all_logs_vtab::hash_message(const shared_buffer_ref &sbr)
+{
+    return hash_str(sbr.get_data(), sbr.length());
+}
+
+/**
+ * Check if a line is read soon after the last line that was read from the
+ * same file, which is what a scan of the whole table looks like.
+ */
+bool all_logs_vtab::is_sequential(const std::shared_ptr<logfile> &lf,
+                                  const file_entry &fe,
+                                  uint64_t line_number) const
+{
+    if (fe.fe_last_line == -1 || (int64_t) line_number <= fe.fe_last_line) {
+        return false;
+    }
+
+    uint64_t messages = 0;
+
+    for (uint64_t curr = fe.fe_last_line + 1; curr <= line_number; curr++) {
+        if (!(lf->begin() + curr)->is_continued()) {
+            messages += 1;
+            if (messages > SEQUENTIAL_GAP) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+const all_logs_vtab::msg_info *
+all_logs_vtab::find_info(file_entry &fe,
+                         uint64_t line_number,
+                         off_t offset,
+                         uint32_t hash) const
+{
+    if (line_number >= fe.fe_lines.size()) {
+        return nullptr;
+    }
+
+    const line_entry &le = fe.fe_lines[line_number];
+
+    if (le.le_offset != offset || le.le_hash != hash) {
+        return nullptr;
+    }
+
+    return &this->alv_infos[le.le_info];
+}
+
+void all_logs_vtab::store_info(file_entry &fe,
+                               uint64_t line_number,
+                               off_t offset,
+                               uint32_t hash,
+                               const msg_info &mi)
+{
+    string key = mi.mi_format;
+
+    key.append((const char *) mi.mi_schema.in(), mi.mi_schema.BYTE_COUNT);
+
+    auto id_iter = this->alv_info_ids.find(key);
+    uint32_t info_id;
+
+    if (id_iter == this->alv_info_ids.end()) {
+        info_id = this->alv_infos.size();
+        this->alv_infos.push_back(mi);
+        this->alv_info_ids[key] = info_id;
+    } else {
+        info_id = id_iter->second;
+    }
+
+    if (line_number >= fe.fe_lines.size()) {
+        fe.fe_lines.resize(line_number + 1);
+    }
+    fe.fe_lines[line_number].le_offset = offset;
+    fe.fe_lines[line_number].le_info = info_id;
+    fe.fe_lines[line_number].le_hash = hash;
+}
+
+/**
+ * Fill the cache for the lines that follow a miss when the file is being
+ * read sequentially, since the query will probably go on to read them.
+ * Reading the lines has to be done here, but the parsing is spread across
+ * threads.
+ */
+void all_logs_vtab::parse_ahead(const std::shared_ptr<logfile> &lf,
+                                file_entry &fe,
+                                uint64_t line_number,
+                                size_t count)
+{
+    log_format *format = lf->get_format();
+    uint64_t end_line = min((uint64_t) lf->size(), line_number + count);
+    vector<pending_line> pending;
+    shared_buffer_ref sbr;
+
+    for (uint64_t curr = line_number; curr < end_line; curr++) {
+        auto ll = lf->begin() + curr;
+
+        if (ll->is_continued()) {
+            continue;
+        }
+
+        lf->read_full_message(ll, sbr);
+
+        uint32_t hash = hash_message(sbr);
+
+        if (this->find_info(fe, curr, ll->get_offset(), hash) != nullptr) {
+            continue;
+        }
+
+        pending_line pl;
+
+        pl.pl_line_number = curr;
+        pl.pl_offset = ll->get_offset();
+        pl.pl_hash = hash;
+        pl.pl_body = find_body(format, curr, sbr);
+        pl.pl_text.assign(sbr.get_data(), sbr.length());
+        pending.push_back(std::move(pl));
+    }
+
+    auto parse_slice = [&pending](size_t start, size_t end) {
+        for (size_t lpc = start; lpc < end; lpc++) {
+            pending_line &pl = pending[lpc];
+
+            parse_msg_format(pl.pl_text,
+                             pl.pl_body,
+                             pl.pl_info.mi_format,
+                             pl.pl_info.mi_schema);
+        }
+    };
+    size_t thread_count = max(1U, thread::hardware_concurrency());
+    size_t slice_size = max(PARSE_AHEAD_MIN_SLICE,
+                            (pending.size() + thread_count - 1) / thread_count);
+
+    if (pending.size() <= slice_size) {
+        // Starting a thread costs more than parsing a single slice.
+        parse_slice(0, pending.size());
+    } else {
+        vector<future<void>> workers;
+
+        for (size_t start = 0; start < pending.size(); start += slice_size) {
+            size_t end = min(pending.size(), start + slice_size);
+
+            workers.push_back(async(launch::async, parse_slice, start, end));
+        }
+        for (auto &worker : workers) {
+            worker.get();
+        }
+    }
+
+    for (const auto &pl : pending) {
+        this->store_info(fe,
+                         pl.pl_line_number,
+                         pl.pl_offset,
+                         pl.pl_hash,
+                         pl.pl_info);
+    }
+}
@@ -30,6 +30,10 @@
 #ifndef LNAV_ALL_LOGS_VTAB_HH
 #define LNAV_ALL_LOGS_VTAB_HH
 
+#include <string>
+#include <unordered_map>
+#include <vector>
+
 #include "log_vtab_impl.hh"
 #include "data_parser.hh"
 
@@ -48,44 +52,15 @@ public:
         cols.emplace_back(this->alv_schema_name.get(), SQLITE3_TEXT, nullptr, true);
     };
 
+    /**
+     * The message format and schema are cached for each line since parsing
+     * the message is expensive and the same lines are usually queried over
+     * and over again.
+     */
     void extract(std::shared_ptr<logfile> lf,
                  uint64_t line_number,
                  shared_buffer_ref &line,
-                 std::vector<logline_value> &values) {
-        log_format *format = lf->get_format();
-        values.emplace_back(this->alv_value_name, format->get_name(), 0);
-
-        std::vector<logline_value> sub_values;
-        struct line_range body;
-        string_attrs_t sa;
-
-        format->annotate(line_number, line, sa, sub_values, false);
-
-        body = find_string_attr_range(sa, &textview_curses::SA_BODY);
-        if (body.lr_start == -1) {
-            body.lr_start = 0;
-            body.lr_end = line.length();
-        }
-
-        data_scanner ds(line, body.lr_start, body.lr_end);
-        data_parser dp(&ds);
-
-        std::string str;
-        dp.dp_msg_format = &str;
-        dp.parse();
-
-        tmp_shared_buffer tsb(str.c_str());
-
-        values.emplace_back(this->alv_msg_name, tsb.tsb_ref, 1);
-
-        this->alv_schema_manager.invalidate_refs();
-        dp.dp_schema_id.to_string(this->alv_schema_buffer);
-        shared_buffer_ref schema_ref;
-        schema_ref.share(this->alv_schema_manager,
-                         this->alv_schema_buffer,
-                         data_parser::schema_id_t::STRING_SIZE - 1);
-        values.emplace_back(this->alv_schema_name, schema_ref, 2);
-    }
+                 std::vector<logline_value> &values);
 
     bool is_valid(log_cursor &lc, logfile_sub_source &lss) {
         content_line_t    cl(lss.at(lc.lc_curr_line));
@@ -119,11 +94,91 @@ public:
     };
 
 private:
+    /**
+     * The most lines that are parsed ahead when there is a miss in the
+     * message format cache.  Lines are only parsed ahead once a file is
+     * being read sequentially.  The amount starts at
+     * PARSE_AHEAD_INITIAL_LINES and doubles on each miss after that.
+     */
+    static const size_t PARSE_AHEAD_LINES = 16 * 1024;
+    static const size_t PARSE_AHEAD_INITIAL_LINES = 64;
+    /**
+     * The most messages between two lines read from a file that still
+     * counts as sequential access.  The gap is counted in messages since
+     * the cursor skips over the continued lines of a message.
+     */
+    static const uint64_t SEQUENTIAL_GAP = 8;
+    /** The minimum number of lines to hand to a parsing thread. */
+    static const size_t PARSE_AHEAD_MIN_SLICE = 512;
+
+    /** A message format and schema that is shared by many lines. */
+    struct msg_info {
+        std::string mi_format;
+        data_parser::schema_id_t mi_schema;
+    };
+
+    struct line_entry {
+        /** The offset of the line, to detect if the file was reindexed. */
+        off_t le_offset{-1};
+        uint32_t le_info{0};
+        /**
+         * A hash of the message text, to detect a message that changed at
+         * the same offset, like a partial line that was finished or a
+         * message that got more continued lines.
+         */
+        uint32_t le_hash{0};
+    };
+
+    struct file_entry {
+        std::weak_ptr<logfile> fe_file;
+        std::vector<line_entry> fe_lines;
+        /** The last line extracted from the file or -1. */
+        int64_t fe_last_line{-1};
+        /** The number of lines parsed ahead on the last miss. */
+        size_t fe_parse_ahead{0};
+    };
+
+    struct pending_line {
+        uint64_t pl_line_number;
+        off_t pl_offset;
+        uint32_t pl_hash;
+        std::string pl_text;
+        struct line_range pl_body;
+        msg_info pl_info;
+    };
+
+    file_entry &get_file_entry(const std::shared_ptr<logfile> &lf);
+
+    static uint32_t hash_message(const shared_buffer_ref &sbr);
+
+    bool is_sequential(const std::shared_ptr<logfile> &lf,
+                       const file_entry &fe,
+                       uint64_t line_number) const;
+
+    const msg_info *find_info(file_entry &fe,
+                              uint64_t line_number,
+                              off_t offset,
+                              uint32_t hash) const;
+
+    void store_info(file_entry &fe,
+                    uint64_t line_number,
+                    off_t offset,
+                    uint32_t hash,
+                    const msg_info &mi);
+
+    void parse_ahead(const std::shared_ptr<logfile> &lf,
+                     file_entry &fe,
+                     uint64_t line_number,
+                     size_t count);
+
     intern_string_t alv_value_name;
     intern_string_t alv_msg_name;
     intern_string_t alv_schema_name;
     shared_buffer alv_schema_manager;
     char alv_schema_buffer[data_parser::schema_id_t::STRING_SIZE];
+    std::unordered_map<const logfile *, file_entry> alv_files;
+    std::vector<msg_info> alv_infos;
+    std::unordered_map<std::string, uint32_t> alv_info_ids;
 };
 
 #endif //LNAV_ALL_LOGS_VTAB_HH
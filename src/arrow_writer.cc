@@ -0,0 +1,663 @@
+/**
+ * Copyright (c) 2019, Timothy Stack
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * * Neither the name of Timothy Stack nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+#include "arrow_writer.hh"
+
+using namespace std;
+
+namespace {
+
+/** The metadata version for the Arrow 1.0 format. */
+const int16_t METADATA_V5 = 4;
+
+enum {
+    MESSAGE_HEADER_SCHEMA = 1,
+    MESSAGE_HEADER_DICTIONARY_BATCH = 2,
+    MESSAGE_HEADER_RECORD_BATCH = 3,
+};
+
+enum {
+    TYPE_INT = 2,
+    TYPE_FLOATING_POINT = 3,
+    TYPE_UTF8 = 5,
+    TYPE_TIMESTAMP = 10,
+};
+
+const int16_t PRECISION_DOUBLE = 2;
+const int16_t TIME_UNIT_MICROSECOND = 2;
+
+const char ARROW_MAGIC[] = "ARROW1\0";
+
+void put_le(string &buf, uint64_t value, size_t size)
+{
+    for (size_t lpc = 0; lpc < size; lpc++) {
+        buf.push_back((char) ((value >> (lpc * 8)) & 0xff));
+    }
+}
+
+void pad_to(string &buf, size_t align, size_t extra = 0)
+{
+    while ((buf.size() + extra) % align) {
+        buf.push_back('\0');
+    }
+}
+
+/**
+ * A minimal flatbuffers encoder that is just enough for the Arrow metadata.
+ * Objects are written front-to-back: a table is written first and the
+ * objects it refers to are written after it, with the offsets to them
+ * patched in once their positions are known.
+ */
+class fb_builder {
+public:
+    typedef function<size_t(fb_builder &)> child_func_t;
+
+    struct field {
+        static field scalar(int id, size_t size, uint64_t value) {
+            field retval;
+
+            retval.f_id = id;
+            retval.f_size = size;
+            retval.f_value = value;
+            return retval;
+        };
+
+        static field offset(int id, child_func_t child) {
+            field retval;
+
+            retval.f_id = id;
+            retval.f_size = 4;
+            retval.f_child = std::move(child);
+            return retval;
+        };
+
+        int f_id{0};
+        size_t f_size{0};
+        uint64_t f_value{0};
+        child_func_t f_child;
+        size_t f_offset{0};
+    };
+
+    fb_builder() {
+        // Placeholder for the offset to the root table.
+        put_le(this->fb_buf, 0, 4);
+    };
+
+    size_t pos() const {
+        return this->fb_buf.size();
+    };
+
+    void patch_offset(size_t at, size_t target) {
+        uint32_t value = target - at;
+
+        for (size_t lpc = 0; lpc < 4; lpc++) {
+            this->fb_buf[at + lpc] = (char) ((value >> (lpc * 8)) & 0xff);
+        }
+    };
+
+    size_t table(vector<field> fields) {
+        vector<field *> layout;
+        int max_id = -1;
+        size_t table_align = 4;
+        size_t inline_size = 4;
+
+        for (auto &fd : fields) {
+            max_id = max(max_id, fd.f_id);
+            table_align = max(table_align, fd.f_size);
+            layout.push_back(&fd);
+        }
+        // Place the largest fields first to minimize the padding.
+        stable_sort(layout.begin(), layout.end(), [](field *lhs, field *rhs) {
+            return lhs->f_size > rhs->f_size;
+        });
+        for (auto fd : layout) {
+            inline_size = (inline_size + fd->f_size - 1) / fd->f_size *
+                          fd->f_size;
+            fd->f_offset = inline_size;
+            inline_size += fd->f_size;
+        }
+        inline_size = (inline_size + table_align - 1) / table_align *
+                      table_align;
+
+        vector<uint16_t> vtable(max_id + 1, 0);
+
+        for (auto fd : layout) {
+            vtable[fd->f_id] = fd->f_offset;
+        }
+
+        pad_to(this->fb_buf, 2);
+
+        size_t vtable_pos = this->pos();
+
+        put_le(this->fb_buf, 4 + 2 * vtable.size(), 2);
+        put_le(this->fb_buf, inline_size, 2);
+        for (auto off : vtable) {
+            put_le(this->fb_buf, off, 2);
+        }
+
+        pad_to(this->fb_buf, table_align);
+
+        size_t table_pos = this->pos();
+
+        put_le(this->fb_buf, table_pos - vtable_pos, 4);
+        for (auto fd : layout) {
+            while (this->pos() < table_pos + fd->f_offset) {
+                this->fb_buf.push_back('\0');
+            }
+            put_le(this->fb_buf, fd->f_value, fd->f_size);
+        }
+
+        for (auto fd : layout) {
+            if (fd->f_child) {
+                size_t child_pos = fd->f_child(*this);
+
+                this->patch_offset(table_pos + fd->f_offset, child_pos);
+            }
+        }
+
+        return table_pos;
+    };
+
+    size_t string(const std::string &str) {
+        pad_to(this->fb_buf, 4);
+
+        size_t retval = this->pos();
+
+        put_le(this->fb_buf, str.size(), 4);
+        this->fb_buf.append(str);
+        this->fb_buf.push_back('\0');
+
+        return retval;
+    };
+
+    size_t table_vector(const vector<child_func_t> &elems) {
+        pad_to(this->fb_buf, 4);
+
+        size_t retval = this->pos();
+
+        put_le(this->fb_buf, elems.size(), 4);
+        for (size_t lpc = 0; lpc < elems.size(); lpc++) {
+            put_le(this->fb_buf, 0, 4);
+        }
+        for (size_t lpc = 0; lpc < elems.size(); lpc++) {
+            size_t child_pos = elems[lpc](*this);
+
+            this->patch_offset(retval + 4 + lpc * 4, child_pos);
+        }
+
+        return retval;
+    };
+
+    /**
+     * Write a vector of structs that contain 64-bit members, the elements
+     * need to be 8-byte aligned so the length is placed just before that.
+     */
+    size_t struct_vector(const std::string &raw, size_t count) {
+        pad_to(this->fb_buf, 8, 4);
+
+        size_t retval = this->pos();
+
+        put_le(this->fb_buf, count, 4);
+        this->fb_buf.append(raw);
+
+        return retval;
+    };
+
+    std::string finish(const child_func_t &root) {
+        this->patch_offset(0, root(*this));
+        pad_to(this->fb_buf, 8);
+
+        return std::move(this->fb_buf);
+    };
+
+    std::string fb_buf;
+};
+
+typedef fb_builder::field fb_field;
+
+fb_builder::child_func_t int_type(int32_t bit_width)
+{
+    return [bit_width](fb_builder &fb) {
+        return fb.table({
+            fb_field::scalar(0, 4, bit_width),
+            fb_field::scalar(1, 1, 1),
+        });
+    };
+}
+
+}
+
+void arrow_writer::add_column(const std::string &name, column_type_t type)
+{
+    column col;
+
+    col.c_name = name;
+    col.c_type = type;
+    if (type == ACT_UTF8) {
+        put_le(col.c_offsets, 0, 4);
+    }
+    this->aw_columns.push_back(col);
+}
+
+void arrow_writer::set_valid(column &col, bool valid)
+{
+    size_t index = this->aw_batch_rows;
+
+    if (index % 8 == 0) {
+        col.c_validity.push_back('\0');
+    }
+    if (valid) {
+        col.c_validity[index / 8] |= (1 << (index % 8));
+    } else {
+        col.c_null_count += 1;
+    }
+}
+
+void arrow_writer::append_null(size_t col_index)
+{
+    column &col = this->aw_columns[col_index];
+
+    this->set_valid(col, false);
+    switch (col.c_type) {
+        case ACT_INT64:
+        case ACT_DOUBLE:
+        case ACT_TIMESTAMP:
+            put_le(col.c_data, 0, 8);
+            break;
+        case ACT_LEVEL:
+            put_le(col.c_data, 0, 4);
+            break;
+        case ACT_UTF8:
+            put_le(col.c_offsets, col.c_data.size(), 4);
+            break;
+    }
+}
+
+void arrow_writer::append_int64(size_t col_index, int64_t value)
+{
+    column &col = this->aw_columns[col_index];
+
+    this->set_valid(col, true);
+    put_le(col.c_data, value, 8);
+}
+
+void arrow_writer::append_double(size_t col_index, double value)
+{
+    column &col = this->aw_columns[col_index];
+    uint64_t bits;
+
+    memcpy(&bits, &value, sizeof(bits));
+    this->set_valid(col, true);
+    put_le(col.c_data, bits, 8);
+}
+
+void arrow_writer::append_string(size_t col_index, const char *str, size_t len)
+{
+    column &col = this->aw_columns[col_index];
+
+    this->set_valid(col, true);
+    col.c_data.append(str, len);
+    put_le(col.c_offsets, col.c_data.size(), 4);
+    this->aw_batch_bytes += len;
+}
+
+void arrow_writer::append_level(size_t col_index, log_level_t level)
+{
+    column &col = this->aw_columns[col_index];
+
+    this->set_valid(col, true);
+    put_le(col.c_data, level, 4);
+}
+
+void arrow_writer::end_row()
+{
+    if (!this->aw_started) {
+        this->start();
+    }
+
+    this->aw_batch_rows += 1;
+    this->aw_row_count += 1;
+    if (this->aw_batch_rows >= BATCH_ROWS ||
+        this->aw_batch_bytes >= BATCH_BYTES) {
+        this->flush_batch();
+    }
+}
+
+void arrow_writer::write_message(const std::string &header_metadata,
+                                 const std::string &body,
+                                 std::vector<block> *blocks)
+{
+    string prefix;
+
+    put_le(prefix, 0xffffffff, 4);
+    put_le(prefix, header_metadata.size(), 4);
+
+    if (blocks != nullptr) {
+        block blk;
+
+        blk.b_offset = this->aw_offset;
+        blk.b_metadata_length = prefix.size() + header_metadata.size();
+        blk.b_body_length = body.size();
+        blocks->push_back(blk);
+    }
+
+    this->aw_write(prefix.data(), prefix.size());
+    this->aw_write(header_metadata.data(), header_metadata.size());
+    this->aw_write(body.data(), body.size());
+    this->aw_offset += prefix.size() + header_metadata.size() + body.size();
+}
+
+static string message_metadata(uint8_t header_type,
+                               const fb_builder::child_func_t &header,
+                               int64_t body_length)
+{
+    fb_builder fb;
+
+    return fb.finish([&](fb_builder &fb) {
+        return fb.table({
+            fb_field::scalar(0, 2, METADATA_V5),
+            fb_field::scalar(1, 1, header_type),
+            fb_field::offset(2, header),
+            fb_field::scalar(3, 8, body_length),
+        });
+    });
+}
+
+/**
+ * @return A function that writes a RecordBatch table with the given
+ * FieldNode and Buffer structs.
+ */
+static fb_builder::child_func_t record_batch_header(int64_t length,
+                                                    const string &nodes,
+                                                    size_t node_count,
+                                                    const string &buffers,
+                                                    size_t buffer_count)
+{
+    return [=](fb_builder &fb) {
+        return fb.table({
+            fb_field::scalar(0, 8, length),
+            fb_field::offset(1, [=](fb_builder &fb) {
+                return fb.struct_vector(nodes, node_count);
+            }),
+            fb_field::offset(2, [=](fb_builder &fb) {
+                return fb.struct_vector(buffers, buffer_count);
+            }),
+        });
+    };
+}
+
+static void add_buffer(string &body, string &buffers, const string &data)
+{
+    put_le(buffers, body.size(), 8);
+    put_le(buffers, data.size(), 8);
+    body.append(data);
+    pad_to(body, 8);
+}
+
+typedef vector<pair<string, arrow_writer::column_type_t>> column_defs_t;
+
+static fb_builder::child_func_t schema_table(const column_defs_t &columns)
+{
+    vector<fb_builder::child_func_t> fields;
+
+    for (size_t col_index = 0;
+         col_index < columns.size();
+         col_index++) {
+        const auto &col = columns[col_index];
+        uint8_t type_type = TYPE_UTF8;
+        fb_builder::child_func_t type_func = [](fb_builder &fb) {
+            return fb.table({});
+        };
+
+        switch (col.second) {
+            case arrow_writer::ACT_INT64:
+                type_type = TYPE_INT;
+                type_func = int_type(64);
+                break;
+            case arrow_writer::ACT_DOUBLE:
+                type_type = TYPE_FLOATING_POINT;
+                type_func = [](fb_builder &fb) {
+                    return fb.table({
+                        fb_field::scalar(0, 2, PRECISION_DOUBLE),
+                    });
+                };
+                break;
+            case arrow_writer::ACT_TIMESTAMP:
+                type_type = TYPE_TIMESTAMP;
+                type_func = [](fb_builder &fb) {
+                    return fb.table({
+                        fb_field::scalar(0, 2, TIME_UNIT_MICROSECOND),
+                    });
+                };
+                break;
+            case arrow_writer::ACT_UTF8:
+            case arrow_writer::ACT_LEVEL:
+                break;
+        }
+
+        vector<fb_field> field_def = {
+            fb_field::offset(0, [name = col.first](fb_builder &fb) {
+                return fb.string(name);
+            }),
+            fb_field::scalar(1, 1, 1),
+            fb_field::scalar(2, 1, type_type),
+            fb_field::offset(3, type_func),
+            fb_field::offset(5, [](fb_builder &fb) {
+                return fb.table_vector({});
+            }),
+        };
+
+        if (col.second == arrow_writer::ACT_LEVEL) {
+            // The levels are in order of severity, so the dictionary is
+            // marked as ordered.
+            field_def.push_back(fb_field::offset(4, [col_index](fb_builder &fb) {
+                return fb.table({
+                    fb_field::scalar(0, 8, col_index),
+                    fb_field::offset(1, int_type(32)),
+                    fb_field::scalar(2, 1, 1),
+                });
+            }));
+        }
+
+        fields.emplace_back([field_def](fb_builder &fb) {
+            return fb.table(field_def);
+        });
+    }
+
+    return [fields](fb_builder &fb) {
+        return fb.table({
+            fb_field::scalar(0, 2, 0),
+            fb_field::offset(1, [fields](fb_builder &fb) {
+                return fb.table_vector(fields);
+            }),
+        });
+    };
+}
+
+column_defs_t arrow_writer::column_defs() const
+{
+    column_defs_t retval;
+
+    for (const auto &col : this->aw_columns) {
+        retval.emplace_back(col.c_name, col.c_type);
+    }
+
+    return retval;
+}
+
+void arrow_writer::start()
+{
+    this->aw_started = true;
+    this->aw_write(ARROW_MAGIC, sizeof(ARROW_MAGIC));
+    this->aw_offset += sizeof(ARROW_MAGIC);
+
+    this->write_message(message_metadata(MESSAGE_HEADER_SCHEMA,
+                                         schema_table(this->column_defs()),
+                                         0),
+                        "",
+                        nullptr);
+
+    for (size_t col_index = 0;
+         col_index < this->aw_columns.size();
+         col_index++) {
+        if (this->aw_columns[col_index].c_type != ACT_LEVEL) {
+            continue;
+        }
+
+        string offsets, data, body, nodes, buffers;
+
+        put_le(offsets, 0, 4);
+        for (int lpc = 0; lpc < LEVEL__MAX; lpc++) {
+            data.append(level_names[lpc]);
+            put_le(offsets, data.size(), 4);
+        }
+        put_le(nodes, LEVEL__MAX, 8);
+        put_le(nodes, 0, 8);
+        add_buffer(body, buffers, "");
+        add_buffer(body, buffers, offsets);
+        add_buffer(body, buffers, data);
+
+        auto batch = record_batch_header(LEVEL__MAX, nodes, 1, buffers, 3);
+
+        this->write_message(
+            message_metadata(MESSAGE_HEADER_DICTIONARY_BATCH,
+                             [col_index, batch](fb_builder &fb) {
+                                 return fb.table({
+                                     fb_field::scalar(0, 8, col_index),
+                                     fb_field::offset(1, batch),
+                                     fb_field::scalar(2, 1, 0),
+                                 });
+                             },
+                             body.size()),
+            body,
+            &this->aw_dictionary_blocks);
+    }
+}
+
+void arrow_writer::flush_batch()
+{
+    string body, nodes, buffers;
+    size_t buffer_count = 0;
+
+    if (this->aw_batch_rows == 0) {
+        return;
+    }
+
+    for (auto &col : this->aw_columns) {
+        put_le(nodes, this->aw_batch_rows, 8);
+        put_le(nodes, col.c_null_count, 8);
+        // The validity buffer can be left empty when there are no nulls.
+        add_buffer(body, buffers, col.c_null_count > 0 ? col.c_validity : "");
+        buffer_count += 1;
+        if (col.c_type == ACT_UTF8) {
+            add_buffer(body, buffers, col.c_offsets);
+            buffer_count += 1;
+        }
+        add_buffer(body, buffers, col.c_data);
+        buffer_count += 1;
+
+        col.c_validity.clear();
+        col.c_offsets.clear();
+        col.c_data.clear();
+        col.c_null_count = 0;
+        if (col.c_type == ACT_UTF8) {
+            put_le(col.c_offsets, 0, 4);
+        }
+    }
+
+    this->write_message(
+        message_metadata(MESSAGE_HEADER_RECORD_BATCH,
+                         record_batch_header(this->aw_batch_rows,
+                                             nodes,
+                                             this->aw_columns.size(),
+                                             buffers,
+                                             buffer_count),
+                         body.size()),
+        body,
+        &this->aw_record_blocks);
+
+    this->aw_batch_rows = 0;
+    this->aw_batch_bytes = 0;
+}
+
+void arrow_writer::finish()
+{
+    if (!this->aw_started) {
+        this->start();
+    }
+
+    this->flush_batch();
+
+    string eos;
+
+    put_le(eos, 0xffffffff, 4);
+    put_le(eos, 0, 4);
+    this->aw_write(eos.data(), eos.size());
+
+    auto to_structs = [](const vector<block> &blocks) {
+        string retval;
+
+        for (const auto &blk : blocks) {
+            put_le(retval, blk.b_offset, 8);
+            put_le(retval, blk.b_metadata_length, 4);
+            put_le(retval, 0, 4);
+            put_le(retval, blk.b_body_length, 8);
+        }
+        return retval;
+    };
+    string dictionaries = to_structs(this->aw_dictionary_blocks);
+    string records = to_structs(this->aw_record_blocks);
+    size_t dictionary_count = this->aw_dictionary_blocks.size();
+    size_t record_count = this->aw_record_blocks.size();
+    fb_builder fb;
+    string footer = fb.finish([&](fb_builder &fb) {
+        return fb.table({
+            fb_field::scalar(0, 2, METADATA_V5),
+            fb_field::offset(1, schema_table(this->column_defs())),
+            fb_field::offset(2, [&](fb_builder &fb) {
+                return fb.struct_vector(dictionaries, dictionary_count);
+            }),
+            fb_field::offset(3, [&](fb_builder &fb) {
+                return fb.struct_vector(records, record_count);
+            }),
+        });
+    });
+    string trailer;
+
+    put_le(trailer, footer.size(), 4);
+    trailer.append(ARROW_MAGIC, 6);
+    this->aw_write(footer.data(), footer.size());
+    this->aw_write(trailer.data(), trailer.size());
+}
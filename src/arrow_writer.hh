@@ -0,0 +1,146 @@
+/**
+ * Copyright (c) 2019, Timothy Stack
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * * Neither the name of Timothy Stack nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __arrow_writer_hh
+#define __arrow_writer_hh
+
+#include <stdint.h>
+
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "log_level.hh"
+
+/**
+ * Writes rows of typed values in the Apache Arrow IPC file format, which is
+ * also known as Feather V2.  The rows are collected into record batches of
+ * a bounded size that are written out as they fill up, so the memory used
+ * does not depend on the number of rows.
+ */
+class arrow_writer {
+public:
+    enum column_type_t {
+        ACT_INT64,
+        ACT_DOUBLE,
+        ACT_UTF8,
+        /** Microseconds since the epoch, without a time zone. */
+        ACT_TIMESTAMP,
+        /** A log level, dictionary-encoded using the level names. */
+        ACT_LEVEL,
+    };
+
+    typedef std::function<void(const char *, size_t)> write_func_t;
+
+    static const size_t BATCH_ROWS = 64 * 1024;
+    static const size_t BATCH_BYTES = 64 * 1024 * 1024;
+
+    explicit arrow_writer(write_func_t func) : aw_write(std::move(func)) {
+    };
+
+    /**
+     * Add a column to the schema, all of the columns need to be added before
+     * the first row is appended.
+     */
+    void add_column(const std::string &name, column_type_t type);
+
+    size_t get_column_count() const {
+        return this->aw_columns.size();
+    };
+
+    column_type_t get_column_type(size_t col) const {
+        return this->aw_columns[col].c_type;
+    };
+
+    void append_null(size_t col);
+
+    void append_int64(size_t col, int64_t value);
+
+    void append_double(size_t col, double value);
+
+    void append_string(size_t col, const char *str, size_t len);
+
+    void append_level(size_t col, log_level_t level);
+
+    /**
+     * Finish the current row, a value must have been appended to every
+     * column.
+     */
+    void end_row();
+
+    /**
+     * Write out any buffered rows and the file footer.
+     */
+    void finish();
+
+    size_t get_row_count() const {
+        return this->aw_row_count;
+    };
+
+private:
+    struct column {
+        std::string c_name;
+        column_type_t c_type;
+        std::string c_validity;
+        std::string c_offsets;
+        std::string c_data;
+        int64_t c_null_count{0};
+    };
+
+    struct block {
+        int64_t b_offset;
+        int32_t b_metadata_length;
+        int64_t b_body_length;
+    };
+
+    std::vector<std::pair<std::string, column_type_t>> column_defs() const;
+
+    void start();
+
+    void set_valid(column &col, bool valid);
+
+    void write_message(const std::string &header_metadata,
+                       const std::string &body,
+                       std::vector<block> *blocks);
+
+    void flush_batch();
+
+    write_func_t aw_write;
+    std::vector<column> aw_columns;
+    bool aw_started{false};
+    size_t aw_offset{0};
+    size_t aw_batch_rows{0};
+    size_t aw_batch_bytes{0};
+    size_t aw_row_count{0};
+    std::vector<block> aw_dictionary_blocks;
+    std::vector<block> aw_record_blocks;
+};
+
+#endif
@@ -54,6 +54,11 @@ struct byte_array {
         return memcmp(this->ba_data, other.ba_data, BYTE_COUNT) < 0;
     };
 
+    bool operator==(const byte_array &other) const
+    {
+        return memcmp(this->ba_data, other.ba_data, BYTE_COUNT) == 0;
+    };
+
     bool operator!=(const byte_array &other) const
     {
         return memcmp(this->ba_data, other.ba_data, BYTE_COUNT) != 0;
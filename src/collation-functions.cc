@@ -31,6 +31,7 @@
 
 #include "config.h"
 
+#include <ctype.h>
 #include <stdio.h>
 #include <string.h>
 #include <sqlite3.h>
@@ -40,9 +41,11 @@
 #include <sys/socket.h>
 
 #include <algorithm>
+#include <string>
 
 #include "log_level.hh"
 #include "strnatcmp.h"
+#include "sqlite-extension-func.hh"
 
 #define MAX_ADDR_LEN    128
 
@@ -155,6 +158,186 @@ int sql_loglevelcmp(void *ptr,
         (const char *)b_in, b_len);
 }
 
+/**
+ * Append a key for a string that sorts with memcmp() in the same order as
+ * the naturalcase/naturalnocase collations.  Whitespace is dropped, a run of
+ * digits that starts with a zero is kept as-is, since those are compared
+ * digit-by-digit.  Other runs of digits are prefixed with their length so
+ * that longer numbers sort after shorter ones.  The digit runs start with a
+ * '0' or '1' marker so they sort in the same position relative to other
+ * characters as they do in strnatcmp().  strnatcmp() also considers a number
+ * at the end of the string to be less than one that is followed by
+ * something, so that is recorded in the key as well.
+ */
+static void append_natural_key(std::string &key,
+                               int len, const char *str, bool fold_case)
+{
+    int lpc = 0;
+
+    while (lpc < len) {
+        unsigned char ch = (unsigned char) str[lpc];
+
+        if (isspace(ch)) {
+            lpc += 1;
+            continue;
+        }
+
+        if (!isdigit(ch)) {
+            key.push_back(fold_case ? toupper(ch) : ch);
+            lpc += 1;
+            continue;
+        }
+
+        int run_end = lpc;
+
+        while (run_end < len && isdigit((unsigned char) str[run_end])) {
+            run_end += 1;
+        }
+
+        int run_len = run_end - lpc;
+        char at_end = run_end == len ? '\0' : '\1';
+
+        if (ch == '0') {
+            key.push_back('0');
+            key.append(&str[lpc], run_len);
+            key.push_back(at_end);
+        } else {
+            key.push_back('1');
+            if (run_len < 0xff) {
+                key.push_back((char) run_len);
+            } else {
+                key.push_back((char) 0xff);
+                for (int shift = 24; shift >= 0; shift -= 8) {
+                    key.push_back((char) ((run_len >> shift) & 0xff));
+                }
+            }
+            key.push_back(at_end);
+            key.append(&str[lpc], run_len);
+        }
+        lpc = run_end;
+    }
+}
+
+/**
+ * Append a key for a string that sorts with memcmp() in the same order as
+ * the ipaddress collation: strings that are not addresses come first and
+ * sort naturally, followed by IPv4 addresses and then IPv6 addresses.
+ */
+static void append_ipaddress_key(std::string &key, int len, const char *str)
+{
+    char addr[sizeof(struct in6_addr)];
+    int family = AF_MAX;
+
+    if (len <= MAX_ADDR_LEN) {
+        family = try_inet_pton(len, str, addr);
+    }
+
+    switch (family) {
+        case AF_MAX:
+            key.push_back('\0');
+            append_natural_key(key, len, str, true);
+            break;
+        default:
+            family = convert_v6_to_v4(family, addr);
+            if (family == AF_INET) {
+                key.push_back('\x01');
+                key.append(addr, sizeof(struct in_addr));
+            } else {
+                key.push_back('\x02');
+                key.append(addr, sizeof(struct in6_addr));
+            }
+            break;
+    }
+}
+
+static void sql_sort_key(sqlite3_context *context,
+                         sqlite3_value *value,
+                         void (*append_key)(std::string &, int, const char *))
+{
+    if (sqlite3_value_type(value) == SQLITE_NULL) {
+        sqlite3_result_null(context);
+        return;
+    }
+
+    const char *str = (const char *) sqlite3_value_text(value);
+    int len = sqlite3_value_bytes(value);
+    std::string key;
+
+    key.reserve(len + 2);
+    append_key(key, len, str);
+    sqlite3_result_blob(context, key.data(), key.size(), SQLITE_TRANSIENT);
+}
+
+static void sql_ipaddress_key(sqlite3_context *context,
+                              int argc, sqlite3_value **argv)
+{
+    sql_sort_key(context, argv[0], append_ipaddress_key);
+}
+
+static void sql_naturalcase_key(sqlite3_context *context,
+                                int argc, sqlite3_value **argv)
+{
+    sql_sort_key(context, argv[0],
+                 [](std::string &key, int len, const char *str) {
+                     append_natural_key(key, len, str, false);
+                 });
+}
+
+static void sql_naturalnocase_key(sqlite3_context *context,
+                                  int argc, sqlite3_value **argv)
+{
+    sql_sort_key(context, argv[0],
+                 [](std::string &key, int len, const char *str) {
+                     append_natural_key(key, len, str, true);
+                 });
+}
+
+int collation_extension_functions(struct FuncDef **basic_funcs,
+                                  struct FuncDefAgg **agg_funcs)
+{
+    static struct FuncDef collation_funcs[] = {
+        {
+            "ipaddress_key", 1, SQLITE_UTF8, 0, sql_ipaddress_key,
+            help_text("ipaddress_key",
+                      "Get a key for a value that sorts in the same order as "
+                      "the 'ipaddress' collation.  Sorting or grouping by the "
+                      "key avoids parsing the addresses for every comparison.")
+                .sql_function()
+                .with_parameter({"str", "The address to get a key for."})
+                .with_tags({"net"})
+                .with_example({"SELECT hex(ipaddress_key('192.168.1.10'))"})
+        },
+
+        {
+            "naturalcase_key", 1, SQLITE_UTF8, 0, sql_naturalcase_key,
+            help_text("naturalcase_key",
+                      "Get a key for a value that sorts in the same order as "
+                      "the 'naturalcase' collation.")
+                .sql_function()
+                .with_parameter({"str", "The string to get a key for."})
+                .with_tags({"string"})
+                .with_example({"SELECT hex(naturalcase_key('foo10'))"})
+        },
+
+        {
+            "naturalnocase_key", 1, SQLITE_UTF8, 0, sql_naturalnocase_key,
+            help_text("naturalnocase_key",
+                      "Get a key for a value that sorts in the same order as "
+                      "the 'naturalnocase' collation.")
+                .sql_function()
+                .with_parameter({"str", "The string to get a key for."})
+                .with_tags({"string"})
+                .with_example({"SELECT hex(naturalnocase_key('Foo10'))"})
+        },
+
+        { NULL }
+    };
+
+    *basic_funcs = collation_funcs;
+
+    return SQLITE_OK;
+}
+
 int register_collation_functions(sqlite3 *db)
 {
     sqlite3_create_collation(db, "ipaddress", SQLITE_UTF8, nullptr, ipaddress);
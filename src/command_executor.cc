@@ -30,6 +30,7 @@
 #include "config.h"
 
 #include <vector>
+#include <unordered_map>
 
 #include "yajlpp/json_ptr.hh"
 #include "pcrecpp.h"
@@ -39,6 +40,7 @@
 #include "sql_util.hh"
 
 #include "command_executor.hh"
+#include "lru_cache.hh"
 #include "db_sub_source.hh"
 #include "papertrail_proc.hh"
 
@@ -52,6 +54,60 @@ static const string MSG_FORMAT_STMT =
         "SELECT count(*) as total, min(log_line) as log_line, log_msg_format "
                 "FROM all_logs GROUP BY log_msg_format ORDER BY total desc";
 
+/**
+ * True if the rows returned by the query that is running should be shown in
+ * the DB view as they arrive.
+ */
+static bool sql_stream_results = false;
+
+/**
+ * Show the rows that have been returned so far by the query that is running
+ * and let the user scroll through them.  Any other keys are left for the
+ * main loop to handle once the query has finished.
+ */
+static void stream_sql_results()
+{
+    db_label_source &dls = lnav_data.ld_db_row_source;
+    textview_curses &db_tc = lnav_data.ld_views[LNV_DB];
+
+    if (!sql_stream_results || dls.dls_rows.size() <= 1) {
+        return;
+    }
+
+    ensure_view(&db_tc);
+
+    vector<int> deferred;
+    int ch;
+
+    while ((ch = getch()) != ERR) {
+        switch (ch) {
+            case 'h':
+            case 'j':
+            case 'k':
+            case 'l':
+            case 'b':
+            case ' ':
+            case KEY_LEFT:
+            case KEY_RIGHT:
+            case KEY_UP:
+            case KEY_DOWN:
+            case KEY_PPAGE:
+            case KEY_NPAGE:
+                db_tc.handle_key(ch);
+                break;
+            default:
+                deferred.push_back(ch);
+                break;
+        }
+    }
+    for (auto iter = deferred.rbegin(); iter != deferred.rend(); ++iter) {
+        ungetch(*iter);
+    }
+
+    db_tc.reload_data();
+    db_tc.do_update();
+}
+
 int sql_progress(const struct log_cursor &lc)
 {
     static sig_atomic_t sql_counter = 0;
@@ -78,6 +134,34 @@ int sql_progress(const struct log_cursor &lc)
     return 0;
 }
 
+/**
+ * Polled by the SQLite progress handler while execute_sql() runs a query,
+ * so the results are streamed for any query, whether or not it reads a
+ * log table.
+ */
+static int sql_poll()
+{
+    static sig_atomic_t poll_counter = 0;
+
+    if (lnav_data.ld_window == NULL) {
+        return 0;
+    }
+
+    if (!lnav_data.ld_looping) {
+        return 1;
+    }
+
+    if (ui_periodic_timer::singleton().time_to_update(poll_counter)) {
+        stream_sql_results();
+        lnav_data.ld_top_source.update_time();
+        lnav_data.ld_status[LNS_TOP].do_update();
+        lnav_data.ld_status[LNS_BOTTOM].do_update();
+        refresh();
+    }
+
+    return 0;
+}
+
 string execute_from_file(exec_context &ec, const string &path, int line_number, char mode, const string &cmdline);
 
 string execute_command(exec_context &ec, const string &cmdline)
@@ -104,6 +188,81 @@ string execute_command(exec_context &ec, const string &cmdline)
     return msg;
 }
 
+void bind_sql_parameters(exec_context &ec, sqlite3_stmt *stmt)
+{
+    int param_count = sqlite3_bind_parameter_count(stmt);
+
+    for (int lpc = 0; lpc < param_count; lpc++) {
+        map<string, string>::iterator ov_iter;
+        const char *name;
+
+        name = sqlite3_bind_parameter_name(stmt, lpc + 1);
+        ov_iter = ec.ec_override.find(name);
+        if (ov_iter != ec.ec_override.end()) {
+            sqlite3_bind_text(stmt,
+                              lpc + 1,
+                              ov_iter->second.c_str(),
+                              ov_iter->second.length(),
+                              SQLITE_TRANSIENT);
+        }
+        else if (name[0] == '$') {
+            map<string, string> &lvars = ec.ec_local_vars.top();
+            map<string, string> &gvars = ec.ec_global_vars;
+            map<string, string>::iterator local_var, global_var;
+            const char *env_value;
+
+            if ((local_var = lvars.find(&name[1])) != lvars.end()) {
+                sqlite3_bind_text(stmt, lpc + 1,
+                                  local_var->second.c_str(), -1,
+                                  SQLITE_TRANSIENT);
+            }
+            else if ((global_var = gvars.find(&name[1])) != gvars.end()) {
+                sqlite3_bind_text(stmt, lpc + 1,
+                                  global_var->second.c_str(), -1,
+                                  SQLITE_TRANSIENT);
+            }
+            else if ((env_value = getenv(&name[1])) != NULL) {
+                sqlite3_bind_text(stmt, lpc + 1, env_value, -1, SQLITE_STATIC);
+            }
+        }
+        else if (name[0] == ':' && ec.ec_line_values != NULL) {
+            vector<logline_value> &lvalues = *ec.ec_line_values;
+            vector<logline_value>::iterator iter;
+
+            for (iter = lvalues.begin(); iter != lvalues.end(); ++iter) {
+                if (strcmp(&name[1], iter->lv_name.get()) != 0) {
+                    continue;
+                }
+                switch (iter->lv_kind) {
+                    case logline_value::VALUE_BOOLEAN:
+                        sqlite3_bind_int64(stmt, lpc + 1, iter->lv_value.i);
+                        break;
+                    case logline_value::VALUE_FLOAT:
+                        sqlite3_bind_double(stmt, lpc + 1, iter->lv_value.d);
+                        break;
+                    case logline_value::VALUE_INTEGER:
+                        sqlite3_bind_int64(stmt, lpc + 1, iter->lv_value.i);
+                        break;
+                    case logline_value::VALUE_NULL:
+                        sqlite3_bind_null(stmt, lpc + 1);
+                        break;
+                    default:
+                        sqlite3_bind_text(stmt,
+                                          lpc + 1,
+                                          iter->text_value(),
+                                          iter->text_length(),
+                                          SQLITE_TRANSIENT);
+                        break;
+                }
+            }
+        }
+        else {
+            sqlite3_bind_null(stmt, lpc + 1);
+            log_warning("Could not bind variable: %s", name);
+        }
+    }
+}
+
 string execute_sql(exec_context &ec, const string &sql, string &alt_msg)
 {
     db_label_source &dls = lnav_data.ld_db_row_source;
@@ -134,7 +293,8 @@ string execute_sql(exec_context &ec, const string &sql, string &alt_msg)
     pair<string, int> source = ec.ec_source.top();
     sql_progress_guard progress_guard(sql_progress,
                                       source.first,
-                                      source.second);
+                                      source.second,
+                                      sql_poll);
     gettimeofday(&start_tv, NULL);
     retcode = sqlite3_prepare_v2(lnav_data.ld_db.in(),
        stmt_str.c_str(),
@@ -153,108 +313,49 @@ string execute_sql(exec_context &ec, const string &sql, string &alt_msg)
     }
     else {
         bool done = false;
-        int param_count;
-
-        param_count = sqlite3_bind_parameter_count(stmt.in());
-        for (int lpc = 0; lpc < param_count; lpc++) {
-            map<string, string>::iterator ov_iter;
-            const char *name;
-
-            name = sqlite3_bind_parameter_name(stmt.in(), lpc + 1);
-            ov_iter = ec.ec_override.find(name);
-            if (ov_iter != ec.ec_override.end()) {
-                sqlite3_bind_text(stmt.in(),
-                                  lpc,
-                                  ov_iter->second.c_str(),
-                                  ov_iter->second.length(),
-                                  SQLITE_TRANSIENT);
-            }
-            else if (name[0] == '$') {
-                map<string, string> &lvars = ec.ec_local_vars.top();
-                map<string, string> &gvars = ec.ec_global_vars;
-                map<string, string>::iterator local_var, global_var;
-                const char *env_value;
-
-                if ((local_var = lvars.find(&name[1])) != lvars.end()) {
-                    sqlite3_bind_text(stmt.in(), lpc + 1,
-                                      local_var->second.c_str(), -1,
-                                      SQLITE_TRANSIENT);
-                }
-                else if ((global_var = gvars.find(&name[1])) != gvars.end()) {
-                    sqlite3_bind_text(stmt.in(), lpc + 1,
-                                      global_var->second.c_str(), -1,
-                                      SQLITE_TRANSIENT);
-                }
-                else if ((env_value = getenv(&name[1])) != NULL) {
-                    sqlite3_bind_text(stmt.in(), lpc + 1, env_value, -1, SQLITE_STATIC);
-                }
-            }
-            else if (name[0] == ':' && ec.ec_line_values != NULL) {
-                vector<logline_value> &lvalues = *ec.ec_line_values;
-                vector<logline_value>::iterator iter;
 
-                for (iter = lvalues.begin(); iter != lvalues.end(); ++iter) {
-                    if (strcmp(&name[1], iter->lv_name.get()) != 0) {
-                        continue;
-                    }
-                    switch (iter->lv_kind) {
-                        case logline_value::VALUE_BOOLEAN:
-                            sqlite3_bind_int64(stmt.in(), lpc + 1, iter->lv_value.i);
-                            break;
-                        case logline_value::VALUE_FLOAT:
-                            sqlite3_bind_double(stmt.in(), lpc + 1, iter->lv_value.d);
-                            break;
-                        case logline_value::VALUE_INTEGER:
-                            sqlite3_bind_int64(stmt.in(), lpc + 1, iter->lv_value.i);
-                            break;
-                        case logline_value::VALUE_NULL:
-                            sqlite3_bind_null(stmt.in(), lpc + 1);
-                            break;
-                        default:
-                            sqlite3_bind_text(stmt.in(),
-                                              lpc + 1,
-                                              iter->text_value(),
-                                              iter->text_length(),
-                                              SQLITE_TRANSIENT);
-                            break;
-                    }
-                }
-            }
-            else {
-                sqlite3_bind_null(stmt.in(), lpc + 1);
-                log_warning("Could not bind variable: %s", name);
-            }
-        }
+        bind_sql_parameters(ec, stmt.in());
 
         if (lnav_data.ld_rl_view != NULL) {
             lnav_data.ld_rl_view->set_value("Executing query: " + sql + " ...");
         }
 
-        ec.ec_sql_callback(ec, stmt.in());
-        while (!done) {
-            retcode = sqlite3_step(stmt.in());
+        bool prev_stream = sql_stream_results;
 
-            switch (retcode) {
-            case SQLITE_OK:
-            case SQLITE_DONE:
-                done = true;
-                break;
+        sql_stream_results = (ec.ec_source.size() <= 1 &&
+                              ec.ec_sql_callback == sql_callback &&
+                              !ec.ec_dry_run &&
+                              !(lnav_data.ld_flags & LNF_HEADLESS));
+        {
+            sql_running_guard running_guard;
 
-            case SQLITE_ROW:
-                ec.ec_sql_callback(ec, stmt.in());
-                break;
+            ec.ec_sql_callback(ec, stmt.in());
+            while (!done) {
+                retcode = sqlite3_step(stmt.in());
 
-            default: {
-                const char *errmsg;
+                switch (retcode) {
+                case SQLITE_OK:
+                case SQLITE_DONE:
+                    done = true;
+                    break;
 
-                log_error("sqlite3_step error code: %d", retcode);
-                errmsg = sqlite3_errmsg(lnav_data.ld_db);
-                retval = ec.get_error_prefix() + string(errmsg);
-                done = true;
-            }
-                break;
+                case SQLITE_ROW:
+                    ec.ec_sql_callback(ec, stmt.in());
+                    break;
+
+                default: {
+                    const char *errmsg;
+
+                    log_error("sqlite3_step error code: %d", retcode);
+                    errmsg = sqlite3_errmsg(lnav_data.ld_db);
+                    retval = ec.get_error_prefix() + string(errmsg);
+                    done = true;
+                }
+                    break;
+                }
             }
         }
+        sql_stream_results = prev_stream;
 
         if (!dls.dls_rows.empty() && !ec.ec_local_vars.empty() &&
             !ec.ec_dry_run) {
@@ -267,7 +368,7 @@ string execute_sql(exec_context &ec, const string &sql, string &alt_msg)
                     continue;
                 }
 
-                vars[column_name] = dls.dls_rows[0][lpc];
+                vars[column_name] = dls.get_cell(0, lpc);
             }
         }
 
@@ -304,10 +405,8 @@ string execute_sql(exec_context &ec, const string &sql, string &alt_msg)
                   "in the log view");
             }
             else if (dls.dls_rows.size() == 1) {
-                auto &row = dls.dls_rows[0];
-
                 if (dls.dls_headers.size() == 1) {
-                    retval = row[0];
+                    retval = dls.get_cell(0, 0);
                 } else {
                     for (unsigned int lpc = 0; lpc < dls.dls_headers.size(); lpc++) {
                         if (lpc > 0) {
@@ -315,7 +414,7 @@ string execute_sql(exec_context &ec, const string &sql, string &alt_msg)
                         }
                         retval.append(dls.dls_headers[lpc].hm_name);
                         retval.push_back('=');
-                        retval.append(row[lpc]);
+                        retval.append(dls.get_cell(0, lpc));
                     }
                 }
             }
@@ -602,6 +701,157 @@ string execute_any(exec_context &ec, const string &cmdline_with_mode)
     return retval;
 }
 
+/** The number of rewriter results to remember. */
+static const size_t REWRITER_RESULT_CACHE_SIZE = 4096;
+
+/**
+ * The statements and results cached by execute_rewriter().  They are only
+ * valid for the database they were prepared against and the formats that
+ * were loaded at the time.
+ */
+struct rewriter_cache {
+    rewriter_cache() : rc_results(REWRITER_RESULT_CACHE_SIZE) {
+    };
+
+    sqlite3 *rc_db{nullptr};
+    lru_cache<string, string> rc_results;
+    unordered_map<string, auto_mem<sqlite3_stmt>> rc_statements;
+};
+
+static rewriter_cache REWRITER_CACHE;
+
+void clear_rewriter_cache()
+{
+    REWRITER_CACHE.rc_statements.clear();
+    REWRITER_CACHE.rc_results.clear();
+    REWRITER_CACHE.rc_db = nullptr;
+}
+
+static string rewriter_cache_key(exec_context &ec,
+                                 const string &rewriter,
+                                 sqlite3_stmt *stmt)
+{
+#if SQLITE_VERSION_NUMBER >= 3014000
+    if (stmt != nullptr) {
+        /*
+         * The statement with the parameters filled in only includes the
+         * values that the query actually refers to.
+         */
+        auto_mem<char> expanded(sqlite3_free);
+
+        expanded = sqlite3_expanded_sql(stmt);
+        if (expanded.in() != nullptr) {
+            return ";" + string(expanded.in());
+        }
+    }
+#endif
+
+    string retval = rewriter;
+
+    if (ec.ec_line_values != nullptr) {
+        for (auto &lv : *ec.ec_line_values) {
+            retval.push_back('\0');
+            retval.append(lv.lv_name.get());
+            retval.push_back('\0');
+            retval.append(lv.to_string());
+        }
+    }
+
+    return retval;
+}
+
+string execute_rewriter(exec_context &ec, const string &rewriter, bool pure)
+{
+    auto &results = REWRITER_CACHE.rc_results;
+    auto &statements = REWRITER_CACHE.rc_statements;
+
+    if (rewriter.empty()) {
+        return "";
+    }
+
+    if (REWRITER_CACHE.rc_db != lnav_data.ld_db.in()) {
+        clear_rewriter_cache();
+        REWRITER_CACHE.rc_db = lnav_data.ld_db.in();
+    }
+
+    sqlite3_stmt *stmt = nullptr;
+
+    if (rewriter[0] == ';' && rewriter.find("logline") == string::npos) {
+        auto iter = statements.find(rewriter);
+
+        if (iter == statements.end()) {
+            auto_mem<sqlite3_stmt> new_stmt(sqlite3_finalize);
+
+            if (sqlite3_prepare_v2(lnav_data.ld_db.in(),
+                                   rewriter.c_str() + 1,
+                                   -1,
+                                   new_stmt.out(),
+                                   nullptr) != SQLITE_OK) {
+                return ec.get_error_prefix() +
+                       string(sqlite3_errmsg(lnav_data.ld_db.in()));
+            }
+            iter = statements.emplace(rewriter, std::move(new_stmt)).first;
+        }
+
+        stmt = iter->second.in();
+        if (stmt == nullptr) {
+            return "";
+        }
+        sqlite3_reset(stmt);
+        sqlite3_clear_bindings(stmt);
+        bind_sql_parameters(ec, stmt);
+    }
+    else if (rewriter[0] == ';') {
+        /*
+         * The logline table is recreated for the top line in the view, so
+         * queries that use it cannot be reused or cached.
+         */
+        pure = false;
+    }
+
+    string key;
+
+    if (pure) {
+        key = rewriter_cache_key(ec, rewriter, stmt);
+
+        string *cached = results.get(key);
+
+        if (cached != nullptr) {
+            return *cached;
+        }
+    }
+
+    string retval;
+
+    if (stmt != nullptr) {
+        int rc;
+
+        ec.ec_accumulator.clear();
+        ec.ec_sql_callback(ec, stmt);
+        while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+            ec.ec_sql_callback(ec, stmt);
+        }
+        if (rc != SQLITE_DONE) {
+            retval = ec.get_error_prefix() +
+                     string(sqlite3_errmsg(lnav_data.ld_db.in()));
+            sqlite3_reset(stmt);
+
+            return retval;
+        }
+        sqlite3_reset(stmt);
+        retval = ec.ec_accumulator.get_string();
+    }
+    else {
+        retval = execute_any(ec, rewriter);
+    }
+
+    if (pure) {
+        results.put(key, retval);
+    }
+
+    return retval;
+}
+
 void execute_init_commands(exec_context &ec, vector<pair<string, string> > &msgs)
 {
     if (lnav_data.ld_cmd_init_done) {
@@ -679,11 +929,8 @@ int sql_callback(exec_context &ec, sqlite3_stmt *stmt)
     stacked_bar_chart<std::string> &chart = dls.dls_chart;
     view_colors &vc = view_colors::singleton();
     int ncols = sqlite3_column_count(stmt);
-    int row_number;
     int lpc, retval = 0;
 
-    row_number = dls.dls_rows.size();
-    dls.dls_rows.resize(row_number + 1);
     if (dls.dls_headers.empty()) {
         for (lpc = 0; lpc < ncols; lpc++) {
             int    type    = sqlite3_column_type(stmt, lpc);
@@ -701,16 +948,16 @@ int sql_callback(exec_context &ec, sqlite3_stmt *stmt)
                 chart.with_attrs_for_ident(colname, attrs);
             }
         }
+        dls.dls_rows.set_memory_limit(
+            lnav_config.lc_tuning_sql_result_memory_limit);
     }
+    dls.push_row();
     for (lpc = 0; lpc < ncols; lpc++) {
-        const char *value = (const char *)sqlite3_column_text(stmt, lpc);
+        sqlite3_value *raw_value = sqlite3_column_value(stmt, lpc);
         db_label_source::header_meta &hm = dls.dls_headers[lpc];
 
-        dls.push_column(value);
         if ((hm.hm_column_type == SQLITE_TEXT ||
              hm.hm_column_type == SQLITE_NULL) && hm.hm_sub_type == 0) {
-            sqlite3_value *raw_value = sqlite3_column_value(stmt, lpc);
-
             switch (sqlite3_value_type(raw_value)) {
                 case SQLITE_TEXT:
                     hm.hm_column_type = SQLITE_TEXT;
@@ -718,9 +965,11 @@ int sql_callback(exec_context &ec, sqlite3_stmt *stmt)
                     break;
             }
         }
-        if (value != nullptr &&
+        dls.push_column(raw_value);
+        if (sqlite3_value_type(raw_value) != SQLITE_NULL &&
             (dls.dls_headers[lpc].hm_name == "log_line" ||
              strstr(dls.dls_headers[lpc].hm_name.c_str(), "log_line"))) {
+            const char *value = (const char *) sqlite3_value_text(raw_value);
             int line_number = -1;
 
             if (sscanf(value, "%d", &line_number) == 1) {
@@ -106,8 +106,35 @@ std::string execute_command(exec_context &ec, const std::string &cmdline);
 std::string execute_sql(exec_context &ec, const std::string &sql, std::string &alt_msg);
 std::string execute_file(exec_context &ec, const std::string &path_and_args, bool multiline = true);
 std::string execute_any(exec_context &ec, const std::string &cmdline);
+
+/**
+ * Execute a format's value rewriter for the values in ec.ec_line_values.
+ * SQL rewriters are only prepared once and the results of pure rewriters
+ * are remembered, so redrawing the same lines does not run them again.
+ *
+ * @param ec The context with the values from the log line.
+ * @param rewriter The rewriter command, with its mode prefix.
+ * @param pure True if the result only depends on the values in the line.
+ * @return The result of the rewriter.
+ */
+std::string execute_rewriter(exec_context &ec,
+                             const std::string &rewriter,
+                             bool pure);
+
+/**
+ * Drop the statements and results cached by execute_rewriter().  This needs
+ * to be done when the formats are loaded again and before the database the
+ * statements were prepared against is closed.
+ */
+void clear_rewriter_cache();
 void execute_init_commands(exec_context &ec, std::vector<std::pair<std::string, std::string> > &msgs);
 
+/**
+ * Bind the parameters in a statement to the values of the variables and log
+ * line fields with the same names.
+ */
+void bind_sql_parameters(exec_context &ec, sqlite3_stmt *stmt);
+
 int sql_callback(exec_context &ec, sqlite3_stmt *stmt);
 std::future<std::string> pipe_callback(
     exec_context &ec, const std::string &cmdline, auto_fd &fd);
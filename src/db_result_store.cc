@@ -0,0 +1,357 @@
+/**
+ * Copyright (c) 2019, Timothy Stack
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * * Neither the name of Timothy Stack nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "base/lnav_log.hh"
+#include "db_result_store.hh"
+
+using namespace std;
+
+bool db_result_store::cell::to_double(double &value_out) const
+{
+    switch (this->c_type) {
+        case CT_INTEGER:
+            value_out = this->c_int;
+            return true;
+        case CT_FLOAT:
+            value_out = this->c_float;
+            return true;
+        case CT_TEXT:
+            return sscanf(this->c_text, "%lf", &value_out) == 1;
+        default:
+            return false;
+    }
+}
+
+void db_result_store::cell::render(std::string &dst) const
+{
+    char buf[64];
+
+    switch (this->c_type) {
+        case CT_NULL:
+            break;
+        case CT_INTEGER:
+            snprintf(buf, sizeof(buf), "%lld", (long long) this->c_int);
+            dst.append(buf);
+            break;
+        case CT_FLOAT: {
+            if (isinf(this->c_float)) {
+                dst.append(this->c_float < 0 ? "-Inf" : "Inf");
+                break;
+            }
+
+            /* Match the "%!.15g" format SQLite uses for floats. */
+            snprintf(buf, sizeof(buf), "%.15g", this->c_float);
+
+            char *exp = strchr(buf, 'e');
+
+            if (strchr(buf, '.') != nullptr) {
+                dst.append(buf);
+            }
+            else if (exp != nullptr) {
+                dst.append(buf, exp - buf);
+                dst.append(".0");
+                dst.append(exp);
+            }
+            else {
+                dst.append(buf);
+                dst.append(".0");
+            }
+            break;
+        }
+        case CT_TEXT:
+            dst.append(this->c_text, this->c_length);
+            break;
+    }
+}
+
+db_result_store::db_result_store()
+    : drs_current_chunk(nullptr),
+      drs_chunk_used(0),
+      drs_row_count(0),
+      drs_current_column(0),
+      drs_memory_usage(0),
+      drs_memory_limit(DEFAULT_MEMORY_LIMIT),
+      drs_spill_start(0),
+      drs_spill_insert(sqlite3_finalize),
+      drs_spill_select(sqlite3_finalize),
+      drs_spill_cached_row(-1)
+{
+}
+
+const char *db_result_store::copy_text(const char *text, size_t len)
+{
+    size_t old_capacity = this->drs_chunks.capacity();
+    char *retval;
+
+    if (len + 1 > CHUNK_SIZE / 4) {
+        /* Big values get their own allocation so chunks aren't wasted. */
+        this->drs_chunks.emplace_back(new char[len + 1]);
+        this->drs_memory_usage += len + 1;
+        retval = this->drs_chunks.back().get();
+    }
+    else {
+        if (this->drs_current_chunk == nullptr ||
+            this->drs_chunk_used + len + 1 > CHUNK_SIZE) {
+            this->drs_chunks.emplace_back(new char[CHUNK_SIZE]);
+            this->drs_current_chunk = this->drs_chunks.back().get();
+            this->drs_chunk_used = 0;
+            this->drs_memory_usage += CHUNK_SIZE;
+        }
+        retval = &this->drs_current_chunk[this->drs_chunk_used];
+        this->drs_chunk_used += len + 1;
+    }
+    this->drs_memory_usage +=
+        (this->drs_chunks.capacity() - old_capacity) *
+        sizeof(this->drs_chunks[0]);
+
+    memcpy(retval, text, len);
+    retval[len] = '\0';
+
+    return retval;
+}
+
+void db_result_store::start_spill()
+{
+    string create_sql = "CREATE TABLE spill (";
+    string insert_sql = "INSERT INTO spill VALUES (";
+
+    for (size_t col = 0; col < this->drs_columns.size(); col++) {
+        if (col > 0) {
+            create_sql.append(", ");
+            insert_sql.append(", ");
+        }
+        create_sql.append("c" + to_string(col));
+        insert_sql.append("?");
+    }
+    create_sql.append(")");
+    insert_sql.append(")");
+
+    /* An empty file name gives a private database in a temporary file. */
+    if (sqlite3_open("", this->drs_spill_db.out()) != SQLITE_OK ||
+        sqlite3_exec(this->drs_spill_db.in(), "PRAGMA journal_mode=OFF",
+                     nullptr, nullptr, nullptr) != SQLITE_OK ||
+        sqlite3_exec(this->drs_spill_db.in(), create_sql.c_str(),
+                     nullptr, nullptr, nullptr) != SQLITE_OK ||
+        sqlite3_prepare_v2(this->drs_spill_db.in(), insert_sql.c_str(), -1,
+                           this->drs_spill_insert.out(),
+                           nullptr) != SQLITE_OK ||
+        sqlite3_prepare_v2(this->drs_spill_db.in(),
+                           "SELECT * FROM spill WHERE rowid = ?", -1,
+                           this->drs_spill_select.out(),
+                           nullptr) != SQLITE_OK) {
+        log_error("unable to create SQL result spill table -- %s",
+                  this->drs_spill_db.in() == nullptr ? "out of memory" :
+                  sqlite3_errmsg(this->drs_spill_db.in()));
+        this->drs_spill_insert.reset();
+        this->drs_spill_select.reset();
+        this->drs_spill_db.reset();
+        return;
+    }
+
+    log_info("SQL results exceeded %zu bytes, spilling rows after %zu "
+             "to a temporary table",
+             this->drs_memory_limit, this->drs_row_count);
+    this->drs_spill_start = this->drs_row_count;
+    sqlite3_exec(this->drs_spill_db.in(), "BEGIN TRANSACTION",
+                 nullptr, nullptr, nullptr);
+}
+
+void db_result_store::push_row()
+{
+    require(this->drs_row_count == 0 ||
+            this->drs_current_column == this->drs_columns.size());
+
+    if (!this->is_spilled() &&
+        this->drs_memory_usage >= this->drs_memory_limit) {
+        this->start_spill();
+    }
+    this->drs_row_count += 1;
+    this->drs_current_column = 0;
+}
+
+const db_result_store::cell &db_result_store::push_value(sqlite3_value *sv,
+                                                         string *rendered)
+{
+    require(this->drs_current_column < this->drs_columns.size());
+
+    cell retval;
+
+    switch (sqlite3_value_type(sv)) {
+        case SQLITE_NULL:
+            retval.c_type = CT_NULL;
+            retval.c_int = 0;
+            retval.c_length = 0;
+            break;
+        case SQLITE_INTEGER:
+            retval.c_type = CT_INTEGER;
+            retval.c_int = sqlite3_value_int64(sv);
+            retval.c_length = 0;
+            break;
+        case SQLITE_FLOAT:
+            retval.c_type = CT_FLOAT;
+            retval.c_float = sqlite3_value_double(sv);
+            retval.c_length = 0;
+            break;
+        default:
+            retval.c_type = CT_TEXT;
+            retval.c_text = (const char *) sqlite3_value_text(sv);
+            retval.c_length = sqlite3_value_bytes(sv);
+            if (retval.c_text == nullptr) {
+                retval.c_text = "";
+                retval.c_length = 0;
+            }
+            break;
+    }
+
+    if (rendered != nullptr) {
+        rendered->clear();
+        retval.render(*rendered);
+    }
+
+    size_t col = this->drs_current_column++;
+
+    if (this->is_spilled()) {
+        sqlite3_bind_value(this->drs_spill_insert.in(), col + 1, sv);
+        this->drs_spill_pushed = retval;
+        if (this->drs_current_column == this->drs_columns.size()) {
+            if (sqlite3_step(this->drs_spill_insert.in()) != SQLITE_DONE) {
+                log_error("unable to write to SQL result spill table -- %s",
+                          sqlite3_errmsg(this->drs_spill_db.in()));
+            }
+            sqlite3_reset(this->drs_spill_insert.in());
+            sqlite3_clear_bindings(this->drs_spill_insert.in());
+        }
+        return this->drs_spill_pushed;
+    }
+
+    if (retval.c_type == CT_TEXT) {
+        retval.c_text = this->copy_text(retval.c_text, retval.c_length);
+    }
+    auto &column = this->drs_columns[col];
+    size_t old_capacity = column.capacity();
+
+    /* Count what the vector reserved, not just the cells in use. */
+    column.push_back(retval);
+    this->drs_memory_usage +=
+        (column.capacity() - old_capacity) * sizeof(cell);
+
+    return column.back();
+}
+
+void db_result_store::load_spilled_row(size_t row) const
+{
+    sqlite3_stmt *stmt = this->drs_spill_select.in();
+
+    this->drs_spill_cached_row = row;
+    this->drs_spill_cells.resize(this->drs_columns.size());
+    this->drs_spill_text.resize(this->drs_columns.size());
+
+    sqlite3_reset(stmt);
+    sqlite3_bind_int64(stmt, 1, row - this->drs_spill_start + 1);
+    if (sqlite3_step(stmt) != SQLITE_ROW) {
+        log_error("unable to read SQL result row %zu from spill table -- %s",
+                  row, sqlite3_errmsg(this->drs_spill_db.in()));
+        for (auto &sc : this->drs_spill_cells) {
+            sc.c_type = CT_NULL;
+            sc.c_length = 0;
+        }
+        return;
+    }
+
+    for (size_t col = 0; col < this->drs_columns.size(); col++) {
+        cell &sc = this->drs_spill_cells[col];
+
+        sc.c_length = 0;
+        switch (sqlite3_column_type(stmt, col)) {
+            case SQLITE_NULL:
+                sc.c_type = CT_NULL;
+                break;
+            case SQLITE_INTEGER:
+                sc.c_type = CT_INTEGER;
+                sc.c_int = sqlite3_column_int64(stmt, col);
+                break;
+            case SQLITE_FLOAT:
+                sc.c_type = CT_FLOAT;
+                sc.c_float = sqlite3_column_double(stmt, col);
+                break;
+            default: {
+                string &text = this->drs_spill_text[col];
+                const char *value =
+                    (const char *) sqlite3_column_text(stmt, col);
+
+                text.assign(value == nullptr ? "" : value,
+                            sqlite3_column_bytes(stmt, col));
+                sc.c_type = CT_TEXT;
+                sc.c_text = text.c_str();
+                sc.c_length = text.length();
+                break;
+            }
+        }
+    }
+}
+
+const db_result_store::cell &db_result_store::get_cell(size_t row,
+                                                       size_t col) const
+{
+    require(row < this->drs_row_count);
+    require(col < this->drs_columns.size());
+
+    if (this->is_spilled() && row >= this->drs_spill_start) {
+        if (row != this->drs_spill_cached_row) {
+            this->load_spilled_row(row);
+        }
+        return this->drs_spill_cells[col];
+    }
+
+    return this->drs_columns[col][row];
+}
+
+void db_result_store::clear()
+{
+    this->drs_columns.clear();
+    this->drs_chunks.clear();
+    this->drs_current_chunk = nullptr;
+    this->drs_chunk_used = 0;
+    this->drs_row_count = 0;
+    this->drs_current_column = 0;
+    this->drs_memory_usage = 0;
+    this->drs_spill_start = 0;
+    this->drs_spill_insert.reset();
+    this->drs_spill_select.reset();
+    this->drs_spill_db.reset();
+    this->drs_spill_cached_row = -1;
+    this->drs_spill_cells.clear();
+    this->drs_spill_text.clear();
+}
@@ -0,0 +1,181 @@
+/**
+ * Copyright (c) 2019, Timothy Stack
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * * Neither the name of Timothy Stack nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __db_result_store_hh
+#define __db_result_store_hh
+
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <sqlite3.h>
+
+#include "auto_mem.hh"
+#include "sql_util.hh"
+
+/**
+ * Storage for the rows returned by a SQL query.  Values are kept by column
+ * with their SQLite type, so numbers are stored natively and only turned
+ * into text when they are displayed.  Text is copied into large chunks
+ * instead of being allocated one cell at a time.  Once the store uses more
+ * than its memory limit, any further rows are written to a table in a
+ * temporary SQLite database and read back a row at a time when needed.
+ */
+class db_result_store {
+public:
+    static const size_t DEFAULT_MEMORY_LIMIT = 256 * 1024 * 1024;
+
+    enum cell_type_t : uint8_t {
+        CT_NULL,
+        CT_INTEGER,
+        CT_FLOAT,
+        CT_TEXT,
+    };
+
+    struct cell {
+        union {
+            int64_t c_int;
+            double c_float;
+            const char *c_text;
+        };
+        uint32_t c_length;
+        cell_type_t c_type;
+
+        bool is_null() const {
+            return this->c_type == CT_NULL;
+        };
+
+        /**
+         * @param value_out The numeric value of the cell, text is parsed
+         *   with sscanf(3) like it was before the store kept types.
+         * @return True if the cell has a numeric value.
+         */
+        bool to_double(double &value_out) const;
+
+        /**
+         * Append the text form of the cell to the given string.  Floats are
+         * formatted the same way SQLite converts them to text.  Nothing is
+         * appended for NULL values.
+         */
+        void render(std::string &dst) const;
+    };
+
+    db_result_store();
+
+    void set_memory_limit(size_t limit) {
+        this->drs_memory_limit = limit;
+    };
+
+    size_t get_memory_limit() const {
+        return this->drs_memory_limit;
+    };
+
+    /**
+     * @return The amount of memory used by the values held in memory,
+     *   including the unused capacity of the columns.
+     */
+    size_t get_memory_usage() const {
+        return this->drs_memory_usage;
+    };
+
+    bool is_spilled() const {
+        return this->drs_spill_db.in() != nullptr;
+    };
+
+    void add_column() {
+        this->drs_columns.emplace_back();
+    };
+
+    size_t column_count() const {
+        return this->drs_columns.size();
+    };
+
+    size_t size() const {
+        return this->drs_row_count;
+    };
+
+    bool empty() const {
+        return this->drs_row_count == 0;
+    };
+
+    /** Start a new row, the values are added with push_value(). */
+    void push_row();
+
+    /**
+     * Add a value to the current row.
+     *
+     * @param sv The value to store, it is copied into the store.
+     * @param rendered If not NULL, the text form of the value is written
+     *   here so the caller does not have to render it again.
+     * @return The stored cell.
+     */
+    const cell &push_value(sqlite3_value *sv, std::string *rendered = nullptr);
+
+    /**
+     * @return The cell at the given position.  The reference is only valid
+     *   until the next call for a different row since rows that have been
+     *   spilled to disk are read into a single buffer.
+     */
+    const cell &get_cell(size_t row, size_t col) const;
+
+    void clear();
+
+private:
+    const char *copy_text(const char *text, size_t len);
+    void start_spill();
+    void load_spilled_row(size_t row) const;
+
+    /** The size of the chunks used to hold text values. */
+    static const size_t CHUNK_SIZE = 1024 * 1024;
+
+    std::vector<std::vector<cell>> drs_columns;
+    std::vector<std::unique_ptr<char[]>> drs_chunks;
+    char *drs_current_chunk;
+    size_t drs_chunk_used;
+    size_t drs_row_count;
+    size_t drs_current_column;
+    size_t drs_memory_usage;
+    size_t drs_memory_limit;
+
+    /** The index of the first row that was written to the spill table. */
+    size_t drs_spill_start;
+    auto_mem<sqlite3, sqlite_close_wrapper> drs_spill_db;
+    auto_mem<sqlite3_stmt> drs_spill_insert;
+    auto_mem<sqlite3_stmt> drs_spill_select;
+    cell drs_spill_pushed;
+
+    /** The last row read from the spill table. */
+    mutable size_t drs_spill_cached_row;
+    mutable std::vector<cell> drs_spill_cells;
+    mutable std::vector<std::string> drs_spill_text;
+};
+
+#endif
@@ -47,22 +47,49 @@ void db_label_source::text_value_for_line(textview_curses &tc, int row,
     if (row >= (int)this->dls_rows.size()) {
         return;
     }
-    for (int lpc = 0; lpc < (int)this->dls_rows[row].size(); lpc++) {
-        int padding = (this->dls_headers[lpc].hm_column_size -
-                       strlen(this->dls_rows[row][lpc]) -
-                       1);
-
-        if (this->dls_headers[lpc].hm_column_type != SQLITE3_TEXT) {
-            label_out.append(padding, ' ');
+    for (int lpc = 0; lpc < (int)this->dls_headers.size(); lpc++) {
+        const auto &value = this->dls_rows.get_cell(row, lpc);
+        size_t start = label_out.size();
+        int padding;
+
+        /* Render the value first and then shift it over if it needs to be */
+        /* right-justified, so numbers are only formatted once. */
+        if (value.is_null()) {
+            label_out.append(NULL_STR);
+        }
+        else {
+            value.render(label_out);
         }
-        label_out.append(this->dls_rows[row][lpc]);
-        if (this->dls_headers[lpc].hm_column_type == SQLITE3_TEXT) {
-            label_out.append(padding, ' ');
+        padding = (this->dls_headers[lpc].hm_column_size -
+                   (label_out.size() - start) -
+                   1);
+        if (padding > 0) {
+            if (this->dls_headers[lpc].hm_column_type != SQLITE3_TEXT) {
+                label_out.insert(start, padding, ' ');
+            }
+            else {
+                label_out.append(padding, ' ');
+            }
         }
         label_out.append(1, ' ');
     }
 }
 
+std::string db_label_source::get_cell(size_t row, size_t col) const
+{
+    const auto &value = this->dls_rows.get_cell(row, col);
+    std::string retval;
+
+    if (value.is_null()) {
+        retval = NULL_STR;
+    }
+    else {
+        value.render(retval);
+    }
+
+    return retval;
+}
+
 void db_label_source::text_attrs_for_line(textview_curses &tc, int row,
                                           string_attrs_t &sa)
 {
@@ -84,16 +111,22 @@ void db_label_source::text_attrs_for_line(textview_curses &tc, int row,
 
     int left = 0;
     for (size_t lpc = 0; lpc < this->dls_headers.size(); lpc++) {
-        const char *row_value = this->dls_rows[row][lpc];
-        size_t row_len = strlen(row_value);
+        const auto &value = this->dls_rows.get_cell(row, lpc);
 
         if (this->dls_headers[lpc].hm_graphable) {
             double num_value;
 
-            if (sscanf(row_value, "%lf", &num_value) == 1) {
+            if (value.to_double(num_value)) {
                 this->dls_chart.chart_attrs_for_value(tc, left, this->dls_headers[lpc].hm_name, num_value, sa);
             }
         }
+        if (value.c_type != db_result_store::CT_TEXT) {
+            continue;
+        }
+
+        const char *row_value = value.c_text;
+        size_t row_len = value.c_length;
+
         if (row_len > 2 &&
             ((row_value[0] == '{' && row_value[row_len - 1] == '}') ||
              (row_value[0] == '[' && row_value[row_len - 1] == ']'))) {
@@ -128,29 +161,25 @@ void db_label_source::push_header(const std::string &colstr, int type,
     if (colstr == "log_time") {
         this->dls_time_column_index = this->dls_headers.size() - 1;
     }
+    this->dls_rows.add_column();
 }
 
-void db_label_source::push_column(const char *colstr)
+void db_label_source::push_column(sqlite3_value *sv)
 {
     view_colors &vc = view_colors::singleton();
-    int index = this->dls_rows.back().size();
+    int index = this->dls_push_index;
     double num_value = 0.0;
-    size_t value_len;
+    std::string &rendered = this->dls_rendered;
+    const auto &value = this->dls_rows.push_value(sv, &rendered);
+    size_t value_len = rendered.length();
+    const char *colstr;
 
-    if (colstr == nullptr) {
-        value_len = 0;
-    }
-    else {
-        value_len = strlen(colstr);
-    }
-    if (colstr == nullptr) {
+    this->dls_push_index += 1;
+    if (value.is_null()) {
         colstr = NULL_STR;
     }
     else {
-        colstr = strdup(colstr);
-        if (colstr == nullptr) {
-            throw "out of memory";
-        }
+        colstr = rendered.c_str();
     }
 
     if (index == this->dls_time_column_index) {
@@ -170,17 +199,17 @@ void db_label_source::push_column(const char *colstr)
         }
     }
 
-    this->dls_rows.back().push_back(colstr);
     this->dls_headers[index].hm_column_size =
         std::max(this->dls_headers[index].hm_column_size, strlen(colstr) + 1);
 
-    if (colstr != nullptr && this->dls_headers[index].hm_graphable) {
-        if (sscanf(colstr, "%lf", &num_value) != 1) {
+    if (this->dls_headers[index].hm_graphable) {
+        if (!value.to_double(num_value)) {
             num_value = 0.0;
         }
         this->dls_chart.add_value(this->dls_headers[index].hm_name, num_value);
     }
-    else if (value_len > 2 &&
+    else if (value.c_type == db_result_store::CT_TEXT &&
+             value_len > 2 &&
              ((colstr[0] == '{' && colstr[value_len - 1] == '}') ||
               (colstr[0] == '[' && colstr[value_len - 1] == ']'))) {
         json_ptr_walk jpw;
@@ -203,13 +232,6 @@ void db_label_source::clear()
 {
     this->dls_chart.clear();
     this->dls_headers.clear();
-    for (size_t row = 0; row < this->dls_rows.size(); row++) {
-        for (size_t col = 0; col < this->dls_rows[row].size(); col++) {
-            if (this->dls_rows[row][col] != NULL_STR) {
-                free((void *)this->dls_rows[row][col]);
-            }
-        }
-    }
     this->dls_rows.clear();
     this->dls_time_column.clear();
 }
@@ -226,16 +248,25 @@ size_t db_overlay_source::list_overlay_count(const listview_curses &lv)
 
     view_colors &vc = view_colors::singleton();
     vis_line_t top = lv.get_top();
-    const std::vector<const char *> &cols = this->dos_labels->dls_rows[top];
+    const db_result_store &rows = this->dos_labels->dls_rows;
     unsigned long width;
     vis_line_t height;
 
     lv.get_dimensions(height, width);
 
     this->dos_lines.clear();
-    for (size_t col = 0; col < cols.size(); col++) {
-        const char *col_value = cols[col];
-        size_t col_len = strlen(col_value);
+    if (top >= (int) rows.size()) {
+        return retval;
+    }
+    for (size_t col = 0; col < rows.column_count(); col++) {
+        const auto &value = rows.get_cell(top, col);
+
+        if (value.c_type != db_result_store::CT_TEXT) {
+            continue;
+        }
+
+        const char *col_value = value.c_text;
+        size_t col_len = value.c_length;
 
         if (!(col_len >= 2 &&
               ((col_value[0] == '{' && col_value[col_len - 1] == '}') ||
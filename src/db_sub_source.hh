@@ -41,10 +41,11 @@
 
 #include "textview_curses.hh"
 #include "hist_source.hh"
+#include "db_result_store.hh"
 
 class db_label_source : public text_sub_source, public text_time_translator {
 public:
-    db_label_source() : dls_time_column_index(-1) {
+    db_label_source() : dls_time_column_index(-1), dls_push_index(0) {
 
     };
 
@@ -80,9 +81,25 @@ public:
 
     void push_header(const std::string &colstr, int type, bool graphable);
 
+    /** Start a new row of results, the headers must already be pushed. */
+    void push_row() {
+        this->dls_rows.push_row();
+        this->dls_push_index = 0;
+    };
+
     /* TODO: add support for left and right justification... numbers should */
     /* be right justified and strings should be left. */
-    void push_column(const char *colstr);
+    void push_column(sqlite3_value *sv);
+
+    bool is_null_cell(size_t row, size_t col) const {
+        return this->dls_rows.get_cell(row, col).is_null();
+    };
+
+    /**
+     * @return The text of the cell at the given position, NULL values are
+     *   returned as NULL_STR.
+     */
+    std::string get_cell(size_t row, size_t col) const;
 
     void clear();
 
@@ -143,11 +160,17 @@ public:
 
     stacked_bar_chart<std::string> dls_chart;
     std::vector<header_meta> dls_headers;
-    std::vector<std::vector<const char *> > dls_rows;
+    db_result_store dls_rows;
     std::vector<struct timeval> dls_time_column;
     int dls_time_column_index;
 
     static const char *NULL_STR;
+
+private:
+    /** The index of the next column to be pushed in the current row. */
+    size_t dls_push_index;
+    /** Scratch space for the text of the value being pushed. */
+    std::string dls_rendered;
 };
 
 class db_overlay_source : public list_overlay_source {
@@ -0,0 +1,252 @@
+/**
+ * Copyright (c) 2019, Timothy Stack
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * * Neither the name of Timothy Stack nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netdb.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+
+#include "sqlite3.h"
+
+#include "auto_mem.hh"
+#include "base/lnav_log.hh"
+#include "dns_resolver.hh"
+
+using namespace std;
+
+const size_t dns_cache::MAX_ENTRIES;
+const time_t dns_cache::FOUND_TTL;
+const time_t dns_cache::NOT_FOUND_TTL;
+
+bool system_dns_resolver::lookup_name(const string &name, string &addr_out)
+{
+    char             buffer[INET6_ADDRSTRLEN];
+    auto_mem<struct addrinfo> ai(freeaddrinfo);
+    void *           addr_ptr = NULL;
+    int rc;
+
+    while ((rc = getaddrinfo(name.c_str(), NULL, NULL, ai.out())) == EAI_AGAIN) {
+        sqlite3_sleep(10);
+    }
+    if (rc != 0) {
+        return false;
+    }
+
+    switch (ai.in()->ai_family) {
+    case AF_INET:
+        addr_ptr = &((struct sockaddr_in *)ai.in()->ai_addr)->sin_addr;
+        break;
+
+    case AF_INET6:
+        addr_ptr = &((struct sockaddr_in6 *)ai.in()->ai_addr)->sin6_addr;
+        break;
+
+    default:
+        return false;
+    }
+
+    inet_ntop(ai.in()->ai_family, addr_ptr, buffer, sizeof(buffer));
+    addr_out = buffer;
+
+    return true;
+}
+
+bool system_dns_resolver::lookup_addr(const string &addr, string &name_out)
+{
+    union {
+        struct sockaddr_in  sin;
+        struct sockaddr_in6 sin6;
+    }           sa;
+    char        buffer[NI_MAXHOST];
+    int         family, socklen;
+    char *      addr_raw;
+    int         rc;
+
+    memset(&sa, 0, sizeof(sa));
+    if (addr.find(':') != string::npos) {
+        family              = AF_INET6;
+        socklen             = sizeof(struct sockaddr_in6);
+        sa.sin6.sin6_family = family;
+        addr_raw            = (char *)&sa.sin6.sin6_addr;
+    }
+    else {
+        family            = AF_INET;
+        socklen           = sizeof(struct sockaddr_in);
+        sa.sin.sin_family = family;
+        addr_raw          = (char *)&sa.sin.sin_addr;
+    }
+
+    if (inet_pton(family, addr.c_str(), addr_raw) != 1) {
+        return false;
+    }
+
+    while ((rc = getnameinfo((struct sockaddr *)&sa, socklen,
+                             buffer, sizeof(buffer), NULL, 0,
+                             0)) == EAI_AGAIN) {
+        sqlite3_sleep(10);
+    }
+
+    if (rc != 0) {
+        return false;
+    }
+
+    name_out = buffer;
+
+    return true;
+}
+
+hosts_file_resolver::hosts_file_resolver(const string &path)
+{
+    auto_mem<FILE> file(fclose);
+
+    if ((file = fopen(path.c_str(), "r")) == nullptr) {
+        log_error("unable to open hosts file -- %s", path.c_str());
+        return;
+    }
+
+    char *line = nullptr;
+    size_t line_max_size = 0;
+
+    while (getline(&line, &line_max_size, file.in()) != -1) {
+        char *comment = strchr(line, '#');
+        char *saveptr = nullptr;
+        host_entry he;
+
+        if (comment != nullptr) {
+            *comment = '\0';
+        }
+
+        for (char *tok = strtok_r(line, " \t\r\n", &saveptr);
+             tok != nullptr;
+             tok = strtok_r(nullptr, " \t\r\n", &saveptr)) {
+            if (he.he_addr.empty()) {
+                he.he_addr = tok;
+            } else {
+                he.he_names.emplace_back(tok);
+            }
+        }
+
+        if (!he.he_names.empty()) {
+            this->hfr_entries.emplace_back(std::move(he));
+        }
+    }
+    free(line);
+}
+
+bool hosts_file_resolver::lookup_name(const string &name, string &addr_out)
+{
+    for (const auto &he : this->hfr_entries) {
+        for (const auto &he_name : he.he_names) {
+            if (he_name == name) {
+                addr_out = he.he_addr;
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+bool hosts_file_resolver::lookup_addr(const string &addr, string &name_out)
+{
+    for (const auto &he : this->hfr_entries) {
+        if (he.he_addr == addr) {
+            name_out = he.he_names.front();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+dns_cache &dns_cache::singleton()
+{
+    static dns_cache retval(nullptr);
+
+    return retval;
+}
+
+dns_cache::dns_cache(shared_ptr<dns_resolver> resolver)
+    : dc_resolver(std::move(resolver))
+{
+}
+
+void dns_cache::set_resolver(shared_ptr<dns_resolver> resolver)
+{
+    this->dc_resolver = std::move(resolver);
+    this->clear();
+}
+
+string dns_cache::name_to_addr(const string &name)
+{
+    return this->lookup(this->dc_names, &dns_resolver::lookup_name, name);
+}
+
+string dns_cache::addr_to_name(const string &addr)
+{
+    return this->lookup(this->dc_addrs, &dns_resolver::lookup_addr, addr);
+}
+
+void dns_cache::clear()
+{
+    this->dc_names.clear();
+    this->dc_addrs.clear();
+}
+
+string dns_cache::lookup(lru_cache<string, cache_entry> &cache,
+                         lookup_func_t func,
+                         const string &key)
+{
+    time_t now = time(nullptr);
+    cache_entry *entry = cache.get(key);
+
+    if (entry != nullptr && now < entry->ce_expiration) {
+        return entry->ce_value;
+    }
+
+    if (!this->dc_resolver) {
+        this->dc_resolver = make_shared<system_dns_resolver>();
+    }
+
+    cache_entry new_entry;
+    bool found = ((*this->dc_resolver).*func)(key, new_entry.ce_value);
+
+    if (!found) {
+        new_entry.ce_value = key;
+    }
+    new_entry.ce_expiration = now + (found ? FOUND_TTL : NOT_FOUND_TTL);
+
+    return cache.put(key, new_entry).ce_value;
+}
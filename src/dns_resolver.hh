@@ -0,0 +1,149 @@
+/**
+ * Copyright (c) 2019, Timothy Stack
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * * Neither the name of Timothy Stack nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __dns_resolver_hh
+#define __dns_resolver_hh
+
+#include <time.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "lru_cache.hh"
+
+/**
+ * Interface for the services used to translate between hostnames and
+ * addresses.
+ */
+class dns_resolver {
+public:
+    virtual ~dns_resolver() = default;
+
+    /**
+     * @param name The hostname to look up.
+     * @param addr_out The textual form of the first address for the name.
+     * @return True if the name was found.
+     */
+    virtual bool lookup_name(const std::string &name,
+                             std::string &addr_out) = 0;
+
+    /**
+     * @param addr The textual form of an IPv4 or IPv6 address.
+     * @param name_out The hostname for the address.
+     * @return True if the address was found.
+     */
+    virtual bool lookup_addr(const std::string &addr,
+                             std::string &name_out) = 0;
+};
+
+/**
+ * Resolver that uses getaddrinfo(3) and getnameinfo(3).
+ */
+class system_dns_resolver : public dns_resolver {
+public:
+    bool lookup_name(const std::string &name, std::string &addr_out) override;
+
+    bool lookup_addr(const std::string &addr, std::string &name_out) override;
+};
+
+/**
+ * Resolver that only consults a file in the format of /etc/hosts, useful for
+ * testing without depending on the network.
+ */
+class hosts_file_resolver : public dns_resolver {
+public:
+    explicit hosts_file_resolver(const std::string &path);
+
+    bool lookup_name(const std::string &name, std::string &addr_out) override;
+
+    bool lookup_addr(const std::string &addr, std::string &name_out) override;
+
+private:
+    struct host_entry {
+        std::string he_addr;
+        std::vector<std::string> he_names;
+    };
+
+    std::vector<host_entry> hfr_entries;
+};
+
+/**
+ * Caches the results of a dns_resolver so that repeated lookups of the same
+ * name or address do not go back to the resolver until the entry expires.
+ * Failed lookups are also cached, but for a shorter time.
+ */
+class dns_cache {
+public:
+    static const size_t MAX_ENTRIES = 16 * 1024;
+    static const time_t FOUND_TTL = 10 * 60;
+    static const time_t NOT_FOUND_TTL = 60;
+
+    /**
+     * The cache used by the SQL functions.  The resolver is a
+     * system_dns_resolver unless another one is given with set_resolver().
+     */
+    static dns_cache &singleton();
+
+    explicit dns_cache(std::shared_ptr<dns_resolver> resolver);
+
+    void set_resolver(std::shared_ptr<dns_resolver> resolver);
+
+    /**
+     * @return The address for the name or the name if it could not be found.
+     */
+    std::string name_to_addr(const std::string &name);
+
+    /**
+     * @return The hostname for the address or the address if it could not be
+     *   found.
+     */
+    std::string addr_to_name(const std::string &addr);
+
+    void clear();
+
+private:
+    struct cache_entry {
+        std::string ce_value;
+        time_t ce_expiration;
+    };
+
+    typedef bool (dns_resolver::*lookup_func_t)(const std::string &,
+                                                std::string &);
+
+    std::string lookup(lru_cache<std::string, cache_entry> &cache,
+                       lookup_func_t func,
+                       const std::string &key);
+
+    std::shared_ptr<dns_resolver> dc_resolver;
+    lru_cache<std::string, cache_entry> dc_names{MAX_ENTRIES};
+    lru_cache<std::string, cache_entry> dc_addrs{MAX_ENTRIES};
+};
+
+#endif
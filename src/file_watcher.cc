@@ -0,0 +1,265 @@
+/**
+ * Copyright (c) 2019, Timothy Stack
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * * Neither the name of Timothy Stack nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#ifdef HAVE_SYS_INOTIFY_H
+#include <sys/inotify.h>
+#endif
+
+#include "auto_mem.hh"
+#include "base/lnav_log.hh"
+#include "lnav_util.hh"
+#include "file_watcher.hh"
+
+using namespace std;
+
+#ifdef HAVE_SYS_INOTIFY_H
+static const uint32_t WATCH_MASK = (IN_CREATE |
+                                    IN_DELETE |
+                                    IN_MODIFY |
+                                    IN_ATTRIB |
+                                    IN_MOVED_FROM |
+                                    IN_MOVED_TO |
+                                    IN_DELETE_SELF |
+                                    IN_MOVE_SELF);
+#endif
+
+static string dir_for_path(const string &path)
+{
+    size_t slash = path.rfind('/');
+
+    if (slash == string::npos) {
+        return ".";
+    }
+    if (slash == 0) {
+        return "/";
+    }
+
+    return path.substr(0, slash);
+}
+
+void file_watcher::init()
+{
+    this->fw_initialized = true;
+
+#ifdef HAVE_SYS_INOTIFY_H
+    this->fw_fd = inotify_init();
+    if (this->fw_fd == -1) {
+        log_warning("inotify is not available, polling for changes -- %s",
+                    strerror(errno));
+        return;
+    }
+
+    fcntl(this->fw_fd, F_SETFL, O_NONBLOCK);
+    fcntl(this->fw_fd, F_SETFD, FD_CLOEXEC);
+    log_info("watching for file changes with inotify");
+#endif
+}
+
+void file_watcher::update_poll_set(vector<struct pollfd> &pollfds)
+{
+    if (this->is_enabled()) {
+        pollfds.push_back((struct pollfd) {
+            this->fw_fd,
+            POLLIN,
+            0
+        });
+    }
+}
+
+void file_watcher::check_poll_set(const vector<struct pollfd> &pollfds)
+{
+#ifdef HAVE_SYS_INOTIFY_H
+    if (!this->is_enabled() || !pollfd_ready(pollfds, this->fw_fd)) {
+        return;
+    }
+
+    char buffer[4096]
+        __attribute__ ((aligned(__alignof__(struct inotify_event))));
+    ssize_t rc;
+
+    while ((rc = read(this->fw_fd, buffer, sizeof(buffer))) > 0) {
+        for (char *ptr = buffer; ptr < buffer + rc; ) {
+            auto *event = (const struct inotify_event *) ptr;
+
+            ptr += sizeof(struct inotify_event) + event->len;
+
+            if (event->mask & IN_Q_OVERFLOW) {
+                log_info("inotify queue overflowed, rescanning all files");
+                this->fw_full_scan = true;
+                this->fw_changes.c_all = true;
+                continue;
+            }
+
+            auto wd_iter = this->fw_wd_to_dirs.find(event->wd);
+
+            if (wd_iter == this->fw_wd_to_dirs.end()) {
+                continue;
+            }
+
+            if (event->mask & IN_IGNORED) {
+                // The directory was removed, watch it again if it comes back.
+                for (const auto &dir : wd_iter->second) {
+                    this->fw_dirs.erase(dir);
+                }
+                this->fw_wd_to_dirs.erase(wd_iter);
+                this->fw_full_scan = true;
+                this->fw_changes.c_all = true;
+                continue;
+            }
+
+            // The same directory can be reached through more than one name,
+            // inotify hands back the same descriptor for each of them.
+            for (const auto &dir : wd_iter->second) {
+                this->fw_dirs[dir].wd_changed = true;
+            }
+            if (event->len > 0) {
+                const string &canon_dir =
+                    this->fw_dirs[wd_iter->second.front()].wd_canonical_path;
+                string path = (canon_dir == "/" ? canon_dir : canon_dir + "/") +
+                              event->name;
+                struct stat st;
+
+                // The files are opened by their real path, but a file can
+                // also be reached through a link, so record the inode too.
+                if (stat(path.c_str(), &st) == 0) {
+                    this->fw_changes.c_inodes.emplace(st.st_dev, st.st_ino);
+                }
+                this->fw_changes.c_paths.insert(path);
+            }
+        }
+    }
+#endif
+}
+
+void file_watcher::begin_scan(time_t now)
+{
+    if (!this->fw_initialized) {
+        this->init();
+    }
+
+    if (!this->is_enabled() ||
+        (now - this->fw_last_full_scan) >= FULL_SCAN_INTERVAL) {
+        this->fw_full_scan = true;
+    }
+    if (this->fw_full_scan) {
+        this->fw_last_full_scan = now;
+    }
+}
+
+bool file_watcher::should_scan(const string &path)
+{
+    if (!this->is_enabled()) {
+        return true;
+    }
+
+    string dir = dir_for_path(path);
+
+    if (dir.find_first_of("*?[") != string::npos) {
+        // Can't watch a directory that is a pattern itself.
+        return true;
+    }
+
+    watched_dir &wd = this->watch_dir(dir);
+    bool first_time = this->fw_seen_paths.insert(path).second;
+
+    return this->fw_full_scan || first_time || wd.wd_changed ||
+           wd.wd_id == -1;
+}
+
+void file_watcher::end_scan()
+{
+    for (auto &dir_pair : this->fw_dirs) {
+        dir_pair.second.wd_changed = false;
+    }
+    this->fw_full_scan = false;
+}
+
+file_watcher::watched_dir &file_watcher::watch_dir(const string &dir)
+{
+    auto iter = this->fw_dirs.find(dir);
+
+    if (iter != this->fw_dirs.end()) {
+        return iter->second;
+    }
+
+    watched_dir &retval = this->fw_dirs[dir];
+    auto_mem<char> canon_path;
+
+    if ((canon_path = realpath(dir.c_str(), nullptr)) != nullptr) {
+        retval.wd_canonical_path = canon_path.in();
+    }
+    else {
+        retval.wd_canonical_path = dir;
+    }
+
+#ifdef HAVE_SYS_INOTIFY_H
+    retval.wd_id = inotify_add_watch(this->fw_fd, dir.c_str(), WATCH_MASK);
+    if (retval.wd_id == -1) {
+        log_warning("unable to watch directory, polling instead: %s -- %s",
+                    dir.c_str(), strerror(errno));
+        this->fw_has_unwatched_dir = true;
+    }
+    else {
+        log_debug("watching directory: %s", dir.c_str());
+        this->fw_wd_to_dirs[retval.wd_id].push_back(dir);
+    }
+#endif
+
+    return retval;
+}
+
+file_watcher::changes file_watcher::take_changes(time_t now)
+{
+    changes retval;
+
+    if (!this->fw_initialized) {
+        this->init();
+    }
+
+    if (!this->is_enabled() ||
+        this->fw_has_unwatched_dir ||
+        (now - this->fw_last_all_changes) >= FULL_SCAN_INTERVAL) {
+        this->fw_changes.c_all = true;
+    }
+    if (this->fw_changes.c_all) {
+        this->fw_last_all_changes = now;
+    }
+
+    std::swap(retval, this->fw_changes);
+
+    return retval;
+}
@@ -0,0 +1,158 @@
+/**
+ * Copyright (c) 2019, Timothy Stack
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * * Neither the name of Timothy Stack nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __file_watcher_hh
+#define __file_watcher_hh
+
+#include <poll.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "auto_fd.hh"
+
+/**
+ * Tracks changes to the directories that contain the files being viewed so
+ * that the main loop only needs to re-expand the glob patterns and stat the
+ * files in directories that have actually changed.  On systems without
+ * inotify, or for paths that cannot be watched, every path is reported as
+ * changed on every scan, which is the same as polling.
+ */
+class file_watcher {
+public:
+    /**
+     * The number of seconds between scans that treat every path as changed.
+     * Some filesystems, like NFS, do not report changes made by other hosts,
+     * so those are still picked up eventually.
+     */
+    static const time_t FULL_SCAN_INTERVAL = 10;
+
+    /**
+     * The files that changed between two calls to take_changes().
+     */
+    struct changes {
+        /**
+         * @param path The real path of the file.
+         * @param st The result of a stat() of the file.
+         * @return True if the file has changed.
+         */
+        bool contains(const std::string &path, const struct stat &st) const {
+            return this->c_all ||
+                   this->c_paths.count(path) > 0 ||
+                   this->c_inodes.count(std::make_pair(st.st_dev,
+                                                       st.st_ino)) > 0;
+        };
+
+        bool empty() const {
+            return !this->c_all && this->c_paths.empty();
+        };
+
+        /** True if the changes are not known and every file should be checked. */
+        bool c_all{false};
+        /** The real paths of the changed files. */
+        std::set<std::string> c_paths;
+        /** The device and inode numbers of the changed files. */
+        std::set<std::pair<dev_t, ino_t>> c_inodes;
+    };
+
+    file_watcher() = default;
+
+    /**
+     * @return True if changes are reported by the kernel instead of being
+     *   found by polling.
+     */
+    bool is_enabled() const {
+        return this->fw_fd != -1;
+    };
+
+    void update_poll_set(std::vector<struct pollfd> &pollfds);
+
+    /**
+     * Read any pending change notifications.
+     */
+    void check_poll_set(const std::vector<struct pollfd> &pollfds);
+
+    /**
+     * Start a scan of the paths being viewed.
+     *
+     * @param now The current time.
+     */
+    void begin_scan(time_t now);
+
+    /**
+     * Check if a path needs to be looked at during this scan.  The directory
+     * containing the path is watched from now on.
+     *
+     * @param path A file name or glob pattern.
+     * @return True if the path has not been seen before or its directory
+     *   has changed since the last scan.
+     */
+    bool should_scan(const std::string &path);
+
+    /**
+     * Finish a scan and forget the changes that were reported before it.
+     */
+    void end_scan();
+
+    /**
+     * Get the files that have changed since the last call.
+     *
+     * @param now The current time.
+     * @return The changed files.
+     */
+    changes take_changes(time_t now);
+
+private:
+    struct watched_dir {
+        int wd_id{-1};
+        bool wd_changed{true};
+        std::string wd_canonical_path;
+    };
+
+    void init();
+
+    watched_dir &watch_dir(const std::string &dir);
+
+    bool fw_initialized{false};
+    auto_fd fw_fd;
+    bool fw_full_scan{true};
+    time_t fw_last_full_scan{0};
+    std::map<std::string, watched_dir> fw_dirs;
+    std::map<int, std::vector<std::string>> fw_wd_to_dirs;
+    std::set<std::string> fw_seen_paths;
+    bool fw_has_unwatched_dir{false};
+    time_t fw_last_all_changes{0};
+    changes fw_changes;
+};
+
+#endif
@@ -144,9 +144,12 @@ void grep_proc<LineType>::start()
 
     /*
      * Restore the default signal handlers so we don't hang around
-     * forever if there is a problem.
+     * forever if there is a problem.  SIGINT is ignored since the child is
+     * in the foreground process group and a Ctrl-C is meant for the parent,
+     * which uses it to cancel a query.  The parent will send a SIGTERM or
+     * close the pipes when the search should stop.
      */
-    signal(SIGINT, SIG_DFL);
+    signal(SIGINT, SIG_IGN);
     signal(SIGTERM, SIG_DFL);
 
     this->child_init();
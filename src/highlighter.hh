@@ -32,11 +32,71 @@
 #ifndef __highlighter_hh
 #define __highlighter_hh
 
+#include <ctype.h>
+#include <stdint.h>
+#include <string.h>
+
 #include "optional.hpp"
 #include "pcrepp/pcrepp.hh"
 #include "text_format.hh"
 #include "view_curses.hh"
 
+/**
+ * The set of byte values that occur in a string.  A line is scanned once to
+ * build the set and then each highlighter can check whether the bytes its
+ * pattern requires are present before running the regex.
+ */
+struct byte_set {
+    byte_set() {
+        this->clear();
+    };
+
+    void clear() {
+        memset(this->bs_bits, 0, sizeof(this->bs_bits));
+    };
+
+    void add(unsigned char ch) {
+        this->bs_bits[ch >> 6U] |= (1ULL << (ch & 0x3fU));
+    };
+
+    void add(const char *str, size_t len) {
+        for (size_t lpc = 0; lpc < len; lpc++) {
+            this->add((unsigned char) str[lpc]);
+        }
+    };
+
+    void add_table(const unsigned char *table) {
+        // The PCRE start bitmap is 32 bytes with the low bit of each byte
+        // standing for the lowest character value.
+        for (int ch = 0; ch < 256; ch++) {
+            if (table[ch / 8] & (1U << (ch % 8))) {
+                this->add(ch);
+            }
+        }
+    };
+
+    bool contains(unsigned char ch) const {
+        return (this->bs_bits[ch >> 6U] & (1ULL << (ch & 0x3fU))) != 0;
+    };
+
+    bool contains_nocase(unsigned char ch) const {
+        return this->contains(ch) ||
+               (ch < 128 && (this->contains(tolower(ch)) ||
+                             this->contains(toupper(ch))));
+    };
+
+    bool intersects(const byte_set &other) const {
+        for (int lpc = 0; lpc < 4; lpc++) {
+            if (this->bs_bits[lpc] & other.bs_bits[lpc]) {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    uint64_t bs_bits[4];
+};
+
 struct highlighter {
     highlighter()
         : h_code(nullptr),
@@ -108,6 +168,72 @@ struct highlighter {
             extra->match_limit           = 10000;
             extra->match_limit_recursion = 500;
         }
+        this->compute_prefilter();
+    };
+
+    /**
+     * Collect the facts that PCRE has already worked out about the compiled
+     * pattern: the shortest possible match, a byte that has to appear in
+     * every match, and the set of bytes a match can start with.
+     */
+    void compute_prefilter() {
+        const unsigned char *first_table = nullptr;
+        int min_length = -1, last_literal = -1, first_byte = -2;
+
+        this->h_min_length = 0;
+        this->h_required_byte = -1;
+        this->h_has_first_set = false;
+        this->h_first_set.clear();
+
+        if (this->h_code == nullptr) {
+            return;
+        }
+
+        if (pcre_fullinfo(this->h_code, this->h_code_extra,
+                          PCRE_INFO_MINLENGTH, &min_length) == 0 &&
+            min_length > 0) {
+            this->h_min_length = min_length;
+        }
+        if (pcre_fullinfo(this->h_code, this->h_code_extra,
+                          PCRE_INFO_LASTLITERAL, &last_literal) == 0 &&
+            last_literal >= 0 && last_literal < 128) {
+            this->h_required_byte = last_literal;
+        }
+        if (pcre_fullinfo(this->h_code, this->h_code_extra,
+                          PCRE_INFO_FIRSTBYTE, &first_byte) == 0 &&
+            first_byte >= 0 && first_byte < 128) {
+            this->h_first_set.add(first_byte);
+            this->h_first_set.add(tolower(first_byte));
+            this->h_first_set.add(toupper(first_byte));
+            this->h_has_first_set = true;
+        } else if (pcre_fullinfo(this->h_code, this->h_code_extra,
+                                 PCRE_INFO_FIRSTTABLE, &first_table) == 0 &&
+                   first_table != nullptr) {
+            this->h_first_set.add_table(first_table);
+            this->h_has_first_set = true;
+        }
+    };
+
+    /**
+     * Check if this highlighter could match anything in a line.
+     *
+     * @param present The bytes that are in the line.
+     * @param len The length of the part of the line to be highlighted.
+     * @return False if the pattern cannot possibly match.
+     */
+    bool might_match(const byte_set &present, size_t len) const {
+        if (len < this->h_min_length) {
+            return false;
+        }
+        if (this->h_required_byte != -1 &&
+            !present.contains_nocase(this->h_required_byte)) {
+            return false;
+        }
+        if (this->h_has_first_set && !present.intersects(this->h_first_set)) {
+            return false;
+        }
+
+        return true;
     };
 
     highlighter &with_pattern(const std::string &pattern) {
@@ -221,6 +347,10 @@ struct highlighter {
     int h_attrs;
     text_format_t h_text_format;
     intern_string_t h_format_name;
+    size_t h_min_length{0};
+    int h_required_byte{-1};
+    bool h_has_first_set{false};
+    byte_set h_first_set;
 };
 
 #endif
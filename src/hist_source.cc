@@ -38,30 +38,16 @@ const char *hist_source2::LINE_FORMAT = " %8d normal  %8d errors  %8d warnings
 
 int hist_source2::row_for_time(struct timeval tv_bucket)
 {
-    std::map<int64_t, struct bucket_block>::iterator iter;
-    int retval = 0;
-    time_t time_bucket = rounddown(tv_bucket.tv_sec, this->hs_time_slice);
+    const hist_level &level = this->current_level();
+    time_t time_bucket = rounddown(tv_bucket.tv_sec, level.hl_time_slice);
+    auto iter = lower_bound(level.hl_buckets.begin(),
+                            level.hl_buckets.end(),
+                            time_bucket,
+                            [](const bucket_t &lhs, time_t rhs) {
+                                return lhs.b_time < rhs;
+                            });
 
-    for (iter = this->hs_blocks.begin();
-         iter != this->hs_blocks.end();
-         ++iter) {
-        struct bucket_block &bb = iter->second;
-
-        if (time_bucket < bb.bb_buckets[0].b_time) {
-            break;
-        }
-        if (time_bucket > bb.bb_buckets[bb.bb_used].b_time) {
-            retval += bb.bb_used + 1;
-            continue;
-        }
-
-        for (unsigned int lpc = 0; lpc <= bb.bb_used; lpc++, retval++) {
-            if (time_bucket <= bb.bb_buckets[lpc].b_time) {
-                return retval;
-            }
-        }
-    }
-    return retval;
+    return distance(level.hl_buckets.begin(), iter);
 }
 
 void hist_source2::text_value_for_line(textview_curses &tc, int row,
@@ -101,7 +87,7 @@ void hist_source2::text_attrs_for_line(textview_curses &tc, int row,
     int left = 0;
 
     for (int lpc = 0; lpc < HT__MAX; lpc++) {
-        this->hs_chart.chart_attrs_for_value(
+        this->current_level().hl_chart.chart_attrs_for_value(
             tc, left, (const hist_type_t) lpc,
             bucket.b_values[lpc].hv_value,
             value_out);
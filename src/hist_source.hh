@@ -326,14 +326,16 @@ public:
         HT__MAX
     } hist_type_t;
 
-    hist_source2() : hs_time_slice(10 * 60) {
+    hist_source2() {
+        this->hs_levels.emplace_back(10 * 60);
         this->clear();
     };
 
     void init() {
         view_colors &vc = view_colors::singleton();
 
-        this->hs_chart
+        for (auto &level : this->hs_levels) {
+            level.hl_chart
                 .with_attrs_for_ident(HT_NORMAL,
                                       vc.attrs_for_role(view_colors::VCR_TEXT))
                 .with_attrs_for_ident(HT_WARNING,
@@ -342,18 +344,57 @@ public:
                                       vc.attrs_for_role(view_colors::VCR_ERROR))
                 .with_attrs_for_ident(HT_MARK,
                                       vc.attrs_for_role(view_colors::VCR_KEYWORD));
+        }
     };
 
-    void set_time_slice(int64_t slice) {
-        this->hs_time_slice = slice;
+    /**
+     * Set the time slices that counts are kept for.  All of the levels are
+     * updated as values are added so that switching between them does not
+     * require the log to be indexed again.  Any existing data is cleared.
+     *
+     * @param slices The slices, in seconds, from finest to coarsest.
+     * @param count The number of slices.
+     */
+    void set_time_slices(const int *slices, size_t count) {
+        require(count > 0);
+
+        this->hs_levels.clear();
+        for (size_t lpc = 0; lpc < count; lpc++) {
+            this->hs_levels.emplace_back(slices[lpc]);
+        }
+        this->hs_current_level = 0;
+        this->clear();
+    };
+
+    /**
+     * Select the level of the histogram to display.  If there is no level
+     * with the given slice, the histogram is reset to only that slice and
+     * the log needs to be indexed again.
+     *
+     * @param slice The time slice in seconds.
+     * @return True if an existing level was selected.
+     */
+    bool set_time_slice(int64_t slice) {
+        for (size_t lpc = 0; lpc < this->hs_levels.size(); lpc++) {
+            if (this->hs_levels[lpc].hl_time_slice == slice) {
+                this->hs_current_level = lpc;
+                return true;
+            }
+        }
+
+        this->hs_levels.clear();
+        this->hs_levels.emplace_back(slice);
+        this->hs_current_level = 0;
+        this->clear();
+        return false;
     };
 
     int64_t get_time_slice() const {
-        return this->hs_time_slice;
+        return this->current_level().hl_time_slice;
     };
 
     size_t text_line_count() {
-        return this->hs_line_count;
+        return this->current_level().hl_buckets.size();
     };
 
     size_t text_line_width(textview_curses &curses) {
@@ -361,39 +402,30 @@ public:
     };
 
     void clear() {
-        this->hs_line_count = 0;
-        this->hs_last_bucket = -1;
-        this->hs_last_row = -1;
-        this->hs_blocks.clear();
-        this->hs_chart.clear();
+        for (auto &level : this->hs_levels) {
+            level.hl_last_row = -1;
+            level.hl_buckets.clear();
+            level.hl_chart.clear();
+        }
         this->init();
     };
 
     void add_value(time_t row, hist_type_t htype, double value = 1.0) {
-        require(row >= this->hs_last_row);
+        for (auto &level : this->hs_levels) {
+            require(row >= level.hl_last_row);
 
-        row = rounddown(row, this->hs_time_slice);
-        if (row != this->hs_last_row) {
-            this->end_of_row();
+            time_t level_row = rounddown(row, level.hl_time_slice);
 
-            this->hs_last_bucket += 1;
-            this->hs_last_row = row;
-        }
+            if (level_row != level.hl_last_row) {
+                level.end_of_row();
 
-        bucket_t &bucket = this->find_bucket(this->hs_last_bucket);
-        bucket.b_time = row;
-        bucket.b_values[htype].hv_value += value;
-    };
-
-    void end_of_row() {
-        if (this->hs_last_bucket >= 0) {
-            bucket_t &last_bucket = this->find_bucket(this->hs_last_bucket);
-
-            for (int lpc = 0; lpc < HT__MAX; lpc++) {
-                this->hs_chart.add_value(
-                        (const hist_type_t) lpc,
-                        last_bucket.b_values[lpc].hv_value);
+                level.hl_buckets.emplace_back();
+                level.hl_last_row = level_row;
             }
+
+            bucket_t &bucket = level.hl_buckets.back();
+            bucket.b_time = level_row;
+            bucket.b_values[htype].hv_value += value;
         }
     };
 
@@ -412,7 +444,7 @@ public:
 
     struct timeval time_for_row(int row) {
         require(row >= 0);
-        require(row < this->hs_line_count);
+        require((size_t) row < this->text_line_count());
 
         bucket_t &bucket = this->find_bucket(row);
 
@@ -429,35 +461,56 @@ private:
     };
 
     struct bucket_t {
+        bucket_t() : b_time(0) {
+            memset(this->b_values, 0, sizeof(this->b_values));
+        };
+
         time_t b_time;
         hist_value b_values[HT__MAX];
     };
 
-    static const int64_t BLOCK_SIZE = 100;
+    /**
+     * The buckets for a single time slice.  The buckets are appended in time
+     * order, so they can be kept in a flat array and binary searched.
+     */
+    struct hist_level {
+        explicit hist_level(int64_t slice) : hl_time_slice(slice) {
+        };
+
+        void end_of_row() {
+            if (this->hl_buckets.empty()) {
+                return;
+            }
+
+            const bucket_t &last_bucket = this->hl_buckets.back();
 
-    struct bucket_block {
-        bucket_block() : bb_used(0) {
-            memset(this->bb_buckets, 0, sizeof(this->bb_buckets));
+            for (int lpc = 0; lpc < HT__MAX; lpc++) {
+                this->hl_chart.add_value(
+                    (const hist_type_t) lpc,
+                    last_bucket.b_values[lpc].hv_value);
+            }
         };
 
-        unsigned int bb_used;
-        bucket_t bb_buckets[BLOCK_SIZE];
+        int64_t hl_time_slice;
+        time_t hl_last_row{-1};
+        std::vector<bucket_t> hl_buckets;
+        stacked_bar_chart<hist_type_t> hl_chart;
+    };
+
+    hist_level &current_level() {
+        return this->hs_levels[this->hs_current_level];
+    };
+
+    const hist_level &current_level() const {
+        return this->hs_levels[this->hs_current_level];
     };
 
     bucket_t &find_bucket(int64_t index) {
-        struct bucket_block &bb = this->hs_blocks[index / BLOCK_SIZE];
-        unsigned int intra_block_index = index % BLOCK_SIZE;
-        bb.bb_used = std::max(intra_block_index, bb.bb_used);
-        this->hs_line_count = std::max(this->hs_line_count, index + 1);
-        return bb.bb_buckets[intra_block_index];
-    };
-
-    int64_t hs_time_slice;
-    int64_t hs_line_count;
-    int64_t hs_last_bucket;
-    time_t hs_last_row;
-    std::map<int64_t, struct bucket_block> hs_blocks;
-    stacked_bar_chart<hist_type_t> hs_chart;
+        return this->current_level().hl_buckets[index];
+    };
+
+    std::vector<hist_level> hs_levels;
+    size_t hs_current_level{0};
 };
 
 #endif
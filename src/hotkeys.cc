@@ -943,8 +943,7 @@ void handle_paging_key(int ch)
 
                     snprintf(linestr, sizeof(linestr), "%d", line_number);
                     for (row = 0; row < dls.dls_rows.size(); row++) {
-                        if (strcmp(dls.dls_rows[row][log_line_index],
-                                   linestr) == 0) {
+                        if (dls.get_cell(row, log_line_index) == linestr) {
                             vis_line_t db_line(row);
 
                             db_tc->set_top(db_line);
@@ -966,7 +965,7 @@ void handle_paging_key(int ch)
                 if (log_line_index != -1) {
                     unsigned int line_number;
 
-                    if (sscanf(dls.dls_rows[db_row][log_line_index],
+                    if (sscanf(dls.get_cell(db_row, log_line_index).c_str(),
                                "%d",
                                &line_number) &&
                         line_number < tc->listview_rows(*tc)) {
@@ -979,8 +978,9 @@ void handle_paging_key(int ch)
                         date_time_scanner dts;
                         struct timeval tv;
                         struct exttm tm;
-                        const char *col_value = dls.dls_rows[db_row][lpc];
-                        size_t col_len = strlen(col_value);
+                        std::string col_str = dls.get_cell(db_row, lpc);
+                        const char *col_value = col_str.c_str();
+                        size_t col_len = col_str.length();
 
                         if (dts.scan(col_value, col_len, NULL, &tm, tv) != NULL) {
                             vis_line_t vl;
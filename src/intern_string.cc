@@ -33,10 +33,22 @@
 
 #include <string.h>
 
+#include <atomic>
+#include <mutex>
+
 #include "intern_string.hh"
 
 const static int TABLE_SIZE = 4095;
-static intern_string *TABLE[TABLE_SIZE];
+const static int LOCK_COUNT = 64;
+
+/*
+ * Lookups read the buckets without taking a lock.  Entries are never
+ * removed and are fully built before being published with a release store,
+ * so a reader always sees a consistent chain.  Inserts are serialized by a
+ * lock that covers a subset of the buckets.
+ */
+static std::atomic<intern_string *> TABLE[TABLE_SIZE];
+static std::mutex TABLE_LOCKS[LOCK_COUNT];
 
 unsigned long
 hash_str(const char *str, size_t len)
@@ -54,29 +66,56 @@ hash_str(const char *str, size_t len)
 const intern_string *intern_string::lookup(const char *str, ssize_t len)
 {
     unsigned long h;
-    intern_string *curr;
+    std::atomic<intern_string *> *bucket;
+    intern_string *head;
 
     if (len == -1) {
         len = strlen(str);
     }
-    h = hash_str(str, len) % TABLE_SIZE;
+    h = hash_str(str, len);
+    bucket = &TABLE[h % TABLE_SIZE];
 
-    curr = TABLE[h];
-    while (curr != NULL) {
-        if (curr->is_len == len && strncmp(curr->is_str, str, len) == 0) {
-            return curr;
+    auto find_in_chain = [str, len, h](intern_string *curr) {
+        while (curr != nullptr) {
+            if (curr->is_hash == h &&
+                curr->is_len == len &&
+                memcmp(curr->is_str, str, len) == 0) {
+                return curr;
+            }
+            curr = curr->is_next;
+        }
+
+        return curr;
+    };
+
+    head = bucket->load(std::memory_order_acquire);
+
+    intern_string *retval = find_in_chain(head);
+
+    if (retval != nullptr) {
+        return retval;
+    }
+
+    std::lock_guard<std::mutex> lg(TABLE_LOCKS[(h % TABLE_SIZE) % LOCK_COUNT]);
+
+    // Another thread might have added the string while we were waiting.
+    intern_string *curr_head = bucket->load(std::memory_order_acquire);
+
+    if (curr_head != head) {
+        retval = find_in_chain(curr_head);
+        if (retval != nullptr) {
+            return retval;
         }
-        curr = curr->is_next;
     }
 
     char *strcp = new char[len + 1];
     memcpy(strcp, str, len);
     strcp[len] = '\0';
-    curr = new intern_string(strcp, len);
-    curr->is_next = TABLE[h];
-    TABLE[h] = curr;
+    retval = new intern_string(strcp, len, h);
+    retval->is_next = curr_head;
+    bucket->store(retval, std::memory_order_release);
 
-    return curr;
+    return retval;
 }
 
 const intern_string *intern_string::lookup(const string_fragment &sf)
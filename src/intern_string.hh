@@ -35,11 +35,15 @@
 #include <string.h>
 #include <sys/types.h>
 
+#include <functional>
 #include <string>
 
 #include "strnatcmp.h"
 
 struct string_fragment {
+    string_fragment() : sf_string(nullptr), sf_begin(-1), sf_end(-1) {
+    };
+
     explicit string_fragment(const char *str, int begin = 0, int end = -1)
         : sf_string(str), sf_begin(begin), sf_end(end == -1 ? strlen(str) : end) {
     };
@@ -169,6 +173,14 @@ public:
         return std::string(this->is_str, this->is_len);
     }
 
+    /**
+     * @return The hash of the string, which is computed once when the
+     * string is interned.
+     */
+    unsigned long hash() const {
+        return this->is_hash;
+    }
+
     bool startswith(const char *prefix) const {
         const char *curr = this->is_str;
 
@@ -181,14 +193,15 @@ public:
     }
 
 private:
-    intern_string(const char *str, ssize_t len)
-            : is_next(nullptr), is_str(str), is_len(len) {
+    intern_string(const char *str, ssize_t len, unsigned long hash)
+            : is_next(nullptr), is_str(str), is_len(len), is_hash(hash) {
 
     }
 
     intern_string *is_next;
     const char *is_str;
     ssize_t is_len;
+    unsigned long is_hash;
 };
 
 class intern_string_t {
@@ -240,6 +253,13 @@ public:
         return this->ist_interned_string->to_string();
     }
 
+    unsigned long hash() const {
+        if (this->ist_interned_string == nullptr) {
+            return 0;
+        }
+        return this->ist_interned_string->hash();
+    }
+
     bool operator<(const intern_string_t &rhs) const {
         return strcmp(this->get(), rhs.get()) < 0;
     }
@@ -293,6 +313,24 @@ namespace std {
     inline string to_string(const intern_string_t &s) {
         return s.to_string();
     }
+
+    /**
+     * Interned strings are equal only if they are the same object, so the
+     * hash computed when the string was interned can be used as is.
+     */
+    template<>
+    struct hash<intern_string_t> {
+        size_t operator()(const intern_string_t &ist) const {
+            return ist.hash();
+        }
+    };
+
+    template<>
+    struct hash<const intern_string_t> {
+        size_t operator()(const intern_string_t &ist) const {
+            return ist.hash();
+        }
+    };
 }
 
 inline string_fragment to_string_fragment(const string_fragment &s) {
@@ -36,16 +36,18 @@
 #include <sys/types.h>
 #include <stdint.h>
 
+#include <memory>
 #include <string>
+#include <vector>
 
 #include "sqlite3.h"
 
 #include "yajlpp/yajlpp.hh"
-#include "yajlpp/json_op.hh"
 #include "mapbox/variant.hpp"
 #include "vtab_module.hh"
 
 #include "yajl/api/yajl_gen.h"
+#include "yajl/api/yajl_tree.h"
 #include "sqlite-extension-func.hh"
 
 using namespace std;
@@ -53,15 +55,6 @@ using namespace mapbox;
 
 #define JSON_SUBTYPE  74    /* Ascii for "J" */
 
-class sql_json_op : public json_op {
-public:
-    sql_json_op(json_ptr &ptr) : json_op(ptr), sjo_type(-1), sjo_int(0) { };
-
-    int sjo_type;
-    string sjo_str;
-    int sjo_int;
-};
-
 static void null_or_default(sqlite3_context *context, int argc, sqlite3_value **argv)
 {
     if (argc > 2) {
@@ -127,143 +120,335 @@ static bool json_contains(const char *json_in, sqlite3_value *value)
     return cu.cu_result;
 }
 
-static int gen_handle_null(void *ctx)
+/**
+ * The number of parsed JSON documents that are kept around so that several
+ * jget() calls on the same value only need to parse it once.
+ */
+static const size_t JSON_DOC_CACHE_SIZE = 4;
+
+/**
+ * A JSON pointer that has been split into its components so that it can be
+ * resolved against a parsed document without rescanning the pointer string.
+ */
+class compiled_json_ptr {
+public:
+    struct component {
+        string c_key;
+        int c_index{-1};
+        bool c_valid_index{false};
+        bool c_invalid_escape{false};
+        /** The text of the pointer starting at this component. */
+        string c_rest;
+    };
+
+    explicit compiled_json_ptr(const char *ptr_in) {
+        if (ptr_in[0] == '\0') {
+            return;
+        }
+        if (ptr_in[0] != '/') {
+            this->cjp_valid = false;
+            return;
+        }
+
+        const char *pos = ptr_in;
+
+        while (*pos == '/') {
+            const char *comp_start = pos + 1;
+            const char *comp_end = strchr(comp_start, '/');
+            component comp;
+            int offset;
+
+            if (comp_end == nullptr) {
+                comp_end = comp_start + strlen(comp_start);
+            }
+            comp.c_rest = comp_start;
+            for (const char *ch = comp_start; ch < comp_end; ch++) {
+                if (*ch != '~') {
+                    comp.c_key.push_back(*ch);
+                    continue;
+                }
+
+                switch (ch[1]) {
+                    case '0':
+                        comp.c_key.push_back('~');
+                        ch += 1;
+                        break;
+                    case '1':
+                        comp.c_key.push_back('/');
+                        ch += 1;
+                        break;
+                    default:
+                        comp.c_invalid_escape = true;
+                        break;
+                }
+            }
+
+            if (sscanf(comp_start, "%d%n", &comp.c_index, &offset) == 1 &&
+                comp_start + offset == comp_end) {
+                comp.c_valid_index = true;
+            }
+
+            this->cjp_components.emplace_back(std::move(comp));
+            pos = comp_end;
+        }
+    };
+
+    /**
+     * Find the value in the document that this pointer refers to.
+     *
+     * @param root The root of the parsed document.
+     * @param error_out Set if the pointer could not be applied to the
+     *   document.
+     * @return The value or nullptr if there is no such value.
+     */
+    yajl_val resolve(yajl_val root, string &error_out) const {
+        yajl_val retval = root;
+
+        if (!this->cjp_valid) {
+            return nullptr;
+        }
+
+        for (const auto &comp : this->cjp_components) {
+            if (YAJL_IS_OBJECT(retval)) {
+                yajl_val next = nullptr;
+
+                if (retval->u.object.len == 0) {
+                    return nullptr;
+                }
+                if (comp.c_invalid_escape) {
+                    error_out = "invalid escape sequence near -- " +
+                                comp.c_rest;
+                    return nullptr;
+                }
+                for (size_t lpc = 0; lpc < retval->u.object.len; lpc++) {
+                    if (comp.c_key == retval->u.object.keys[lpc]) {
+                        next = retval->u.object.values[lpc];
+                        break;
+                    }
+                }
+                retval = next;
+            }
+            else if (YAJL_IS_ARRAY(retval)) {
+                if (!comp.c_valid_index ||
+                    comp.c_index < 0 ||
+                    (size_t) comp.c_index >= retval->u.array.len) {
+                    return nullptr;
+                }
+                retval = retval->u.array.values[comp.c_index];
+            }
+            else {
+                return nullptr;
+            }
+
+            if (retval == nullptr) {
+                return nullptr;
+            }
+        }
+
+        return retval;
+    };
+
+    bool cjp_valid{true};
+    std::vector<component> cjp_components;
+};
+
+static void free_compiled_json_ptr(void *ptr)
 {
-    sql_json_op *sjo = (sql_json_op *)ctx;
-    yajl_gen gen = (yajl_gen)sjo->jo_ptr_data;
+    delete (compiled_json_ptr *) ptr;
+}
+
+struct json_doc_cache_entry {
+    const char *jdce_ptr{nullptr};
+    size_t jdce_len{0};
+    string jdce_text;
+    std::shared_ptr<yajl_val_s> jdce_tree;
+    size_t jdce_last_used{0};
+};
 
-    if (sjo->jo_ptr.jp_state == json_ptr::MS_DONE) {
-        sjo->sjo_type = SQLITE_NULL;
+/**
+ * Get the parsed form of a JSON document.  The cache is keyed by the address
+ * and length of the value, the text is also compared since SQLite can reuse
+ * the same buffer for the values in different rows.
+ *
+ * @return The parsed document or nullptr if the text is not valid JSON.
+ */
+static yajl_val find_parsed_doc(const char *json_in, size_t len)
+{
+    static json_doc_cache_entry CACHE[JSON_DOC_CACHE_SIZE];
+    static size_t USE_COUNTER = 0;
+
+    json_doc_cache_entry *victim = &CACHE[0];
+
+    USE_COUNTER += 1;
+    for (auto &entry : CACHE) {
+        if (entry.jdce_ptr == json_in &&
+            entry.jdce_len == len &&
+            entry.jdce_tree &&
+            memcmp(entry.jdce_text.data(), json_in, len) == 0) {
+            entry.jdce_last_used = USE_COUNTER;
+            return entry.jdce_tree.get();
+        }
+        if (entry.jdce_last_used < victim->jdce_last_used) {
+            victim = &entry;
+        }
     }
-    else {
-        sjo->jo_ptr_error_code = yajl_gen_null(gen);
+
+    yajl_val tree = yajl_tree_parse(json_in, nullptr, 0);
+
+    if (tree == nullptr) {
+        return nullptr;
     }
 
-    return sjo->jo_ptr_error_code == yajl_gen_status_ok;
+    victim->jdce_ptr = json_in;
+    victim->jdce_len = len;
+    victim->jdce_text.assign(json_in, len);
+    victim->jdce_tree.reset(tree, yajl_tree_free);
+    victim->jdce_last_used = USE_COUNTER;
+
+    return tree;
 }
 
-static int gen_handle_boolean(void *ctx, int boolVal)
+static void gen_tree(yajl_gen gen, yajl_val val)
 {
-    sql_json_op *sjo = (sql_json_op *)ctx;
-    yajl_gen gen = (yajl_gen)sjo->jo_ptr_data;
+    switch (val->type) {
+        case yajl_t_string:
+            yajl_gen_string(gen,
+                            (const unsigned char *) val->u.string,
+                            strlen(val->u.string));
+            break;
+        case yajl_t_number:
+            yajl_gen_number(gen, val->u.number.r, strlen(val->u.number.r));
+            break;
+        case yajl_t_object:
+            yajl_gen_map_open(gen);
+            for (size_t lpc = 0; lpc < val->u.object.len; lpc++) {
+                const char *key = val->u.object.keys[lpc];
 
-    if (sjo->jo_ptr.jp_state == json_ptr::MS_DONE) {
-        sjo->sjo_type = SQLITE_INTEGER;
-        sjo->sjo_int = boolVal;
-    }
-    else {
-        sjo->jo_ptr_error_code = yajl_gen_bool(gen, boolVal);
+                yajl_gen_string(gen, (const unsigned char *) key, strlen(key));
+                gen_tree(gen, val->u.object.values[lpc]);
+            }
+            yajl_gen_map_close(gen);
+            break;
+        case yajl_t_array:
+            yajl_gen_array_open(gen);
+            for (size_t lpc = 0; lpc < val->u.array.len; lpc++) {
+                gen_tree(gen, val->u.array.values[lpc]);
+            }
+            yajl_gen_array_close(gen);
+            break;
+        case yajl_t_true:
+            yajl_gen_bool(gen, 1);
+            break;
+        case yajl_t_false:
+            yajl_gen_bool(gen, 0);
+            break;
+        case yajl_t_null:
+        default:
+            yajl_gen_null(gen);
+            break;
     }
-
-    return sjo->jo_ptr_error_code == yajl_gen_status_ok;
 }
 
-static int gen_handle_string(void *ctx, const unsigned char * stringVal, size_t len)
+static void jget_result(sqlite3_context *context,
+                        int argc, sqlite3_value **argv,
+                        const compiled_json_ptr &jp)
 {
-    sql_json_op *sjo = (sql_json_op *)ctx;
-    yajl_gen gen = (yajl_gen)sjo->jo_ptr_data;
+    const char *json_in = (const char *)sqlite3_value_text(argv[0]);
+    size_t json_len = sqlite3_value_bytes(argv[0]);
+    yajl_val root = find_parsed_doc(json_in, json_len);
+
+    if (root == nullptr) {
+        auto_mem<yajl_handle_t> handle(yajl_free);
+        yajl_callbacks cb;
+
+        memset(&cb, 0, sizeof(cb));
+        handle = yajl_alloc(&cb, nullptr, nullptr);
+        if (yajl_parse(handle.in(),
+                       (const unsigned char *) json_in,
+                       json_len) == yajl_status_ok) {
+            yajl_complete_parse(handle.in());
+        }
 
-    if (sjo->jo_ptr.jp_state == json_ptr::MS_DONE) {
-        sjo->sjo_type = SQLITE3_TEXT;
-        sjo->sjo_str = string((char *)stringVal, len);
-    }
-    else {
-        sjo->jo_ptr_error_code = yajl_gen_string(gen, stringVal, len);
+        unsigned char *err = yajl_get_error(
+            handle.in(), 0, (const unsigned char *) json_in, json_len);
+
+        sqlite3_result_error(context, (const char *) err, -1);
+        yajl_free_error(handle.in(), err);
+        return;
     }
 
-    return sjo->jo_ptr_error_code == yajl_gen_status_ok;
-}
+    string error_msg;
+    yajl_val val = jp.resolve(root, error_msg);
 
-static void sql_jget(sqlite3_context *context,
-                     int argc, sqlite3_value **argv)
-{
-    if (argc < 2) {
-        sqlite3_result_error(context, "expecting JSON value and pointer", -1);
+    if (!error_msg.empty()) {
+        sqlite3_result_error(context, error_msg.c_str(), -1);
         return;
     }
 
-    if (sqlite3_value_type(argv[0]) == SQLITE_NULL) {
+    if (val == nullptr) {
         null_or_default(context, argc, argv);
         return;
     }
 
-    const char *json_in = (const char *)sqlite3_value_text(argv[0]);
-
-    if (sqlite3_value_type(argv[1]) == SQLITE_NULL) {
-        sqlite3_result_text(context, json_in, -1, SQLITE_TRANSIENT);
+    switch (val->type) {
+    case yajl_t_string:
+        sqlite3_result_text(context, val->u.string, -1, SQLITE_TRANSIENT);
         return;
+    case yajl_t_null:
+        sqlite3_result_null(context);
+        return;
+    case yajl_t_true:
+    case yajl_t_false:
+        sqlite3_result_int(context, YAJL_IS_TRUE(val));
+        return;
+    default:
+        break;
     }
 
-    const char *ptr_in = (const char *)sqlite3_value_text(argv[1]);
-    json_ptr jp(ptr_in);
-    sql_json_op jo(jp);
-    auto_mem<yajl_handle_t> handle(yajl_free);
-    const unsigned char *err;
     yajlpp_gen gen;
 
     yajl_gen_config(gen, yajl_gen_beautify, false);
+    gen_tree(gen, val);
 
-    jo.jo_ptr_callbacks = json_op::gen_callbacks;
-    jo.jo_ptr_callbacks.yajl_null = gen_handle_null;
-    jo.jo_ptr_callbacks.yajl_boolean = gen_handle_boolean;
-    jo.jo_ptr_callbacks.yajl_string = gen_handle_string;
-    jo.jo_ptr_data = gen.get_handle();
-
-    handle.reset(yajl_alloc(&json_op::ptr_callbacks, nullptr, &jo));
-    switch (yajl_parse(handle.in(), (const unsigned char *)json_in, strlen(json_in))) {
-    case yajl_status_error:
-        err = yajl_get_error(handle.in(), 0, (const unsigned char *)json_in, strlen(json_in));
-        sqlite3_result_error(context, (const char *)err, -1);
-        return;
-    case yajl_status_client_canceled:
-        if (jo.jo_ptr.jp_state == json_ptr::MS_ERR_INVALID_ESCAPE) {
-            sqlite3_result_error(context, jo.jo_ptr.error_msg().c_str(), -1);
-        }
-        else {
-            null_or_default(context, argc, argv);
-        }
+    string_fragment result = gen.to_string_fragment();
+
+    sqlite3_result_text(context, result.data(), result.length(), SQLITE_TRANSIENT);
+}
+
+static void sql_jget(sqlite3_context *context,
+                     int argc, sqlite3_value **argv)
+{
+    if (argc < 2) {
+        sqlite3_result_error(context, "expecting JSON value and pointer", -1);
         return;
-    default:
-        break;
     }
 
-    switch (yajl_complete_parse(handle.in())) {
-    case yajl_status_error:
-        err = yajl_get_error(handle.in(), 0, (const unsigned char *)json_in, strlen(json_in));
-        sqlite3_result_error(context, (const char *)err, -1);
-        return;
-    case yajl_status_client_canceled:
-        if (jo.jo_ptr.jp_state == json_ptr::MS_ERR_INVALID_ESCAPE) {
-            sqlite3_result_error(context, jo.jo_ptr.error_msg().c_str(), -1);
-        }
-        else {
-            null_or_default(context, argc, argv);
-        }
+    if (sqlite3_value_type(argv[0]) == SQLITE_NULL) {
+        null_or_default(context, argc, argv);
         return;
-    default:
-        break;
     }
 
-    switch (jo.sjo_type) {
-    case SQLITE3_TEXT:
-        sqlite3_result_text(context, jo.sjo_str.c_str(), jo.sjo_str.size(), SQLITE_TRANSIENT);
-        return;
-    case SQLITE_NULL:
-        sqlite3_result_null(context);
-        return;
-    case SQLITE_INTEGER:
-        sqlite3_result_int(context, jo.sjo_int);
+    if (sqlite3_value_type(argv[1]) == SQLITE_NULL) {
+        const char *json_in = (const char *)sqlite3_value_text(argv[0]);
+
+        sqlite3_result_text(context, json_in, -1, SQLITE_TRANSIENT);
         return;
     }
 
-    string_fragment result = gen.to_string_fragment();
+    auto jp = (compiled_json_ptr *) sqlite3_get_auxdata(context, 1);
 
-    if (result.empty()) {
-        null_or_default(context, argc, argv);
+    if (jp != nullptr) {
+        jget_result(context, argc, argv, *jp);
         return;
     }
 
-    sqlite3_result_text(context, result.data(), result.length(), SQLITE_TRANSIENT);
+    const char *ptr_in = (const char *)sqlite3_value_text(argv[1]);
+    std::unique_ptr<compiled_json_ptr> new_jp(new compiled_json_ptr(ptr_in));
+
+    jget_result(context, argc, argv, *new_jp);
+    // SQLite only holds on to the pointer if it is a constant in the
+    // statement and might free it right away, so this needs to be last.
+    sqlite3_set_auxdata(context, 1, new_jp.release(), free_compiled_json_ptr);
 }
 
 struct json_agg_context {
@@ -35,6 +35,7 @@
 #include <errno.h>
 #include <string.h>
 #include <fcntl.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
 #ifdef HAVE_BZLIB_H
@@ -42,6 +43,7 @@
 #endif
 
 #include <set>
+#include <algorithm>
 
 #ifdef HAVE_X86INTRIN_H
 #include "simdutf8check.h"
@@ -50,6 +52,7 @@
 #include "base/is_utf8.hh"
 #include "lnav_util.hh"
 #include "line_buffer.hh"
+#include "spool_file.hh"
 #include "fmtlib/fmt/format.h"
 
 using namespace std;
@@ -126,9 +129,12 @@ line_buffer::line_buffer()
       lb_buffer_size(0),
       lb_buffer_max(DEFAULT_LINE_BUFFER_SIZE),
       lb_seekable(false),
-      lb_last_line_offset(-1)
+      lb_last_line_offset(-1),
+      lb_spool_file(false),
+      lb_spool_next_header(0),
+      lb_spool_cached_block(-1)
 {
-    if ((this->lb_buffer = (char *)malloc(this->lb_buffer_max)) == NULL) {
+    if ((this->lb_buffer = make_shared_segment(this->lb_buffer_max)) == nullptr) {
         throw bad_alloc();
     }
 
@@ -139,8 +145,6 @@ line_buffer::~line_buffer()
 {
     auto_fd fd = -1;
 
-    // Make sure any shared refs take ownership of the data.
-    this->lb_share_manager.invalidate_refs();
     this->set_fd(fd);
 }
 
@@ -157,6 +161,11 @@ void line_buffer::set_fd(auto_fd &fd)
         this->lb_bz_file = false;
     }
 
+    this->lb_spool_file = false;
+    this->lb_spool_blocks.clear();
+    this->lb_spool_next_header = 0;
+    this->lb_spool_cached_block = -1;
+
     if (fd != -1) {
         /* Sync the fd's offset with the object. */
         newoff = lseek(fd, 0, SEEK_CUR);
@@ -173,7 +182,12 @@ void line_buffer::set_fd(auto_fd &fd)
             char gz_id[2 + 1 + 1 + 4];
 
             if (pread(fd, gz_id, sizeof(gz_id), 0) == sizeof(gz_id)) {
-                if (gz_id[0] == '\037' && gz_id[1] == '\213') {
+                if (spool_file::is_spool(gz_id, sizeof(gz_id))) {
+                    this->lb_spool_file = true;
+                    this->lb_spool_next_header = sizeof(spool_file::FILE_MAGIC);
+                    this->lb_compressed_offset = 0;
+                }
+                else if (gz_id[0] == '\037' && gz_id[1] == '\213') {
                     int gzfd = dup(fd);
 
                     log_perror(fcntl(gzfd, F_SETFD, FD_CLOEXEC));
@@ -218,7 +232,7 @@ void line_buffer::set_fd(auto_fd &fd)
         }
     }
     this->lb_file_offset = newoff;
-    this->lb_buffer_size = 0;
+    this->compact_buffer(this->lb_buffer_size);
     this->lb_fd          = fd;
 
     ensure(this->invariant());
@@ -230,20 +244,56 @@ void line_buffer::resize_buffer(size_t new_max)
         new_max <= MAX_LINE_BUFFER_SIZE);
 
     if (new_max > (size_t)this->lb_buffer_max) {
-        char *tmp, *old;
-
-        /* Still need more space, try a realloc. */
-        old = this->lb_buffer.release();
-        this->lb_share_manager.invalidate_refs();
-        tmp = (char *) realloc(old, new_max);
-        if (tmp != NULL) {
-            this->lb_buffer = tmp;
-            this->lb_buffer_max = new_max;
-        } else {
-            this->lb_buffer = old;
+        /*
+         * Still need more space, copy the data to a bigger buffer.  Any
+         * lines that were handed out keep the old buffer alive.
+         */
+        shared_segment tmp = make_shared_segment(new_max);
+
+        if (tmp == nullptr) {
+            throw error(ENOMEM);
+        }
+        memcpy(tmp.get(), this->lb_buffer.get(), this->lb_buffer_size);
+        this->lb_buffer = tmp;
+        this->lb_buffer_max = new_max;
+    }
+}
+
+void line_buffer::compact_buffer(ssize_t prefill)
+{
+    require(prefill <= this->lb_buffer_size);
+
+    this->lb_buffer_size -= prefill;
+    if (this->lb_buffer.use_count() > 1) {
+        /*
+         * Lines that were handed out keep the old buffer alive, so only
+         * allocate what is needed for the retained data.  The buffer will
+         * be grown again if a bigger range is requested.
+         */
+        ssize_t new_max = roundup_size(this->lb_buffer_size,
+                                       DEFAULT_INCREMENT);
+
+        if (new_max < DEFAULT_LINE_BUFFER_SIZE) {
+            new_max = DEFAULT_LINE_BUFFER_SIZE;
+        }
+        if (new_max > this->lb_buffer_max) {
+            new_max = this->lb_buffer_max;
+        }
+        shared_segment tmp = make_shared_segment(new_max);
 
+        if (tmp == nullptr) {
             throw error(ENOMEM);
         }
+        memcpy(tmp.get(),
+               this->lb_buffer.get() + prefill,
+               this->lb_buffer_size);
+        this->lb_buffer = tmp;
+        this->lb_buffer_max = new_max;
+    }
+    else if (prefill > 0) {
+        memmove(this->lb_buffer.get(),
+                this->lb_buffer.get() + prefill,
+                this->lb_buffer_size);
     }
 }
 
@@ -269,9 +319,8 @@ void line_buffer::ensure_available(off_t start, ssize_t max_length)
          * The request is outside the cached range, need to reload the
          * whole thing.
          */
-        this->lb_share_manager.invalidate_refs();
         prefill = 0;
-        this->lb_buffer_size = 0;
+        this->compact_buffer(this->lb_buffer_size);
         if ((this->lb_file_size != (ssize_t)-1) &&
             (start + this->lb_buffer_max > this->lb_file_size)) {
             /*
@@ -303,13 +352,8 @@ void line_buffer::ensure_available(off_t start, ssize_t max_length)
          * Need more space, move any existing data to the front of the
          * buffer.
          */
-        this->lb_share_manager.invalidate_refs();
-
-        this->lb_buffer_size -= prefill;
         this->lb_file_offset += prefill;
-        memmove(&this->lb_buffer[0],
-                &this->lb_buffer[prefill],
-                this->lb_buffer_size);
+        this->compact_buffer(prefill);
 
         available = this->lb_buffer_max - (start - this->lb_file_offset);
         if (max_length > available) {
@@ -319,6 +363,96 @@ void line_buffer::ensure_available(off_t start, ssize_t max_length)
     }
 }
 
+void line_buffer::load_spool_index(off_t file_size)
+{
+    while (this->lb_spool_next_header +
+           (off_t) sizeof(spool_file::block_header) <= file_size) {
+        spool_file::block_header bh;
+        spool_block sb;
+
+        if (pread(this->lb_fd, &bh, sizeof(bh),
+                  this->lb_spool_next_header) != sizeof(bh)) {
+            break;
+        }
+
+        sb.sb_offset = this->spool_data_size();
+        sb.sb_size = bh.bh_size;
+        sb.sb_file_offset = this->lb_spool_next_header + sizeof(bh);
+        sb.sb_compressed_size = bh.bh_compressed_size;
+        if (sb.sb_file_offset + (off_t) sb.sb_compressed_size > file_size) {
+            /* The writer has not finished with this block yet. */
+            break;
+        }
+
+        this->lb_spool_blocks.push_back(sb);
+        this->lb_spool_next_header =
+            sb.sb_file_offset + sb.sb_compressed_size;
+    }
+}
+
+ssize_t line_buffer::read_spool(off_t off, char *dst, size_t len)
+{
+    struct stat st;
+
+    if (fstat(this->lb_fd, &st) == -1) {
+        return -1;
+    }
+    this->load_spool_index(st.st_size);
+
+    auto iter = std::upper_bound(
+        this->lb_spool_blocks.begin(), this->lb_spool_blocks.end(), off,
+        [](off_t lhs, const spool_block &rhs) {
+            return lhs < rhs.sb_offset;
+        });
+    ssize_t retval = 0;
+
+    if (iter == this->lb_spool_blocks.begin()) {
+        return 0;
+    }
+    --iter;
+
+    std::vector<char> compressed;
+
+    for (; iter != this->lb_spool_blocks.end() && len > 0; ++iter) {
+        ssize_t index = std::distance(this->lb_spool_blocks.begin(), iter);
+
+        if (index != this->lb_spool_cached_block) {
+            uLongf dest_len = iter->sb_size;
+
+            compressed.resize(iter->sb_compressed_size);
+            if (pread(this->lb_fd, compressed.data(), compressed.size(),
+                      iter->sb_file_offset) != (ssize_t) compressed.size()) {
+                return retval > 0 ? retval : -1;
+            }
+            this->lb_spool_data.resize(iter->sb_size);
+            this->lb_spool_cached_block = -1;
+            if (uncompress((Bytef *) this->lb_spool_data.data(), &dest_len,
+                           (const Bytef *) compressed.data(),
+                           compressed.size()) != Z_OK ||
+                dest_len != iter->sb_size) {
+                log_error("unable to uncompress spool block at %lld",
+                          (long long) iter->sb_file_offset);
+                errno = EIO;
+                return retval > 0 ? retval : -1;
+            }
+            this->lb_spool_cached_block = index;
+        }
+
+        size_t block_off = off - iter->sb_offset;
+        size_t amount = std::min(len, iter->sb_size - block_off);
+
+        memcpy(dst, &this->lb_spool_data[block_off], amount);
+        dst += amount;
+        off += amount;
+        len -= amount;
+        retval += amount;
+        this->lb_compressed_offset =
+            iter->sb_file_offset + iter->sb_compressed_size;
+    }
+
+    return retval;
+}
+
 bool line_buffer::fill_range(off_t start, ssize_t max_length)
 {
     bool retval = false;
@@ -350,7 +484,7 @@ bool line_buffer::fill_range(off_t start, ssize_t max_length)
                        this->lb_file_offset + this->lb_buffer_size,
                        SEEK_SET);
                 rc = gzread(this->lb_gz_file,
-                            &this->lb_buffer[this->lb_buffer_size],
+                            &this->lb_buffer.get()[this->lb_buffer_size],
                             this->lb_buffer_max - this->lb_buffer_size);
                 this->lb_compressed_offset = lseek(this->lb_fd, 0, SEEK_CUR);
                 if (rc != -1 && (
@@ -405,7 +539,7 @@ bool line_buffer::fill_range(off_t start, ssize_t max_length)
                     seek_to -= count;
                 }
                 rc = BZ2_bzread(bz_file,
-                                &this->lb_buffer[this->lb_buffer_size],
+                                &this->lb_buffer.get()[this->lb_buffer_size],
                                 this->lb_buffer_max - this->lb_buffer_size);
                 this->lb_compressed_offset = lseek(bzfd, 0, SEEK_SET);
                 BZ2_bzclose(bz_file);
@@ -418,15 +552,20 @@ bool line_buffer::fill_range(off_t start, ssize_t max_length)
             }
         }
 #endif
+        else if (this->lb_spool_file) {
+            rc = this->read_spool(this->lb_file_offset + this->lb_buffer_size,
+                                  &this->lb_buffer.get()[this->lb_buffer_size],
+                                  this->lb_buffer_max - this->lb_buffer_size);
+        }
         else if (this->lb_seekable) {
             rc = pread(this->lb_fd,
-                       &this->lb_buffer[this->lb_buffer_size],
+                       &this->lb_buffer.get()[this->lb_buffer_size],
                        this->lb_buffer_max - this->lb_buffer_size,
                        this->lb_file_offset + this->lb_buffer_size);
         }
         else {
             rc = read(this->lb_fd,
-                      &this->lb_buffer[this->lb_buffer_size],
+                      &this->lb_buffer.get()[this->lb_buffer_size],
                       this->lb_buffer_max - this->lb_buffer_size);
         }
         // XXX For some reason, cygwin is giving us a bogus return value when
@@ -631,7 +770,17 @@ Result<shared_buffer_ref, std::string> line_buffer::read_range(const file_range
         return Err(fmt::format("short-read (need: {}; avail: {})",
             fr.fr_size, avail));
     }
-    retval.share(this->lb_share_manager, line_start, fr.fr_size);
+    retval.share(this->lb_buffer, line_start, fr.fr_size);
+    if (this->lb_buffer_max > DEFAULT_LINE_BUFFER_SIZE &&
+        (size_t) fr.fr_size < (size_t) this->lb_buffer_max / 8) {
+        /*
+         * A big buffer, like the ones used for compressed files, should not
+         * be kept alive by a small line, so copy the line out instead.
+         */
+        if (!retval.take_ownership()) {
+            return Err(string("out of memory"));
+        }
+    }
 
     return Ok(retval);
 }
@@ -38,6 +38,7 @@
 #include <zlib.h>
 
 #include <exception>
+#include <vector>
 
 #include "base/lnav_log.hh"
 #include "base/file_range.hh"
@@ -106,9 +107,14 @@ public:
         return this->lb_gz_file != NULL || this->lb_bz_file;
     };
 
+    /** @return True if the file was written by a spool_file_writer. */
+    bool is_spool() const {
+        return this->lb_spool_file;
+    };
+
     off_t get_read_offset(off_t off) const
     {
-        if (this->is_compressed()) {
+        if (this->is_compressed() || this->is_spool()) {
             return this->lb_compressed_offset;
         }
         else{
@@ -117,6 +123,10 @@ public:
     };
 
     bool is_data_available(off_t off, off_t stat_size) {
+        if (this->is_spool()) {
+            this->load_spool_index(stat_size);
+            return off < this->spool_data_size();
+        }
         if (this->is_compressed()) {
             return (this->lb_file_size == -1 || off < this->lb_file_size);
         }
@@ -147,7 +157,7 @@ public:
 
     void clear()
     {
-        this->lb_buffer_size  = 0;
+        this->compact_buffer(this->lb_buffer_size);
     };
 
     /** Release any resources held by this object. */
@@ -157,14 +167,14 @@ public:
 
         this->lb_file_offset      = 0;
         this->lb_file_size        = (ssize_t)-1;
-        this->lb_buffer_size      = 0;
+        this->compact_buffer(this->lb_buffer_size);
         this->lb_last_line_offset = -1;
     };
 
     /** Check the invariants for this object. */
     bool invariant(void)
     {
-        require(this->lb_buffer != NULL);
+        require(this->lb_buffer != nullptr);
         require(this->lb_buffer_size <= this->lb_buffer_max);
 
         return true;
@@ -184,6 +194,15 @@ private:
 
     void resize_buffer(size_t new_max);
 
+    /**
+     * Drop data from the front of the buffer and move the rest of the data
+     * to the start.  If lines from the buffer are still referenced, the data
+     * is copied to a new buffer instead of being moved in place.
+     *
+     * @param prefill The number of bytes to drop.
+     */
+    void compact_buffer(ssize_t prefill);
+
     /**
      * Ensure there is enough room in the buffer to cache a range of data from
      * the file.  First, this method will check to see if there is enough room
@@ -226,20 +245,60 @@ private:
         require(buffer_offset >= 0);
         require(this->lb_buffer_size >= buffer_offset);
 
-        retval    = &this->lb_buffer[buffer_offset];
+        retval    = &this->lb_buffer.get()[buffer_offset];
         avail_out = this->lb_buffer_size - buffer_offset;
 
         return retval;
     };
 
-    shared_buffer lb_share_manager;
+    /**
+     * Add any blocks that have been completely written to the spool file
+     * since the last call to the index.
+     *
+     * @param file_size The current size of the spool file.
+     */
+    void load_spool_index(off_t file_size);
+
+    /** @return The amount of uncompressed data in the indexed blocks. */
+    off_t spool_data_size() const {
+        if (this->lb_spool_blocks.empty()) {
+            return 0;
+        }
+
+        const auto &last = this->lb_spool_blocks.back();
+
+        return last.sb_offset + last.sb_size;
+    };
+
+    /**
+     * Copy uncompressed data out of the spool file.
+     *
+     * @param off The offset in the uncompressed data to start at.
+     * @param dst The buffer to copy the data into.
+     * @param len The maximum amount of data to copy.
+     * @return The amount of data copied, zero if the offset is past the end
+     *   of the data written so far.
+     */
+    ssize_t read_spool(off_t off, char *dst, size_t len);
+
+    struct spool_block {
+        off_t sb_offset;          /*< The offset of the uncompressed data. */
+        size_t sb_size;           /*< The size of the uncompressed data. */
+        off_t sb_file_offset;     /*< The offset of the data in the file. */
+        size_t sb_compressed_size;
+    };
 
     auto_fd lb_fd;              /*< The file to read data from. */
     gzFile  lb_gz_file;         /*< File handle for gzipped files. */
     bool    lb_bz_file;         /*< Flag set for bzip2 compressed files. */
     off_t   lb_compressed_offset; /*< The offset into the compressed file. */
 
-    auto_mem<char> lb_buffer;   /*< The internal buffer where data is cached */
+    shared_segment lb_buffer;   /*<
+                                 * The internal buffer where data is cached.
+                                 * The lines that are handed out keep a
+                                 * reference to it, so it is replaced instead
+                                 * of changed while they are alive.
+                                 */
 
     ssize_t lb_file_size;       /*<
                                  * The size of the file.  When lb_fd refers to
@@ -255,5 +314,11 @@ private:
     ssize_t lb_buffer_max;      /*< The size of the buffer memory. */
     bool   lb_seekable;         /*< Flag set for seekable file descriptors. */
     off_t  lb_last_line_offset; /*< */
+
+    bool lb_spool_file;         /*< Flag set for spool files. */
+    std::vector<spool_block> lb_spool_blocks;
+    off_t lb_spool_next_header; /*< The file offset of the next block. */
+    ssize_t lb_spool_cached_block; /*< The block in lb_spool_data. */
+    std::vector<char> lb_spool_data; /*< The last decompressed block. */
 };
 #endif
@@ -170,6 +170,18 @@ const int ZOOM_LEVELS[] = {
 
 const ssize_t ZOOM_COUNT = sizeof(ZOOM_LEVELS) / sizeof(int);
 
+/**
+ * The most messages to parse for the schema index each time the main loop
+ * is idle.
+ */
+static const size_t SCHEMA_INDEX_BATCH_SIZE = 4096;
+
+/**
+ * The most time, in milliseconds, to spend on the schema index each time
+ * the main loop is idle, so that it does not hold up the UI.
+ */
+static const mstime_t SCHEMA_INDEX_TIME_SLICE = 10;
+
 const char *lnav_view_strings[LNV__MAX + 1] = {
     "log",
     "text",
@@ -272,12 +284,16 @@ bool setup_logline_table(exec_context &ec)
         vis_line_t     vl = log_view.get_top();
         content_line_t cl = lnav_data.ld_log_source.at_base(vl);
 
+        // Create the new table before dropping the old one so that the
+        // schema index stays enabled and is not thrown away.
+        auto ldt = new log_data_table(lnav_data.ld_log_source,
+                                      *lnav_data.ld_vtab_manager,
+                                      lnav_data.ld_schema_index,
+                                      cl,
+                                      logline);
+
         lnav_data.ld_vtab_manager->unregister_vtab(logline);
-        lnav_data.ld_vtab_manager->register_vtab(
-            new log_data_table(lnav_data.ld_log_source,
-                               *lnav_data.ld_vtab_manager,
-                               cl,
-                               logline));
+        lnav_data.ld_vtab_manager->register_vtab(ldt);
 
         if (update_possibilities) {
             log_data_helper ldh(lnav_data.ld_log_source);
@@ -561,11 +577,22 @@ void rebuild_indexes()
         }
     }
 
+    file_watcher::changes changes =
+        lnav_data.ld_file_watcher.take_changes(time(nullptr));
+
     for (auto file_iter = lnav_data.ld_files.begin();
          file_iter != lnav_data.ld_files.end(); ) {
         auto lf = *file_iter;
 
-        if (!lf->exists() || lf->is_closed()) {
+        // Files read from a pipe do not have a name that can be watched, so
+        // they always need to be checked.
+        if (lf->is_valid_filename() && !lf->is_closed() &&
+            !changes.contains(lf->get_filename(), lf->get_stat())) {
+            ++file_iter;
+            continue;
+        }
+
+        if (lf->is_closed() || !lf->exists()) {
             log_info("closed log file: %s", lf->get_filename().c_str());
             if (!lf->is_valid_filename()) {
                 lnav_data.ld_file_names.erase(lf->get_filename());
@@ -577,6 +604,7 @@ void rebuild_indexes()
             regenerate_unique_file_names();
         }
         else {
+            lss.mark_dirty(lf);
             ++file_iter;
         }
     }
@@ -648,7 +676,13 @@ static bool append_default_files(lnav_flags_t flag)
 
 static void sigint(int sig)
 {
-    lnav_data.ld_looping = false;
+    if (sig == SIGINT && lnav_data.ld_sql_running) {
+        /* Cancel the query that is running instead of quitting. */
+        sqlite3_interrupt(lnav_data.ld_db.in());
+    }
+    else {
+        lnav_data.ld_looping = false;
+    }
 }
 
 static void sigwinch(int sig)
@@ -1045,13 +1079,18 @@ static void expand_filename(string path, bool required)
 
 bool rescan_files(bool required)
 {
+    file_watcher &fw = lnav_data.ld_file_watcher;
     map<string, logfile_open_options>::iterator iter;
     bool retval = false;
 
+    fw.begin_scan(time(nullptr));
     for (iter = lnav_data.ld_file_names.begin();
          iter != lnav_data.ld_file_names.end();
          iter++) {
         if (iter->second.loo_fd == -1) {
+            if (!fw.should_scan(iter->first)) {
+                continue;
+            }
             expand_filename(iter->first, required);
             if (lnav_data.ld_flags & LNF_ROTATED) {
                 string path = iter->first + ".*";
@@ -1068,7 +1107,8 @@ bool rescan_files(bool required)
          file_iter != lnav_data.ld_files.end(); ) {
         auto lf = *file_iter;
 
-        if (!lf->exists() || lf->is_closed()) {
+        if (lf->is_closed() ||
+            (fw.should_scan(lf->get_filename()) && !lf->exists())) {
             log_info("Log file no longer exists or is closed: %s",
                      lf->get_filename().c_str());
             return true;
@@ -1077,6 +1117,7 @@ bool rescan_files(bool required)
             ++file_iter;
         }
     }
+    fw.end_scan();
 
     return retval;
 }
@@ -1283,9 +1324,8 @@ static void gather_pipers()
 {
     for (auto iter = lnav_data.ld_pipers.begin();
          iter != lnav_data.ld_pipers.end(); ) {
-        pid_t child_pid = (*iter)->get_child_pid();
         if ((*iter)->has_exited()) {
-            log_info("child piper has exited -- %d", child_pid);
+            log_info("piper has finished");
             iter = lnav_data.ld_pipers.erase(iter);
         } else {
             ++iter;
@@ -1310,6 +1350,159 @@ static void wait_for_pipers()
     }
 }
 
+/**
+ * Write a row of a view to stdout in headless mode.
+ *
+ * @param tc The view to get the row from.
+ * @param vl The row to write.
+ * @param suppress_empty_lines If true, skip the row if it is empty.
+ */
+static void write_view_row(textview_curses *tc, vis_line_t vl,
+                           bool suppress_empty_lines)
+{
+    vector<attr_line_t> rows(1);
+    tc->listview_value_for_rows(*tc, vl, rows);
+    if (suppress_empty_lines && rows[0].empty()) {
+        return;
+    }
+
+    struct line_range lr = find_string_attr_range(
+            rows[0].get_attrs(), &textview_curses::SA_ORIGINAL_LINE);
+    if (write(STDOUT_FILENO, lr.substr(rows[0].get_string()),
+              lr.sublen(rows[0].get_string())) == -1 ||
+        write(STDOUT_FILENO, "\n", 1) == -1) {
+        perror("2 write to STDOUT");
+    }
+}
+
+/**
+ * Check if the output of headless mode can be written while stdin is still
+ * being read.  That is only possible when the commands just change what
+ * lines are shown, anything else, like a query, needs all of the input.
+ * The highlight commands are allowed as well since they do not change the
+ * text that is written out.
+ */
+static bool can_stream_headless()
+{
+    static const set<string> STREAMABLE_COMMANDS = {
+        "filter-in",
+        "filter-out",
+        "delete-filter",
+        "enable-filter",
+        "disable-filter",
+        "set-min-log-level",
+        "hide-fields",
+        "show-fields",
+        "hide-lines-before",
+        "hide-lines-after",
+        "highlight",
+        "clear-highlight",
+    };
+
+    if ((lnav_data.ld_flags & LNF_QUIET) || !lnav_data.ld_pt_search.empty()) {
+        return false;
+    }
+
+    for (const auto &cmd : lnav_data.ld_commands) {
+        if (cmd.empty() || cmd[0] != ':') {
+            return false;
+        }
+
+        vector<string> args;
+
+        split_ws(cmd.substr(1), args);
+        if (args.empty() || STREAMABLE_COMMANDS.count(args[0]) == 0) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * The log lines that have been written out while streaming in headless mode.
+ * The rows of the log view move around as lines are indexed, and lines can
+ * be indexed with a time that is earlier than lines already written, so the
+ * position is kept as the number of lines from each file that have been
+ * handled instead of as a row number or time.
+ */
+class headless_stream_position {
+public:
+    /**
+     * Find the rows for the lines that were indexed since the last call and
+     * mark them as written.
+     *
+     * @param lss The log source the rows come from.
+     * @return The rows to write in view order.
+     */
+    std::vector<vis_line_t> next_rows(logfile_sub_source &lss)
+    {
+        std::vector<vis_line_t> retval;
+
+        for (auto iter = lss.begin(); iter != lss.end(); ++iter) {
+            auto lf = (*iter)->get_file();
+
+            if (lf == nullptr) {
+                continue;
+            }
+
+            content_line_t base = lss.get_file_base_content_line(iter);
+            size_t &handled = this->hsp_file_lines[lf.get()];
+
+            for (; handled < (*iter)->ld_lines_indexed; handled++) {
+                auto vl_opt = lss.find_from_content(
+                    content_line_t(base + handled));
+
+                // Filtered out lines are not in the view.
+                if (vl_opt) {
+                    retval.emplace_back(vl_opt.value());
+                }
+            }
+        }
+        std::sort(retval.begin(), retval.end());
+
+        return retval;
+    };
+
+private:
+    std::map<const logfile *, size_t> hsp_file_lines;
+};
+
+/**
+ * Wait for the pipers to finish while writing out the lines of the log view
+ * as they are indexed.
+ *
+ * @param tc The log view.
+ */
+static void stream_headless_log(textview_curses *tc)
+{
+    logfile_sub_source &lss = lnav_data.ld_log_source;
+    headless_stream_position pos;
+    int written = 0;
+
+    for (;;) {
+        gather_pipers();
+
+        bool done = lnav_data.ld_pipers.empty();
+
+        rebuild_indexes();
+        // A line that was indexed late can land in the middle of the rows
+        // that were already written, it is written out after them.
+        for (auto vl : pos.next_rows(lss)) {
+            write_view_row(tc, vl, false);
+            written += 1;
+        }
+
+        if (done && !lss.has_dirty_files()) {
+            log_debug("all pipers finished, wrote %d lines", written);
+            break;
+        }
+        if (!done) {
+            usleep(10000);
+        }
+    }
+}
+
 static void looper()
 {
     try {
@@ -1565,6 +1758,7 @@ static void looper()
             }
             rlc.update_poll_set(pollfds);
             lnav_data.ld_filter_source.fss_editor.update_poll_set(pollfds);
+            lnav_data.ld_file_watcher.update_poll_set(pollfds);
 
             for (auto &tc : lnav_data.ld_views) {
                 tc.update_poll_set(pollfds);
@@ -1622,6 +1816,15 @@ static void looper()
 
                 rlc.check_poll_set(pollfds);
                 lnav_data.ld_filter_source.fss_editor.check_poll_set(pollfds);
+                lnav_data.ld_file_watcher.check_poll_set(pollfds);
+            }
+
+            if (rc == 0 && lnav_data.ld_schema_index.is_enabled()) {
+                // Nothing else is going on, so use the time to index the
+                // message schemas for the logline tables.
+                lnav_data.ld_schema_index.scan(lnav_data.ld_log_source,
+                                               SCHEMA_INDEX_BATCH_SIZE,
+                                               SCHEMA_INDEX_TIME_SLICE);
             }
 
             if (timer.time_to_update(overlay_counter)) {
@@ -2108,6 +2311,7 @@ int main(int argc, char *argv[])
                              lnav_data.ld_log_source);
 
     load_formats(lnav_data.ld_config_paths, loader_errors);
+    clear_rewriter_cache();
 
     {
         auto_mem<char, sqlite3_free> errmsg;
@@ -2197,7 +2401,7 @@ int main(int argc, char *argv[])
         lnav_data.ld_log_source.set_index_delegate(
                 new hist_index_delegate(lnav_data.ld_hist_source2,
                         lnav_data.ld_views[LNV_HISTOGRAM]));
-        hs.init();
+        hs.set_time_slices(ZOOM_LEVELS, ZOOM_COUNT);
         lnav_data.ld_zoom_level = 3;
         hs.set_time_slice(ZOOM_LEVELS[lnav_data.ld_zoom_level]);
     }
@@ -2441,11 +2645,32 @@ int main(int argc, char *argv[])
                 log_tc = &lnav_data.ld_views[LNV_LOG];
                 log_tc->set_height(vis_line_t(24));
                 lnav_data.ld_view_stack.vs_views.push_back(log_tc);
-                // Read all of stdin
-                wait_for_pipers();
+
+                bool streamed = false;
+
+                if (!lnav_data.ld_pipers.empty() && can_stream_headless()) {
+                    // The commands only filter the log, so they can be run
+                    // first and the log written out as stdin is read
+                    // instead of waiting for it all to be copied.
+                    log_info("streaming headless output");
+                    execute_init_commands(lnav_data.ld_exec_context, msgs);
+                    stream_headless_log(log_tc);
+                    streamed = true;
+                }
+                else {
+                    // Read all of stdin
+                    wait_for_pipers();
+                }
                 rebuild_indexes();
 
-                log_tc->set_top(vis_line_t(0));
+                if (streamed) {
+                    // Everything in the log view has already been written.
+                    log_tc->set_top(vis_line_t(
+                        lnav_data.ld_log_source.text_line_count()));
+                }
+                else {
+                    log_tc->set_top(vis_line_t(0));
+                }
                 text_tc = &lnav_data.ld_views[LNV_TEXT];
                 text_tc->set_top(vis_line_t(0));
                 text_tc->set_height(vis_line_t(text_tc->get_inner_height()));
@@ -2511,20 +2736,7 @@ int main(int argc, char *argv[])
                             ++y;
                         }
 
-                        vector<attr_line_t> rows(1);
-                        tc->listview_value_for_rows(*tc, vl, rows);
-                        if (suppress_empty_lines && rows[0].empty()) {
-                            continue;
-                        }
-
-                        struct line_range lr = find_string_attr_range(
-                                rows[0].get_attrs(), &textview_curses::SA_ORIGINAL_LINE);
-                        if (write(STDOUT_FILENO, lr.substr(rows[0].get_string()),
-                                  lr.sublen(rows[0].get_string())) == -1 ||
-                            write(STDOUT_FILENO, "\n", 1) == -1) {
-                            perror("2 write to STDOUT");
-                        }
-
+                        write_view_row(tc, vl, suppress_empty_lines);
                     }
                     {
                         attr_line_t al;
@@ -2616,6 +2828,7 @@ int main(int argc, char *argv[])
     }
 
     lnav_data.ld_curl_looper.stop();
+    clear_rewriter_cache();
 
     return retval;
 }
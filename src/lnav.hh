@@ -54,6 +54,7 @@
 #include "db_sub_source.hh"
 #include "textfile_sub_source.hh"
 #include "log_vtab_impl.hh"
+#include "log_schema_index.hh"
 #include "readline_curses.hh"
 #include "xterm_mouse.hh"
 #include "piper_proc.hh"
@@ -68,6 +69,7 @@
 #include "filter_sub_source.hh"
 #include "filter_status_source.hh"
 #include "preview_status_source.hh"
+#include "file_watcher.hh"
 
 /** The command modes that are available while viewing a file. */
 typedef enum {
@@ -228,6 +230,7 @@ struct _lnav_data {
     std::vector<std::string>                ld_config_paths;
     std::map<std::string, logfile_open_options> ld_file_names;
     std::vector<std::shared_ptr<logfile>>   ld_files;
+    file_watcher                            ld_file_watcher;
     std::list<std::string>                  ld_other_files;
     std::set<std::string>                   ld_closed_files;
     std::list<std::pair<std::string, int> > ld_files_to_front;
@@ -238,6 +241,7 @@ struct _lnav_data {
     sig_atomic_t                            ld_looping;
     sig_atomic_t                            ld_winched;
     sig_atomic_t                            ld_child_terminated;
+    sig_atomic_t                            ld_sql_running;
     unsigned long                           ld_flags;
     WINDOW *                                ld_window;
     ln_mode_t                               ld_mode;
@@ -274,6 +278,7 @@ struct _lnav_data {
     readline_curses *                       ld_rl_view;
 
     logfile_sub_source                      ld_log_source;
+    log_schema_index                        ld_schema_index;
     hist_source2                            ld_hist_source2;
     int                                     ld_zoom_level;
     spectrogram_source ld_spectro_source;
@@ -319,6 +324,24 @@ struct _lnav_data {
 
 extern struct _lnav_data lnav_data;
 
+/**
+ * Marks a SQL statement as running while the guard is alive so that a
+ * SIGINT interrupts the statement instead of quitting.
+ */
+class sql_running_guard {
+public:
+    sql_running_guard() : srg_prev_running(lnav_data.ld_sql_running) {
+        lnav_data.ld_sql_running = true;
+    };
+
+    ~sql_running_guard() {
+        lnav_data.ld_sql_running = this->srg_prev_running;
+    };
+
+private:
+    sig_atomic_t srg_prev_running;
+};
+
 extern readline_context::command_map_t lnav_commands;
 extern const int ZOOM_LEVELS[];
 extern const ssize_t ZOOM_COUNT;
@@ -30,6 +30,7 @@
 #include "config.h"
 
 #include <glob.h>
+#include <zlib.h>
 #include <sys/stat.h>
 
 #include <string>
@@ -54,6 +55,7 @@
 #include "relative_time.hh"
 #include "log_search_table.hh"
 #include "shlex.hh"
+#include "arrow_writer.hh"
 #include "sysclip.hh"
 #include "yajl/api/yajl_parse.h"
 #include "db_sub_source.hh"
@@ -498,6 +500,46 @@ static void yajl_writer(void *context, const char *str, size_t len)
     fwrite(str, len, 1, file);
 }
 
+/**
+ * Generate the value in a cell that has the JSON subtype.
+ *
+ * @return False if the cell could not be parsed as JSON.
+ */
+static bool json_write_json_cell(yajl_gen handle, const char *cell, size_t len)
+{
+    auto_mem<yajl_handle_t> parse_handle(yajl_free);
+    const unsigned char *err;
+    json_ptr jp("");
+    json_op jo(jp);
+
+    jo.jo_ptr_callbacks = json_op::gen_callbacks;
+    jo.jo_ptr_data = handle;
+    parse_handle.reset(yajl_alloc(&json_op::ptr_callbacks, nullptr, &jo));
+
+    const unsigned char *json_in = (const unsigned char *) cell;
+    switch (yajl_parse(parse_handle.in(), json_in, len)) {
+        case yajl_status_error:
+        case yajl_status_client_canceled:
+            err = yajl_get_error(parse_handle.in(), 0, json_in, len);
+            log_error("unable to parse JSON cell: %s", err);
+            return false;
+        default:
+            break;
+    }
+
+    switch (yajl_complete_parse(parse_handle.in())) {
+        case yajl_status_error:
+        case yajl_status_client_canceled:
+            err = yajl_get_error(parse_handle.in(), 0, json_in, len);
+            log_error("unable to parse JSON cell: %s", err);
+            return false;
+        default:
+            break;
+    }
+
+    return true;
+}
+
 static void json_write_row(yajl_gen handle, int row)
 {
     db_label_source &dls = lnav_data.ld_db_row_source;
@@ -506,62 +548,37 @@ static void json_write_row(yajl_gen handle, int row)
     for (size_t col = 0; col < dls.dls_headers.size(); col++) {
         obj_map.gen(dls.dls_headers[col].hm_name);
 
-        if (dls.dls_rows[row][col] == db_label_source::NULL_STR) {
+        if (dls.is_null_cell(row, col)) {
             obj_map.gen();
             continue;
         }
 
         db_label_source::header_meta &hm = dls.dls_headers[col];
+        string cell = dls.get_cell(row, col);
 
         switch (hm.hm_column_type) {
         case SQLITE_FLOAT:
         case SQLITE_INTEGER:
-            yajl_gen_number(handle, dls.dls_rows[row][col],
-                strlen(dls.dls_rows[row][col]));
+            yajl_gen_number(handle, cell.c_str(), cell.length());
             break;
         case SQLITE_TEXT:
             switch (hm.hm_sub_type) {
                 case 74: {
-                    auto_mem<yajl_handle_t> parse_handle(yajl_free);
-                    const unsigned char *err;
-                    json_ptr jp("");
-                    json_op jo(jp);
-
-                    jo.jo_ptr_callbacks = json_op::gen_callbacks;
-                    jo.jo_ptr_data = handle;
-                    parse_handle.reset(yajl_alloc(&json_op::ptr_callbacks, nullptr, &jo));
-
-                    const unsigned char *json_in = (const unsigned char *) dls.dls_rows[row][col];
-                    switch (yajl_parse(parse_handle.in(), json_in, strlen((const char *) json_in))) {
-                        case yajl_status_error:
-                        case yajl_status_client_canceled:
-                            err = yajl_get_error(parse_handle.in(), 0, json_in, strlen((const char *) json_in));
-                            log_error("unable to parse JSON cell: %s", err);
-                            obj_map.gen(dls.dls_rows[row][col]);
-                            return;
-                        default:
-                            break;
-                    }
-
-                    switch (yajl_complete_parse(parse_handle.in())) {
-                        case yajl_status_error:
-                        case yajl_status_client_canceled:
-                            err = yajl_get_error(parse_handle.in(), 0, json_in, strlen((const char *) json_in));
-                            log_error("unable to parse JSON cell: %s", err);
-                            obj_map.gen(dls.dls_rows[row][col]);
-                            return;
-                        default:
-                            break;
+                    if (!json_write_json_cell(handle,
+                                              cell.c_str(),
+                                              cell.length())) {
+                        obj_map.gen(cell);
+                        return;
                     }
                     break;
                 }
                 default:
-                    obj_map.gen(dls.dls_rows[row][col]);
+                    obj_map.gen(cell);
                     break;
             }
             break;
         default:
-            obj_map.gen(dls.dls_rows[row][col]);
+            obj_map.gen(cell);
             break;
         }
     }
@@ -706,8 +723,6 @@ static string com_save_to(exec_context &ec, string cmdline, vector<string> &args
     int line_count = 0;
 
     if (args[0] == "write-csv-to") {
-        std::vector<std::vector<const char *> >::iterator row_iter;
-        std::vector<const char *>::iterator iter;
         std::vector<db_label_source::header_meta>::iterator hdr_iter;
         bool first = true;
 
@@ -722,22 +737,17 @@ static string com_save_to(exec_context &ec, string cmdline, vector<string> &args
         }
         fprintf(outfile, "\n");
 
-        for (row_iter = dls.dls_rows.begin();
-             row_iter != dls.dls_rows.end();
-             ++row_iter) {
-            if (ec.ec_dry_run &&
-                distance(dls.dls_rows.begin(), row_iter) > 10) {
+        for (size_t row = 0; row < dls.dls_rows.size(); row++) {
+            if (ec.ec_dry_run && row > 10) {
                 break;
             }
 
             first = true;
-            for (iter = row_iter->begin();
-                 iter != row_iter->end();
-                 ++iter) {
+            for (size_t col = 0; col < dls.dls_headers.size(); col++) {
                 if (!first) {
                     fprintf(outfile, ",");
                 }
-                csv_write_string(outfile, *iter);
+                csv_write_string(outfile, dls.get_cell(row, col));
                 first = false;
             }
             fprintf(outfile, "\n");
@@ -808,21 +818,13 @@ static string com_save_to(exec_context &ec, string cmdline, vector<string> &args
     }
     else if (args[0] == "write-raw-to") {
         if (tc == &lnav_data.ld_views[LNV_DB]) {
-            std::vector<std::vector<const char *> >::iterator row_iter;
-            std::vector<const char *>::iterator iter;
-
-            for (row_iter = dls.dls_rows.begin();
-                 row_iter != dls.dls_rows.end();
-                 ++row_iter) {
-                if (ec.ec_dry_run &&
-                    distance(dls.dls_rows.begin(), row_iter) > 10) {
+            for (size_t row = 0; row < dls.dls_rows.size(); row++) {
+                if (ec.ec_dry_run && row > 10) {
                     break;
                 }
 
-                for (iter = row_iter->begin();
-                     iter != row_iter->end();
-                     ++iter) {
-                    fputs(*iter, outfile);
+                for (size_t col = 0; col < dls.dls_headers.size(); col++) {
+                    fputs(dls.get_cell(row, col).c_str(), outfile);
                 }
                 fprintf(outfile, "\n");
 
@@ -896,6 +898,504 @@ static string com_save_to(exec_context &ec, string cmdline, vector<string> &args
     return retval;
 }
 
+/**
+ * Buffered destination for the export-*-to commands.  The output is
+ * compressed with gzip if the file name ends with ".gz".
+ */
+class export_output {
+public:
+    static const size_t BUFFER_SIZE = 256 * 1024;
+
+    ~export_output() {
+        this->close();
+    };
+
+    /**
+     * @return An error message or an empty string if the output was opened.
+     */
+    string open(exec_context &ec, const string &path) {
+        if (path == "-" || path == "/dev/stdout") {
+            auto ec_out = ec.get_output();
+
+            if (!ec_out) {
+                return "error: use :redirect-to or run in headless mode to "
+                       "export to the standard output";
+            }
+            this->eo_file = *ec_out;
+            if (this->eo_file == stdout) {
+                lnav_data.ld_stdout_used = true;
+            }
+        }
+        else if (endswith(path.c_str(), ".gz")) {
+            if ((this->eo_gz = gzopen(path.c_str(), "wb")) == nullptr) {
+                return "error: unable to open file -- " + path;
+            }
+            gzbuffer(this->eo_gz, BUFFER_SIZE);
+        }
+        else if ((this->eo_file = fopen(path.c_str(), "w")) == nullptr) {
+            return "error: unable to open file -- " + path;
+        }
+        else {
+            this->eo_owned = true;
+            setvbuf(this->eo_file, nullptr, _IOFBF, BUFFER_SIZE);
+        }
+
+        return "";
+    };
+
+    void write(const char *data, size_t len) {
+        if (this->eo_gz != nullptr) {
+            gzwrite(this->eo_gz, data, len);
+        } else {
+            fwrite(data, 1, len, this->eo_file);
+        }
+    };
+
+    void write(const string &str) {
+        this->write(str.c_str(), str.length());
+    };
+
+    /**
+     * @return True if all of the data was written out successfully.
+     */
+    bool close() {
+        bool retval = true;
+
+        if (this->eo_gz != nullptr) {
+            retval = gzclose(this->eo_gz) == Z_OK;
+            this->eo_gz = nullptr;
+        }
+        else if (this->eo_file != nullptr) {
+            retval = fflush(this->eo_file) == 0 && !ferror(this->eo_file);
+            if (this->eo_owned && fclose(this->eo_file) != 0) {
+                retval = false;
+            }
+            this->eo_file = nullptr;
+        }
+
+        return retval;
+    };
+
+    static void yajl_writer(void *context, const char *str, size_t len) {
+        ((export_output *) context)->write(str, len);
+    };
+
+private:
+    FILE *eo_file{nullptr};
+    bool eo_owned{false};
+    gzFile eo_gz{nullptr};
+};
+
+static void export_csv_row(export_output &out, sqlite3_stmt *stmt)
+{
+    int ncols = sqlite3_column_count(stmt);
+
+    for (int col = 0; col < ncols; col++) {
+        if (col > 0) {
+            out.write(",", 1);
+        }
+
+        const char *value = (const char *) sqlite3_column_text(stmt, col);
+        string str = value == nullptr ? db_label_source::NULL_STR : value;
+
+        if (csv_needs_quoting(str)) {
+            out.write(csv_quote_string(str));
+        } else {
+            out.write(str);
+        }
+    }
+    out.write("\n", 1);
+}
+
+static void export_json_row(yajl_gen handle, sqlite3_stmt *stmt)
+{
+    int ncols = sqlite3_column_count(stmt);
+    yajlpp_map obj_map(handle);
+
+    for (int col = 0; col < ncols; col++) {
+        sqlite3_value *raw_value = sqlite3_column_value(stmt, col);
+
+        obj_map.gen(sqlite3_column_name(stmt, col));
+        switch (sqlite3_value_type(raw_value)) {
+            case SQLITE_NULL:
+                obj_map.gen();
+                break;
+            case SQLITE_FLOAT:
+            case SQLITE_INTEGER: {
+                const char *num = (const char *) sqlite3_value_text(raw_value);
+
+                yajl_gen_number(handle, num, strlen(num));
+                break;
+            }
+            default: {
+                const char *str = (const char *) sqlite3_value_text(raw_value);
+                size_t len = sqlite3_value_bytes(raw_value);
+
+                if (sqlite3_value_subtype(raw_value) == 74 &&
+                    json_write_json_cell(handle, str, len)) {
+                    break;
+                }
+                yajl_gen_string(handle, (const unsigned char *) str, len);
+                break;
+            }
+        }
+    }
+}
+
+/**
+ * Pick the Arrow type for a result column using the declared type of the
+ * column, if there is one, or the type of the value in the first row.
+ */
+static arrow_writer::column_type_t arrow_column_type(sqlite3_stmt *stmt, int col)
+{
+    const char *name = sqlite3_column_name(stmt, col);
+    const char *decl = sqlite3_column_decltype(stmt, col);
+
+    if (strcmp(name, "log_level") == 0) {
+        return arrow_writer::ACT_LEVEL;
+    }
+    if (decl != nullptr) {
+        if (strcasecmp(decl, "DATETIME") == 0) {
+            return arrow_writer::ACT_TIMESTAMP;
+        }
+        if (strcasestr(decl, "INT") != nullptr) {
+            return arrow_writer::ACT_INT64;
+        }
+        if (strcasestr(decl, "REAL") != nullptr ||
+            strcasestr(decl, "FLOA") != nullptr ||
+            strcasestr(decl, "DOUB") != nullptr) {
+            return arrow_writer::ACT_DOUBLE;
+        }
+        return arrow_writer::ACT_UTF8;
+    }
+
+    switch (sqlite3_column_type(stmt, col)) {
+        case SQLITE_INTEGER:
+            return arrow_writer::ACT_INT64;
+        case SQLITE_FLOAT:
+            return arrow_writer::ACT_DOUBLE;
+        default:
+            return arrow_writer::ACT_UTF8;
+    }
+}
+
+/**
+ * Remembers how the text in a timestamp column was parsed, so the format is
+ * only searched for once per column and a value that repeats the previous
+ * row is not parsed again.
+ */
+struct arrow_time_column {
+    date_time_scanner atc_scanner;
+    std::string atc_last_text;
+    int64_t atc_last_usecs{0};
+};
+
+static string arrow_type_error(sqlite3_stmt *stmt, size_t col,
+                               const char *type_name)
+{
+    return string("error: a value in column '") +
+           sqlite3_column_name(stmt, col) +
+           "' cannot be exported as " + type_name +
+           ", the column type comes from the declared type or the first row";
+}
+
+/**
+ * Check that the values in the current row fit the types of their columns.
+ * The column types cannot change once rows are written, so a value that
+ * does not fit is an error instead of being lost.  The text in timestamp
+ * columns is parsed here and kept in the time_cols for export_arrow_row().
+ *
+ * @return An error message or an empty string if the row can be written.
+ */
+static string check_arrow_row(arrow_writer &aw,
+                              vector<arrow_time_column> &time_cols,
+                              sqlite3_stmt *stmt)
+{
+    for (size_t col = 0; col < aw.get_column_count(); col++) {
+        sqlite3_value *raw_value = sqlite3_column_value(stmt, col);
+        int value_type = sqlite3_value_type(raw_value);
+
+        if (value_type == SQLITE_NULL) {
+            continue;
+        }
+
+        switch (aw.get_column_type(col)) {
+            case arrow_writer::ACT_INT64:
+                if (value_type == SQLITE_FLOAT &&
+                    sqlite3_value_double(raw_value) !=
+                    (double) sqlite3_value_int64(raw_value)) {
+                    return arrow_type_error(stmt, col, "int64");
+                }
+                if (value_type != SQLITE_INTEGER &&
+                    value_type != SQLITE_FLOAT) {
+                    return arrow_type_error(stmt, col, "int64");
+                }
+                break;
+            case arrow_writer::ACT_DOUBLE:
+                if (value_type != SQLITE_INTEGER &&
+                    value_type != SQLITE_FLOAT) {
+                    return arrow_type_error(stmt, col, "double");
+                }
+                break;
+            case arrow_writer::ACT_TIMESTAMP: {
+                if (value_type == SQLITE_INTEGER) {
+                    break;
+                }
+
+                auto &atc = time_cols[col];
+                const char *str = (const char *) sqlite3_value_text(raw_value);
+                size_t len = sqlite3_value_bytes(raw_value);
+
+                if (atc.atc_last_text.length() == len &&
+                    memcmp(atc.atc_last_text.data(), str, len) == 0) {
+                    break;
+                }
+
+                struct exttm tm;
+                struct timeval tv;
+
+                if (atc.atc_scanner.scan(str, len, nullptr,
+                                         &tm, tv) == nullptr) {
+                    return arrow_type_error(stmt, col, "a timestamp");
+                }
+                atc.atc_last_text.assign(str, len);
+                atc.atc_last_usecs = tv.tv_sec * 1000000LL + tv.tv_usec;
+                break;
+            }
+            case arrow_writer::ACT_LEVEL:
+            case arrow_writer::ACT_UTF8:
+                break;
+        }
+    }
+
+    return "";
+}
+
+/**
+ * Append the current row to the writer, the row must have been checked with
+ * check_arrow_row() first.
+ */
+static void export_arrow_row(arrow_writer &aw,
+                             const vector<arrow_time_column> &time_cols,
+                             sqlite3_stmt *stmt)
+{
+    for (size_t col = 0; col < aw.get_column_count(); col++) {
+        sqlite3_value *raw_value = sqlite3_column_value(stmt, col);
+        int value_type = sqlite3_value_type(raw_value);
+
+        if (value_type == SQLITE_NULL) {
+            aw.append_null(col);
+            continue;
+        }
+
+        switch (aw.get_column_type(col)) {
+            case arrow_writer::ACT_INT64:
+                aw.append_int64(col, sqlite3_value_int64(raw_value));
+                break;
+            case arrow_writer::ACT_DOUBLE:
+                aw.append_double(col, sqlite3_value_double(raw_value));
+                break;
+            case arrow_writer::ACT_TIMESTAMP:
+                if (value_type == SQLITE_INTEGER) {
+                    aw.append_int64(col, sqlite3_value_int64(raw_value));
+                } else {
+                    aw.append_int64(col, time_cols[col].atc_last_usecs);
+                }
+                break;
+            case arrow_writer::ACT_LEVEL: {
+                const char *str = (const char *) sqlite3_value_text(raw_value);
+                size_t len = sqlite3_value_bytes(raw_value);
+
+                aw.append_level(col, string2level(str, len, true));
+                break;
+            }
+            case arrow_writer::ACT_UTF8: {
+                const char *str = (const char *) sqlite3_value_text(raw_value);
+                size_t len = sqlite3_value_bytes(raw_value);
+
+                aw.append_string(col, str, len);
+                break;
+            }
+        }
+    }
+    aw.end_row();
+}
+
+/**
+ * Run a query and write the rows out as they are produced, instead of
+ * collecting them in the DB view first, so the memory used does not depend
+ * on the size of the result.
+ */
+static string com_export_to(exec_context &ec, string cmdline, vector<string> &args)
+{
+    if (args.empty()) {
+        args.emplace_back("filename");
+        return "";
+    }
+
+    if (lnav_data.ld_flags & LNF_SECURE_MODE) {
+        return "error: " + args[0] + " -- unavailable in secure mode";
+    }
+
+    if (args.size() < 3) {
+        return "error: expecting a file name and a SQL query";
+    }
+
+    vector<string> split_args;
+    shlex lexer(args[1]);
+    scoped_resolver scopes = {
+        &ec.ec_local_vars.top(),
+        &ec.ec_global_vars,
+    };
+
+    if (!lexer.split(split_args, scopes)) {
+        return "error: unable to parse arguments";
+    }
+    if (split_args.size() != 1) {
+        return "error: expecting a single file name";
+    }
+
+    string sql = trim(remaining_args(cmdline, args, 2));
+
+    if (ec.ec_dry_run) {
+        return "";
+    }
+
+    auto_mem<sqlite3_stmt> stmt(sqlite3_finalize);
+
+    if (sqlite3_prepare_v2(lnav_data.ld_db.in(),
+                           sql.c_str(),
+                           -1,
+                           stmt.out(),
+                           nullptr) != SQLITE_OK) {
+        return ec.get_error_prefix() + sqlite3_errmsg(lnav_data.ld_db.in());
+    }
+    if (stmt == nullptr) {
+        return "error: expecting a SQL query";
+    }
+
+    bool to_json = args[0] == "export-json-to";
+    bool to_arrow = args[0] == "export-arrow-to";
+
+    if (to_arrow && endswith(split_args[0].c_str(), ".gz")) {
+        // Arrow readers need to seek to the footer, so the whole file cannot
+        // be compressed.
+        return "error: Arrow files cannot be compressed with gzip -- " +
+               split_args[0];
+    }
+
+    export_output out;
+    string retval = out.open(ec, split_args[0]);
+
+    if (!retval.empty()) {
+        return retval;
+    }
+
+    yajlpp_gen gen;
+    arrow_writer aw([&out](const char *data, size_t len) {
+        out.write(data, len);
+    });
+    int ncols = sqlite3_column_count(stmt.in());
+    vector<arrow_time_column> time_cols(ncols);
+    auto add_arrow_columns = [&]() {
+        for (int col = 0; col < ncols; col++) {
+            aw.add_column(sqlite3_column_name(stmt.in(), col),
+                          arrow_column_type(stmt.in(), col));
+        }
+    };
+
+    if (to_arrow) {
+        for (auto &atc : time_cols) {
+            atc.atc_scanner.set_base_time(time(nullptr));
+        }
+    } else if (to_json) {
+        yajl_gen_config(gen, yajl_gen_beautify, 1);
+        yajl_gen_config(gen,
+                        yajl_gen_print_callback,
+                        export_output::yajl_writer,
+                        &out);
+        yajl_gen_array_open(gen);
+    } else {
+        for (int col = 0; col < ncols; col++) {
+            string colname = sqlite3_column_name(stmt.in(), col);
+
+            if (col > 0) {
+                out.write(",", 1);
+            }
+            if (csv_needs_quoting(colname)) {
+                out.write(csv_quote_string(colname));
+            } else {
+                out.write(colname);
+            }
+        }
+        out.write("\n", 1);
+    }
+
+    bind_sql_parameters(ec, stmt.in());
+
+    pair<string, int> source = ec.ec_source.top();
+    sql_progress_guard progress_guard(sql_progress,
+                                      source.first,
+                                      source.second);
+    size_t row_count = 0;
+    bool done = false;
+
+    {
+        sql_running_guard running_guard;
+
+        while (!done) {
+            switch (sqlite3_step(stmt.in())) {
+                case SQLITE_ROW:
+                    if (to_arrow) {
+                        // The column types are only known once there is a row.
+                        if (aw.get_column_count() == 0) {
+                            add_arrow_columns();
+                        }
+                        retval = check_arrow_row(aw, time_cols, stmt.in());
+                        if (!retval.empty()) {
+                            done = true;
+                            break;
+                        }
+                        export_arrow_row(aw, time_cols, stmt.in());
+                    } else if (to_json) {
+                        export_json_row(gen, stmt.in());
+                    } else {
+                        export_csv_row(out, stmt.in());
+                    }
+                    row_count += 1;
+                    break;
+                case SQLITE_OK:
+                case SQLITE_DONE:
+                    done = true;
+                    break;
+                default:
+                    retval = ec.get_error_prefix() +
+                             sqlite3_errmsg(lnav_data.ld_db.in());
+                    done = true;
+                    break;
+            }
+        }
+    }
+
+    if (to_arrow) {
+        if (aw.get_column_count() == 0) {
+            add_arrow_columns();
+        }
+        aw.finish();
+    } else if (to_json) {
+        yajl_gen_array_close(gen);
+    }
+
+    if (!out.close() && retval.empty()) {
+        retval = "error: unable to write to file -- " + split_args[0];
+    }
+    if (retval.empty()) {
+        retval = "Wrote " + to_string(row_count) + " rows to " + split_args[0];
+    }
+
+    return retval;
+}
+
 static string com_pipe_to(exec_context &ec, string cmdline, vector<string> &args)
 {
     string retval = "error: expecting command to execute";
@@ -1432,6 +1932,7 @@ static string com_create_logline_table(exec_context &ec, string cmdline, vector<
             log_data_table *ldt = new log_data_table(
                 lnav_data.ld_log_source,
                 *lnav_data.ld_vtab_manager,
+                lnav_data.ld_schema_index,
                 cl,
                 intern_string::lookup(args[1]));
 
@@ -2664,7 +3165,13 @@ static string com_zoom_to(exec_context &ec, string cmdline, vector<string> &args
                 if (hist_view.get_inner_height() > 0) {
                     old_time = lnav_data.ld_hist_source2.time_for_row(
                         lnav_data.ld_views[LNV_HISTOGRAM].get_top());
-                    rebuild_hist();
+                    if (lnav_data.ld_hist_source2.set_time_slice(
+                        ZOOM_LEVELS[lnav_data.ld_zoom_level])) {
+                        hist_view.reload_data();
+                    }
+                    else {
+                        rebuild_hist();
+                    }
                     lnav_data.ld_views[LNV_HISTOGRAM].set_top(
                         vis_line_t(
                             lnav_data.ld_hist_source2.row_for_time(old_time)));
@@ -2805,6 +3312,7 @@ static string com_toggle_field(exec_context &ec, string cmdline, vector<string>
 
                 if (format->hide_field(name, hide)) {
                     found_fields.push_back(args[lpc]);
+                    lss.invalidate_render_cache();
                     if (hide) {
                         if (lnav_data.ld_rl_view != NULL) {
                             lnav_data.ld_rl_view->set_alt_value(
@@ -3446,20 +3954,26 @@ public:
         sb_out.sb_count = this->lsvs_stats.lvs_count;
     };
 
-    void spectro_row(spectrogram_request &sr, spectrogram_row &row_out) {
+    /**
+     * Bring the index of values for the column up-to-date with the log view.
+     * The index is rebuilt from scratch if the visible lines have been
+     * renumbered, otherwise only the newly appended lines are scanned.
+     */
+    void update_index() {
         logfile_sub_source &lss = lnav_data.ld_log_source;
-        vis_line_t begin_line = lss.find_from_time(sr.sr_begin_time);
-        vis_line_t end_line = lss.find_from_time(sr.sr_end_time);
         vector<logline_value> values;
         string_attrs_t sa;
 
-        if (begin_line == -1) {
-            begin_line = 0_vl;
-        }
-        if (end_line == -1) {
-            end_line = vis_line_t(lss.text_line_count());
+        if (lss.get_index_generation() != this->lsvs_index_generation ||
+            lss.text_line_count() < this->lsvs_indexed_lines) {
+            this->lsvs_index_generation = lss.get_index_generation();
+            this->lsvs_indexed_lines = 0;
+            this->lsvs_points.clear();
         }
-        for (vis_line_t curr_line = begin_line; curr_line < end_line; ++curr_line) {
+
+        for (vis_line_t curr_line = vis_line_t(this->lsvs_indexed_lines);
+             curr_line < vis_line_t(lss.text_line_count());
+             ++curr_line) {
             content_line_t cl = lss.at(curr_line);
             std::shared_ptr<logfile> lf = lss.find(cl);
             auto ll = lf->begin() + cl;
@@ -3483,75 +3997,72 @@ public:
             if (lv_iter != values.end()) {
                 switch (lv_iter->lv_kind) {
                     case logline_value::VALUE_FLOAT:
-                        row_out.add_value(sr, lv_iter->lv_value.d, ll->is_marked());
+                        this->lsvs_points.emplace_back(
+                            ll->get_time(), lv_iter->lv_value.d, curr_line);
                         break;
                     case logline_value::VALUE_INTEGER:
-                        row_out.add_value(sr, lv_iter->lv_value.i, ll->is_marked());
+                        this->lsvs_points.emplace_back(
+                            ll->get_time(), lv_iter->lv_value.i, curr_line);
                         break;
                     default:
                         break;
                 }
             }
         }
+        this->lsvs_indexed_lines = lss.text_line_count();
     };
 
-    void spectro_mark(textview_curses &tc,
-                      time_t begin_time, time_t end_time,
-                      double range_min, double range_max) {
-        // XXX need to refactor this and the above method
-        textview_curses &log_tc = lnav_data.ld_views[LNV_LOG];
+    struct value_point {
+        value_point(time_t time, double value, vis_line_t line)
+            : vp_time(time), vp_value(value), vp_line(line) {
+        };
+
+        bool operator<(time_t rhs) const {
+            return this->vp_time < rhs;
+        };
+
+        time_t vp_time;
+        double vp_value;
+        vis_line_t vp_line;
+    };
+
+    void spectro_row(spectrogram_request &sr, spectrogram_row &row_out) {
         logfile_sub_source &lss = lnav_data.ld_log_source;
-        vis_line_t begin_line = lss.find_from_time(begin_time);
-        vis_line_t end_line = lss.find_from_time(end_time);
-        vector<logline_value> values;
-        string_attrs_t sa;
 
-        if (begin_line == -1) {
-            begin_line = 0_vl;
-        }
-        if (end_line == -1) {
-            end_line = vis_line_t(lss.text_line_count());
-        }
-        for (vis_line_t curr_line = begin_line; curr_line < end_line; ++curr_line) {
-            content_line_t cl = lss.at(curr_line);
-            std::shared_ptr<logfile> lf = lss.find(cl);
-            logfile::iterator ll = lf->begin() + cl;
-            log_format *format = lf->get_format();
-            shared_buffer_ref sbr;
+        this->update_index();
 
-            if (ll->is_continued()) {
-                continue;
-            }
+        auto begin_iter = lower_bound(this->lsvs_points.begin(),
+                                      this->lsvs_points.end(),
+                                      sr.sr_begin_time);
+        auto end_iter = lower_bound(begin_iter,
+                                    this->lsvs_points.end(),
+                                    sr.sr_end_time);
 
-            lf->read_full_message(ll, sbr);
-            sa.clear();
-            values.clear();
-            format->annotate(cl, sbr, sa, values, false);
+        for (auto iter = begin_iter; iter != end_iter; ++iter) {
+            logline *ll = lss.find_line(lss.at(iter->vp_line));
 
-            vector<logline_value>::iterator lv_iter;
+            row_out.add_value(sr, iter->vp_value, ll->is_marked());
+        }
+    };
 
-            lv_iter = find_if(values.begin(), values.end(),
-                              logline_value_cmp(&this->lsvs_colname));
+    void spectro_mark(textview_curses &tc,
+                      time_t begin_time, time_t end_time,
+                      double range_min, double range_max) {
+        textview_curses &log_tc = lnav_data.ld_views[LNV_LOG];
 
-            if (lv_iter != values.end()) {
-                switch (lv_iter->lv_kind) {
-                    case logline_value::VALUE_FLOAT:
-                        if (range_min <= lv_iter->lv_value.d &&
-                            lv_iter->lv_value.d <= range_max) {
-                            log_tc.toggle_user_mark(&textview_curses::BM_USER,
-                                                    curr_line);
-                        }
-                        break;
-                    case logline_value::VALUE_INTEGER:
-                        if (range_min <= lv_iter->lv_value.i &&
-                            lv_iter->lv_value.i <= range_max) {
-                            log_tc.toggle_user_mark(&textview_curses::BM_USER,
-                                                    curr_line);
-                        }
-                        break;
-                    default:
-                        break;
-                }
+        this->update_index();
+
+        auto begin_iter = lower_bound(this->lsvs_points.begin(),
+                                      this->lsvs_points.end(),
+                                      begin_time);
+        auto end_iter = lower_bound(begin_iter,
+                                    this->lsvs_points.end(),
+                                    end_time);
+
+        for (auto iter = begin_iter; iter != end_iter; ++iter) {
+            if (range_min <= iter->vp_value && iter->vp_value <= range_max) {
+                log_tc.toggle_user_mark(&textview_curses::BM_USER,
+                                        iter->vp_line);
             }
         }
     };
@@ -3561,6 +4072,9 @@ public:
     time_t lsvs_begin_time;
     time_t lsvs_end_time;
     bool lsvs_found;
+    vector<value_point> lsvs_points;
+    size_t lsvs_indexed_lines{0};
+    uint64_t lsvs_index_generation{0};
 };
 
 class db_spectro_value_source : public spectrogram_value_source {
@@ -3643,7 +4157,8 @@ public:
         for (int lpc = begin_row; lpc < end_row; lpc++) {
             double value = 0.0;
 
-            sscanf(dls.dls_rows[lpc][this->dsvs_column_index], "%lf", &value);
+            dls.dls_rows.get_cell(lpc, this->dsvs_column_index)
+                .to_double(value);
 
             row_out.add_value(sr, value, false);
         }
@@ -4050,6 +4565,53 @@ readline_context::command_t STD_COMMANDS[] = {
             .with_tags({"io", "scripting", "sql"})
             .with_example({"/tmp/table.txt"})
     },
+    {
+        "export-csv-to",
+        com_export_to,
+
+        help_text(":export-csv-to")
+            .with_summary("Execute a SQL query and write the results to the "
+                          "given file in CSV format as they are produced.  "
+                          "The results are not loaded into the DB view, so "
+                          "any size of result can be exported.  The file is "
+                          "compressed with gzip if the name ends with '.gz'")
+            .with_parameter(help_text("path", "The path to the file to write"))
+            .with_parameter(help_text("query", "The SQL query to execute"))
+            .with_tags({"io", "scripting", "sql"})
+            .with_example({"/tmp/table.csv.gz SELECT * FROM syslog_log"})
+    },
+    {
+        "export-json-to",
+        com_export_to,
+
+        help_text(":export-json-to")
+            .with_summary("Execute a SQL query and write the results to the "
+                          "given file in JSON format as they are produced.  "
+                          "The results are not loaded into the DB view, so "
+                          "any size of result can be exported.  The file is "
+                          "compressed with gzip if the name ends with '.gz'")
+            .with_parameter(help_text("path", "The path to the file to write"))
+            .with_parameter(help_text("query", "The SQL query to execute"))
+            .with_tags({"io", "scripting", "sql"})
+            .with_example({"/tmp/table.json SELECT * FROM syslog_log"})
+    },
+    {
+        "export-arrow-to",
+        com_export_to,
+
+        help_text(":export-arrow-to")
+            .with_summary("Execute a SQL query and write the results to the "
+                          "given file in the Apache Arrow IPC file format, "
+                          "also known as Feather V2, as they are produced.  "
+                          "Timestamp columns are written as microseconds "
+                          "since the epoch and the log_level column is "
+                          "dictionary-encoded.  A value that does not fit "
+                          "the type of its column is an error.")
+            .with_parameter(help_text("path", "The path to the file to write"))
+            .with_parameter(help_text("query", "The SQL query to execute"))
+            .with_tags({"io", "scripting", "sql"})
+            .with_example({"/tmp/logs.arrow SELECT log_time, log_level, log_body FROM all_logs"})
+    },
     {
         "pipe-to",
         com_pipe_to,
@@ -685,11 +685,28 @@ static struct json_path_handler ui_handlers[] = {
         json_path_handler()
 };
 
+static struct json_path_handler tuning_handlers[] = {
+        json_path_handler("sql-result-memory-limit")
+            .with_synopsis("bytes")
+            .with_min_value(0)
+            .with_description(
+                "The amount of memory that can be used to hold the results "
+                "of a SQL query before further rows are written to a "
+                "temporary file")
+            .FOR_FIELD(_lnav_config, lc_tuning_sql_result_memory_limit),
+
+        json_path_handler()
+};
+
 struct json_path_handler lnav_config_handlers[] = {
         json_path_handler("/ui/")
             .with_description("User-interface settings")
             .with_children(ui_handlers),
 
+        json_path_handler("/tuning/")
+            .with_description("Settings that control resource usage")
+            .with_children(tuning_handlers),
+
         json_path_handler("/global/")
             .with_description("Global variable definitions")
             .with_children(global_var_handlers),
@@ -114,6 +114,7 @@ struct _lnav_config {
     std::map<std::string, std::string> lc_ui_key_overrides;
     std::map<std::string, std::string> lc_global_vars;
     std::map<std::string, lnav_theme> lc_ui_theme_defs;
+    int64_t lc_tuning_sql_result_memory_limit;
 };
 
 extern struct _lnav_config lnav_config;
@@ -126,7 +126,7 @@ public:
                 case logline_value::VALUE_JSON: {
                     json_ptr_walk jpw;
 
-                    if (jpw.parse(ldh_line_value.lv_sbr.get_data(), ldh_line_value.lv_sbr.length()) == yajl_status_ok &&
+                    if (jpw.parse(ldh_line_value.text_value(), ldh_line_value.text_length()) == yajl_status_ok &&
                         jpw.complete_parse() == yajl_status_ok) {
                         this->ldh_json_pairs[ldh_line_value.lv_name] = jpw.jpw_values;
                     }
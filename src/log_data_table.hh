@@ -40,16 +40,19 @@
 #include "data_parser.hh"
 #include "column_namer.hh"
 #include "log_vtab_impl.hh"
+#include "log_schema_index.hh"
 
 class log_data_table : public log_vtab_impl {
 public:
 
     log_data_table(logfile_sub_source &lss,
                    log_vtab_manager &lvm,
+                   log_schema_index &lsi,
                    content_line_t template_line,
                    intern_string_t table_name)
         : log_vtab_impl(table_name),
           ldt_log_source(lss),
+          ldt_schema_index(lsi),
           ldt_template_line(template_line),
           ldt_parent_column_count(0),
           ldt_instance(-1) {
@@ -57,10 +60,15 @@ public:
         log_format *format = lf->get_format();
 
         this->vi_supports_indexes = false;
+        this->ldt_schema_index.enable();
         this->ldt_format_impl = lvm.lookup_impl(format->get_name());
         this->get_columns_int(this->ldt_cols);
     };
 
+    ~log_data_table() {
+        this->ldt_schema_index.disable();
+    };
+
     void get_columns_int(std::vector<vtab_column> &cols)
     {
         content_line_t cl_copy = this->ldt_template_line;
@@ -130,61 +138,77 @@ public:
 
     bool next(log_cursor &lc, logfile_sub_source &lss)
     {
+        log_schema_index &lsi = this->ldt_schema_index;
+        data_parser::schema_id_t schema;
+
         if (lc.lc_curr_line == vis_line_t(-1)) {
             this->ldt_instance = -1;
+            lsi.check_generation(lss);
         }
 
         lc.lc_curr_line = lc.lc_curr_line + vis_line_t(1);
         lc.lc_sub_index = 0;
 
+        if (lc.lc_curr_line < lsi.get_scanned_end()) {
+            // This part of the view is already indexed, so skip straight to
+            // the next message with the same schema.
+            lc.lc_curr_line = lsi.next_line(this->ldt_schema_id,
+                                            lc.lc_curr_line);
+            if (lc.lc_curr_line < lsi.get_scanned_end()) {
+                if (log_schema_index::parse_message(lss,
+                                                    lc.lc_curr_line,
+                                                    this->ldt_current_line,
+                                                    schema,
+                                                    &this->ldt_pairs) &&
+                    schema == this->ldt_schema_id) {
+                    this->ldt_instance += 1;
+                    return true;
+                }
+                // The index is out-of-date, rebuild it from this line on.
+                lsi.truncate(lc.lc_curr_line);
+            }
+        }
+
         if (lc.lc_curr_line == (int)lss.text_line_count()) {
             return true;
         }
 
-        content_line_t cl;
-
-        cl = lss.at(lc.lc_curr_line);
+        bool extend_index = lc.lc_curr_line == lsi.get_scanned_end();
+        content_line_t cl = lss.at(lc.lc_curr_line);
         std::shared_ptr<logfile> lf = lss.find(cl);
         auto lf_iter = lf->begin() + cl;
 
         if (lf_iter->is_continued()) {
+            if (extend_index) {
+                lsi.append(lc.lc_curr_line, nullptr);
+            }
             return false;
         }
 
         if (lf_iter->has_schema() &&
             !lf_iter->match_schema(this->ldt_schema_id)) {
+            // The cached schema is only a prefix of the full ID, so it is
+            // not enough to add the line to the index.  The index is not
+            // extended past this point, the idle scan will catch up.
             return false;
         }
 
-        string_attrs_t             sa;
-        struct line_range          body;
-        std::vector<logline_value> line_values;
+        bool parsed = log_schema_index::parse_message(lss,
+                                                      lc.lc_curr_line,
+                                                      this->ldt_current_line,
+                                                      schema,
+                                                      &this->ldt_pairs);
 
-        lf->read_full_message(lf_iter, this->ldt_current_line);
-        lf->get_format()->annotate(cl,
-                                   this->ldt_current_line,
-                                   sa,
-                                   line_values,
-                                   false);
-        body = find_string_attr_range(sa, &textview_curses::SA_BODY);
-        if (body.lr_end == -1) {
-            return false;
+        if (extend_index) {
+            lsi.append(lc.lc_curr_line, parsed ? &schema : nullptr);
         }
 
-        data_scanner ds(this->ldt_current_line, body.lr_start, body.lr_end);
-        data_parser  dp(&ds);
-        dp.parse();
-
-        lf_iter->set_schema(dp.dp_schema_id);
-
         /* The cached schema ID in the log line is not complete, so we still */
         /* need to check for a full match. */
-        if (dp.dp_schema_id != this->ldt_schema_id) {
+        if (!parsed || schema != this->ldt_schema_id) {
             return false;
         }
 
-        this->ldt_pairs.clear();
-        this->ldt_pairs.swap(dp.dp_pairs, __FILE__, __LINE__);
         this->ldt_instance += 1;
 
         return true;
@@ -223,12 +247,12 @@ public:
             break;
 
             default: {
-                shared_buffer_ref value_sbr;
+                string_fragment value_frag(line.get_data(),
+                                           pvalue.e_capture.c_begin,
+                                           pvalue.e_capture.c_end);
 
-                value_sbr.subset(line,
-                    pvalue.e_capture.c_begin, pvalue.e_capture.length());
                 values.emplace_back(intern_string::lookup("", 0),
-                    logline_value::VALUE_TEXT, value_sbr);
+                    logline_value::VALUE_TEXT, value_frag);
                 break;
             }
 
@@ -239,6 +263,7 @@ public:
 
 private:
     logfile_sub_source &ldt_log_source;
+    log_schema_index &ldt_schema_index;
     const content_line_t     ldt_template_line;
     data_parser::schema_id_t ldt_schema_id;
     shared_buffer_ref ldt_current_line;
@@ -805,7 +805,6 @@ void external_log_format::annotate(uint64_t line_number, shared_buffer_ref &line
         const struct scaling_factor *scaling = NULL;
         pcre_context::capture_t *cap = pc[ivd.ivd_index];
         const value_def &vd = *ivd.ivd_value_def;
-        shared_buffer_ref field;
 
         if (ivd.ivd_unit_field_index >= 0) {
             pcre_context::iterator unit_cap = pc[ivd.ivd_unit_field_index];
@@ -824,7 +823,11 @@ void external_log_format::annotate(uint64_t line_number, shared_buffer_ref &line
             }
         }
 
-        field.subset(line, cap->c_begin, cap->length());
+        string_fragment field;
+
+        if (cap->is_valid()) {
+            field = string_fragment(line.get_data(), cap->c_begin, cap->c_end);
+        }
 
         values.emplace_back(vd.vd_name,
                             vd.vd_kind,
@@ -859,6 +862,7 @@ void external_log_format::annotate(uint64_t line_number, shared_buffer_ref &line
                 }
                 value.lv_origin.lr_start += body_cap->c_begin;
                 value.lv_origin.lr_end += body_cap->c_begin;
+                value.rebase(line.get_data(), body_cap->c_begin);
             }
         }
     }
@@ -896,7 +900,8 @@ void external_log_format::rewrite(exec_context &ec,
                              ":" +
                              vd_iter->first.to_string(),
                              1);
-        string field_value = execute_any(ec, vd.vd_rewriter);
+        string field_value = execute_rewriter(ec, vd.vd_rewriter,
+                                              vd.vd_pure_rewriter);
         struct line_range adj_origin = iter->origin_in_full_msg(
             value_out.c_str(), value_out.length());
 
@@ -1943,6 +1948,10 @@ public:
                                                             this->vi_attrs,
                                                             values,
                                                             false);
+            for (auto &value : values) {
+                value.rebase(line.get_data(),
+                             this->elt_container_body.lr_start);
+            }
         }
         else {
             this->vi_attrs.clear();
@@ -46,6 +46,7 @@
 #include <limits>
 #include <memory>
 #include <sstream>
+#include <unordered_map>
 
 #include "optional.hpp"
 #include "pcrepp/pcrepp.hh"
@@ -330,6 +331,14 @@ struct scaling_factor {
     double sf_value;
 };
 
+/**
+ * A value extracted from a log message.  Text values do not own their data,
+ * they refer to the message they were extracted from, either through a
+ * shared_buffer_ref or a string_fragment.  A fragment does not keep the
+ * message alive, so the shared_buffer_ref or string that was passed to
+ * log_format::annotate() must outlive the values and must not be modified
+ * while they are in use.
+ */
 class logline_value {
 public:
     enum kind_t {
@@ -388,51 +397,67 @@ public:
             this->lv_kind = kind = VALUE_NULL;
         }
 
-        switch (kind) {
-        case VALUE_JSON:
-        case VALUE_STRUCT:
-        case VALUE_TEXT:
-        case VALUE_QUOTED:
-        case VALUE_TIMESTAMP:
+        if (this->is_text_kind()) {
             this->lv_sbr = sbr;
-            break;
-
-        case VALUE_NULL:
-            break;
-
-        case VALUE_INTEGER:
-            strtonum(this->lv_value.i, sbr.get_data(), sbr.length());
-            if (scaling != NULL) {
-                scaling->scale(this->lv_value.i);
-            }
-            break;
+        } else {
+            this->init_value(sbr.get_data(), sbr.length(), scaling);
+        }
+    };
 
-        case VALUE_FLOAT: {
-            char scan_value[sbr.length() + 1];
+    /**
+     * Construct a value that refers to a range of a message without copying
+     * it.  The caller is responsible for keeping the message alive for as
+     * long as the value is used, which is normally the current row of a
+     * cursor or the line that is being rendered.
+     */
+    logline_value(const intern_string_t name, kind_t kind,
+                  const string_fragment &frag,
+                  bool ident=false, const scaling_factor *scaling=NULL,
+                  int col=-1, int start=-1, int end=-1, bool from_module=false,
+                  const log_format *format=NULL)
+        : lv_name(name), lv_kind(kind),
+          lv_identifier(ident), lv_column(col), lv_hidden(false), lv_sub_offset(0),
+          lv_origin(start, end),
+          lv_from_module(from_module),
+          lv_format(format)
+    {
+        if (!frag.is_valid()) {
+            this->lv_kind = kind = VALUE_NULL;
+        }
 
-            memcpy(scan_value, sbr.get_data(), sbr.length());
-            scan_value[sbr.length()] = '\0';
-            this->lv_value.d = strtod(scan_value, NULL);
-            if (scaling != NULL) {
-                scaling->scale(this->lv_value.d);
-            }
-            break;
+        if (this->is_text_kind()) {
+            this->lv_frag = frag;
+        } else {
+            this->init_value(frag.data(), frag.length(), scaling);
         }
+    };
 
-        case VALUE_BOOLEAN:
-            if (strncmp(sbr.get_data(), "true", sbr.length()) == 0 ||
-                strncmp(sbr.get_data(), "yes", sbr.length()) == 0) {
-                this->lv_value.i = 1;
-            }
-            else {
-                this->lv_value.i = 0;
-            }
-            break;
+    bool is_text_kind() const {
+        switch (this->lv_kind) {
+            case VALUE_JSON:
+            case VALUE_STRUCT:
+            case VALUE_TEXT:
+            case VALUE_QUOTED:
+            case VALUE_TIMESTAMP:
+                return true;
+            default:
+                return false;
+        }
+    };
 
-        case VALUE_UNKNOWN:
-        case VALUE__MAX:
-            ensure(0);
-            break;
+    /**
+     * Move a fragment-based value so that it is relative to an enclosing
+     * message.  Used when a value was extracted from a sub-range of a
+     * message, like the body handled by a module format.
+     *
+     * @param base The start of the enclosing message.
+     * @param offset The offset of the sub-range in the enclosing message.
+     */
+    void rebase(const char *base, int offset) {
+        if (this->lv_frag.is_valid()) {
+            this->lv_frag.sf_string = base;
+            this->lv_frag.sf_begin += offset;
+            this->lv_frag.sf_end += offset;
         }
     };
 
@@ -448,27 +473,26 @@ public:
         case VALUE_STRUCT:
         case VALUE_TEXT:
         case VALUE_TIMESTAMP:
-            if (this->lv_sbr.empty()) {
-                return this->lv_intern_string.to_string();
-            }
-            return std::string(this->lv_sbr.get_data(), this->lv_sbr.length());
+            return std::string(this->text_value(), this->text_length());
 
         case VALUE_QUOTED:
-            if (this->lv_sbr.length() == 0) {
+            if (this->text_length() == 0) {
                 return "";
             } else {
-                switch (this->lv_sbr.get_data()[0]) {
+                const char *text_value = this->text_value();
+                size_t text_len = this->text_length();
+
+                switch (text_value[0]) {
                 case '\'':
                 case '"': {
-                    char unquoted_str[this->lv_sbr.length()];
+                    char unquoted_str[text_len];
                     size_t unquoted_len;
 
-                    unquoted_len = unquote(unquoted_str, this->lv_sbr.get_data(),
-                        this->lv_sbr.length());
+                    unquoted_len = unquote(unquoted_str, text_value, text_len);
                     return std::string(unquoted_str, unquoted_len);
                 }
                 default:
-                    return std::string(this->lv_sbr.get_data(), this->lv_sbr.length());
+                    return std::string(text_value, text_len);
                 }
             }
 
@@ -498,6 +522,9 @@ public:
     };
 
     const char *text_value() const {
+        if (this->lv_frag.is_valid()) {
+            return this->lv_frag.data();
+        }
         if (this->lv_sbr.empty()) {
             if (this->lv_intern_string.empty()) {
                 return "";
@@ -508,6 +535,9 @@ public:
     };
 
     const size_t text_length() const {
+        if (this->lv_frag.is_valid()) {
+            return this->lv_frag.length();
+        }
         if (this->lv_sbr.empty()) {
             return this->lv_intern_string.size();
         }
@@ -527,6 +557,7 @@ public:
         value_u(double d) : d(d) { };
     } lv_value;
     shared_buffer_ref lv_sbr;
+    string_fragment lv_frag;
     intern_string_t lv_intern_string;
     bool lv_identifier;
     int lv_column;
@@ -536,6 +567,54 @@ public:
     struct line_range lv_origin;
     bool lv_from_module;
     const log_format *lv_format;
+
+private:
+    void init_value(const char *data, size_t len,
+                    const scaling_factor *scaling) {
+        switch (this->lv_kind) {
+        case VALUE_JSON:
+        case VALUE_STRUCT:
+        case VALUE_TEXT:
+        case VALUE_QUOTED:
+        case VALUE_TIMESTAMP:
+        case VALUE_NULL:
+            break;
+
+        case VALUE_INTEGER:
+            strtonum(this->lv_value.i, data, len);
+            if (scaling != NULL) {
+                scaling->scale(this->lv_value.i);
+            }
+            break;
+
+        case VALUE_FLOAT: {
+            char scan_value[len + 1];
+
+            memcpy(scan_value, data, len);
+            scan_value[len] = '\0';
+            this->lv_value.d = strtod(scan_value, NULL);
+            if (scaling != NULL) {
+                scaling->scale(this->lv_value.d);
+            }
+            break;
+        }
+
+        case VALUE_BOOLEAN:
+            if (strncmp(data, "true", len) == 0 ||
+                strncmp(data, "yes", len) == 0) {
+                this->lv_value.i = 1;
+            }
+            else {
+                this->lv_value.i = 0;
+            }
+            break;
+
+        case VALUE_UNKNOWN:
+        case VALUE__MAX:
+            ensure(0);
+            break;
+        }
+    };
 };
 
 struct logline_value_stats {
@@ -861,7 +940,8 @@ public:
             vd_values_index(-1),
             vd_hidden(false),
             vd_user_hidden(false),
-            vd_internal(false) {
+            vd_internal(false),
+            vd_pure_rewriter(true) {
 
         };
 
@@ -879,6 +959,7 @@ public:
         bool vd_internal;
         std::vector<std::string> vd_action_list;
         std::string vd_rewriter;
+        bool vd_pure_rewriter;
         std::string vd_description;
     };
 
@@ -1192,7 +1273,7 @@ public:
         return retval;
     }
 
-    typedef std::map<intern_string_t, module_format> mod_map_t;
+    typedef std::unordered_map<intern_string_t, module_format> mod_map_t;
     static mod_map_t MODULE_FORMATS;
     static std::vector<external_log_format *> GRAPH_ORDERED_FORMATS;
 
@@ -648,9 +648,7 @@ public:
                 sa.emplace_back(lr, &logline::L_OPID);
             }
 
-            shared_buffer_ref value_ref;
-            value_ref.subset(sbr, sf.sf_begin, sf.length());
-            values.emplace_back(fd.fd_name, kind, value_ref,
+            values.emplace_back(fd.fd_name, kind, sf,
                                 fd.fd_identifier, nullptr, iter.index(),
                                 lr.lr_start, lr.lr_end, false,
                                 this);
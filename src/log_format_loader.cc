@@ -506,6 +506,11 @@ static struct json_path_handler value_def_handlers[] = {
         .with_description("A command that will rewrite this field when pretty-printing")
         .FOR_FIELD(external_log_format::value_def, vd_rewriter),
 
+    json_path_handler("pure-rewriter")
+        .with_synopsis("<bool>")
+        .with_description("Indicates whether or not the result of the rewriter only depends on the values in the line, so it can be cached")
+        .FOR_FIELD(external_log_format::value_def, vd_pure_rewriter),
+
     json_path_handler("description")
         .with_synopsis("<string>")
         .with_description("A description of the field")
@@ -0,0 +1,179 @@
+/**
+ * Copyright (c) 2019, Timothy Stack
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * * Neither the name of Timothy Stack nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+
+#include <algorithm>
+
+#include "base/lnav_log.hh"
+#include "log_schema_index.hh"
+
+bool log_schema_index::parse_message(logfile_sub_source &lss,
+                                     vis_line_t vl,
+                                     shared_buffer_ref &msg_out,
+                                     schema_id_t &schema_out,
+                                     data_parser::element_list_t *pairs_out)
+{
+    content_line_t cl = lss.at(vl);
+    std::shared_ptr<logfile> lf = lss.find(cl);
+    auto lf_iter = lf->begin() + cl;
+
+    if (lf_iter->is_continued()) {
+        return false;
+    }
+
+    string_attrs_t sa;
+    struct line_range body;
+    std::vector<logline_value> line_values;
+
+    lf->read_full_message(lf_iter, msg_out);
+    lf->get_format()->annotate(cl, msg_out, sa, line_values, false);
+    body = find_string_attr_range(sa, &textview_curses::SA_BODY);
+    if (body.lr_end == -1) {
+        return false;
+    }
+
+    data_scanner ds(msg_out, body.lr_start, body.lr_end);
+    data_parser dp(&ds);
+    dp.parse();
+
+    lf_iter->set_schema(dp.dp_schema_id);
+    schema_out = dp.dp_schema_id;
+    if (pairs_out != nullptr) {
+        pairs_out->clear();
+        pairs_out->swap(dp.dp_pairs, __FILE__, __LINE__);
+    }
+
+    return true;
+}
+
+void log_schema_index::check_generation(logfile_sub_source &lss)
+{
+    if (lss.get_index_generation() == this->lsi_index_generation &&
+        this->lsi_scanned_end <= vis_line_t(lss.text_line_count())) {
+        return;
+    }
+
+    this->lsi_index_generation = lss.get_index_generation();
+    this->lsi_scanned_end = 0_vl;
+    this->lsi_lines.clear();
+}
+
+void log_schema_index::disable()
+{
+    require(this->lsi_users > 0);
+
+    this->lsi_users -= 1;
+    if (this->lsi_users == 0) {
+        this->lsi_index_generation = 0;
+        this->lsi_scanned_end = 0_vl;
+        this->lsi_lines.clear();
+    }
+}
+
+void log_schema_index::append(vis_line_t vl, const schema_id_t *schema)
+{
+    require(vl == this->lsi_scanned_end);
+
+    if (schema != nullptr) {
+        this->lsi_lines[*schema].push_back(vl);
+    }
+    this->lsi_scanned_end = this->lsi_scanned_end + 1_vl;
+}
+
+void log_schema_index::truncate(vis_line_t vl)
+{
+    if (vl >= this->lsi_scanned_end) {
+        return;
+    }
+
+    for (auto iter = this->lsi_lines.begin(); iter != this->lsi_lines.end();) {
+        auto &lines = iter->second;
+
+        lines.erase(std::lower_bound(lines.begin(), lines.end(), vl),
+                    lines.end());
+        if (lines.empty()) {
+            iter = this->lsi_lines.erase(iter);
+        } else {
+            ++iter;
+        }
+    }
+    this->lsi_scanned_end = vl;
+}
+
+bool log_schema_index::scan(logfile_sub_source &lss,
+                            size_t max_lines,
+                            mstime_t max_time_ms)
+{
+    static const size_t TIME_CHECK_INTERVAL = 32;
+
+    vis_line_t end(lss.text_line_count());
+    mstime_t deadline = max_time_ms > 0 ? getmstime() + max_time_ms : 0;
+    shared_buffer_ref msg;
+
+    this->check_generation(lss);
+    for (size_t lpc = 0;
+         lpc < max_lines && this->lsi_scanned_end < end;
+         lpc++) {
+        vis_line_t vl = this->lsi_scanned_end;
+        schema_id_t schema;
+
+        if (deadline != 0 && lpc > 0 && (lpc % TIME_CHECK_INTERVAL) == 0 &&
+            getmstime() >= deadline) {
+            break;
+        }
+
+        if (parse_message(lss, vl, msg, schema, nullptr)) {
+            this->append(vl, &schema);
+        } else {
+            this->append(vl, nullptr);
+        }
+    }
+
+    return this->lsi_scanned_end == end;
+}
+
+vis_line_t log_schema_index::next_line(const schema_id_t &schema,
+                                       vis_line_t vl) const
+{
+    auto lines_iter = this->lsi_lines.find(schema);
+
+    if (lines_iter == this->lsi_lines.end()) {
+        return this->lsi_scanned_end;
+    }
+
+    const auto &lines = lines_iter->second;
+    auto iter = std::lower_bound(lines.begin(), lines.end(), vl);
+
+    if (iter == lines.end()) {
+        return this->lsi_scanned_end;
+    }
+
+    return *iter;
+}
@@ -0,0 +1,142 @@
+/**
+ * Copyright (c) 2019, Timothy Stack
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * * Neither the name of Timothy Stack nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef lnav_log_schema_index_hh
+#define lnav_log_schema_index_hh
+
+#include <map>
+#include <vector>
+
+#include "data_parser.hh"
+#include "lnav_util.hh"
+#include "logfile_sub_source.hh"
+
+/**
+ * An index from the schema ID of a message body to the visible lines in
+ * the log view that share that schema.  The logline tables use the index
+ * to jump between matching rows instead of parsing every message in the
+ * view on each query.
+ *
+ * The index is built up incrementally, either while a table is being
+ * scanned or in the background when lnav is idle.  Any lines before
+ * get_scanned_end() are covered by the index.  If the visible lines are
+ * renumbered, the index is thrown away and rebuilt.
+ */
+class log_schema_index {
+public:
+    typedef data_parser::schema_id_t schema_id_t;
+
+    /**
+     * Parse the body of a log message.
+     *
+     * @param lss The log source that contains the message.
+     * @param vl The visible line of the start of the message.
+     * @param msg_out The buffer to read the full message into.
+     * @param schema_out The schema ID of the message body.
+     * @param pairs_out If not null, the key/value pairs found in the body.
+     * @return False if the line is not the start of a message or the message
+     *   has no body.
+     */
+    static bool parse_message(logfile_sub_source &lss,
+                              vis_line_t vl,
+                              shared_buffer_ref &msg_out,
+                              schema_id_t &schema_out,
+                              data_parser::element_list_t *pairs_out);
+
+    /**
+     * Start maintaining the index in the background.  This is only done
+     * while a logline table exists since it is not free.  Each call needs
+     * to be matched by a call to disable().
+     */
+    void enable() {
+        this->lsi_users += 1;
+    };
+
+    /**
+     * Stop maintaining the index once there are no more tables using it.
+     * The memory held by the index is released at that point.
+     */
+    void disable();
+
+    bool is_enabled() const {
+        return this->lsi_users > 0;
+    };
+
+    /**
+     * Drop the index if the visible lines have changed since it was built.
+     */
+    void check_generation(logfile_sub_source &lss);
+
+    /**
+     * Add the next visible line to the index.
+     *
+     * @param vl The line, which must be equal to get_scanned_end().
+     * @param schema The schema ID of the message or null if the line does
+     *   not have one.
+     */
+    void append(vis_line_t vl, const schema_id_t *schema);
+
+    /**
+     * Forget about the lines starting at the given one.
+     */
+    void truncate(vis_line_t vl);
+
+    /**
+     * Index more of the log view.
+     *
+     * @param lss The log source to read from.
+     * @param max_lines The maximum number of lines to parse.
+     * @param max_time_ms If not zero, stop after this many milliseconds.
+     * @return True if the whole view is covered by the index.
+     */
+    bool scan(logfile_sub_source &lss,
+              size_t max_lines,
+              mstime_t max_time_ms = 0);
+
+    /**
+     * @param schema The schema ID to look for.
+     * @param vl The line to start looking from.
+     * @return The first line at or after the given one with the schema or
+     *   get_scanned_end() if there are no more in the indexed part of the
+     *   view.
+     */
+    vis_line_t next_line(const schema_id_t &schema, vis_line_t vl) const;
+
+    vis_line_t get_scanned_end() const {
+        return this->lsi_scanned_end;
+    };
+
+private:
+    int lsi_users{0};
+    uint64_t lsi_index_generation{0};
+    vis_line_t lsi_scanned_end{0};
+    std::map<schema_id_t, std::vector<vis_line_t>> lsi_lines;
+};
+
+#endif
@@ -34,6 +34,7 @@
 
 #include <string>
 #include <vector>
+#include <algorithm>
 
 #include "logfile.hh"
 #include "sql_util.hh"
@@ -99,40 +100,86 @@ public:
         keys_inout.push_back("log_msg_instance");
     };
 
+    /**
+     * Forget the lines that were found to match in earlier scans if the
+     * visible lines have been renumbered since.
+     */
+    void check_match_cache(logfile_sub_source &lss)
+    {
+        if (lss.get_index_generation() != this->lst_index_generation ||
+            this->lst_scanned_end > vis_line_t(lss.text_line_count())) {
+            this->lst_index_generation = lss.get_index_generation();
+            this->lst_match_lines.clear();
+            this->lst_scanned_end = 0_vl;
+        }
+    };
+
+    bool match_line(logfile_sub_source &lss, vis_line_t vl)
+    {
+        content_line_t cl = lss.at(vl);
+        std::shared_ptr<logfile> lf = lss.find(cl);
+        auto lf_iter = lf->begin() + cl;
+
+        if (lf_iter->is_continued()) {
+            return false;
+        }
+
+        lf->read_full_message(lf_iter, this->lst_current_line);
+        pcre_input pi(this->lst_current_line.get_data(),
+                      0,
+                      this->lst_current_line.length());
+
+        return this->lst_regex.match(this->lst_match_context, pi);
+    };
+
     bool next(log_cursor &lc, logfile_sub_source &lss)
     {
         if (lc.lc_curr_line == vis_line_t(-1)) {
             this->lst_instance = -1;
+            this->check_match_cache(lss);
         }
 
         lc.lc_curr_line = lc.lc_curr_line + vis_line_t(1);
         lc.lc_sub_index = 0;
 
+        if (lc.lc_curr_line < this->lst_scanned_end) {
+            // An earlier scan already checked these lines, so go straight to
+            // the next one that matched.
+            auto iter = std::lower_bound(this->lst_match_lines.begin(),
+                                         this->lst_match_lines.end(),
+                                         lc.lc_curr_line);
+
+            if (iter == this->lst_match_lines.end()) {
+                lc.lc_curr_line = this->lst_scanned_end;
+            } else {
+                lc.lc_curr_line = *iter;
+                if (this->match_line(lss, lc.lc_curr_line)) {
+                    this->lst_instance += 1;
+                    return true;
+                }
+                // The line changed out from under the cache, so drop
+                // everything from here on and scan it again.
+                this->lst_match_lines.erase(iter, this->lst_match_lines.end());
+                this->lst_scanned_end = lc.lc_curr_line;
+            }
+        }
+
         if (lc.lc_curr_line == (int)lss.text_line_count()) {
             return true;
         }
 
-        content_line_t cl;
+        // Only the regex is evaluated here, the message is annotated by the
+        // caller if one of the log columns is actually requested.
+        bool matched = this->match_line(lss, lc.lc_curr_line);
 
-        cl = lss.at(lc.lc_curr_line);
-        std::shared_ptr<logfile> lf = lss.find(cl);
-        auto lf_iter = lf->begin() + cl;
-
-        if (lf_iter->is_continued()) {
-            return false;
+        if (lc.lc_curr_line == this->lst_scanned_end) {
+            if (matched) {
+                this->lst_match_lines.push_back(lc.lc_curr_line);
+            }
+            this->lst_scanned_end = this->lst_scanned_end + 1_vl;
         }
 
-        string_attrs_t             sa;
-        std::vector<logline_value> line_values;
-
-        lf->read_full_message(lf_iter, this->lst_current_line);
-        lf->get_format()->annotate(cl, this->lst_current_line, sa, line_values,
-                                   false);
-        pcre_input pi(this->lst_current_line.get_data(),
-                      0,
-                      this->lst_current_line.length());
-
-        if (!this->lst_regex.match(this->lst_match_context, pi)) {
+        if (!matched) {
             return false;
         }
 
@@ -158,10 +205,13 @@ public:
         values.back().lv_column = next_column++;
         for (int lpc = 0; lpc < this->lst_regex.get_capture_count(); lpc++) {
             pcre_context::capture_t *cap = this->lst_match_context[lpc];
-            shared_buffer_ref value_sbr;
+            string_fragment value_frag;
 
-            value_sbr.subset(line, cap->c_begin, cap->length());
-            values.emplace_back(empty, this->lst_column_types[lpc], value_sbr);
+            if (cap->is_valid()) {
+                value_frag = string_fragment(
+                    line.get_data(), cap->c_begin, cap->c_end);
+            }
+            values.emplace_back(empty, this->lst_column_types[lpc], value_frag);
             values.back().lv_column = next_column++;
         }
     };
@@ -173,6 +223,9 @@ public:
     std::vector<logline_value::kind_t> lst_column_types;
     int64_t lst_instance;
     std::vector<vtab_column> lst_cols;
+    uint64_t lst_index_generation{0};
+    vis_line_t lst_scanned_end{0};
+    std::vector<vis_line_t> lst_match_lines;
 };
 
 #endif
@@ -48,6 +48,7 @@ static const char *LOG_COLUMNS = R"(  (
   log_part        TEXT     COLLATE naturalnocase,  -- The partition the message is in
   log_time        DATETIME,                        -- The adjusted timestamp for the log message
   log_actual_time DATETIME HIDDEN,                 -- The timestamp from the original log file for this message
+  log_time_usecs  INTEGER  HIDDEN,                 -- The adjusted timestamp in microseconds since the epoch
   log_idle_msecs  INTEGER,                         -- The difference in time between this messages and the previous
   log_level       TEXT     COLLATE loglevel,       -- The log message level
   log_mark        BOOLEAN,                         -- True if the log message was marked
@@ -396,6 +397,12 @@ static int vt_column(sqlite3_vtab_cursor *cur, sqlite3_context *ctx, int col)
             break;
         }
 
+    case VT_COL_LOG_TIME_USECS:
+        sqlite3_result_int64(ctx,
+                             ll->get_time() * 1000000LL +
+                             ll->get_millis() * 1000LL);
+        break;
+
     case VT_COL_IDLE_MSECS:
         if (vc->log_cursor.lc_curr_line == 0) {
             sqlite3_result_int64(ctx, 0);
@@ -597,12 +604,12 @@ static int vt_column(sqlite3_vtab_cursor *cur, sqlite3_context *ctx, int col)
                     break;
                 }
                 case logline_value::VALUE_QUOTED:
-                    if (lv_iter->lv_sbr.length() == 0) {
+                    if (lv_iter->text_length() == 0) {
                         sqlite3_result_text(ctx, "", 0, SQLITE_STATIC);
                     }
                     else {
-                        const char *text_value = lv_iter->lv_sbr.get_data();
-                        size_t text_len = lv_iter->lv_sbr.length();
+                        const char *text_value = lv_iter->text_value();
+                        size_t text_len = lv_iter->text_length();
 
                         switch (text_value[0]) {
                         case '\'':
@@ -620,7 +627,7 @@ static int vt_column(sqlite3_vtab_cursor *cur, sqlite3_context *ctx, int col)
                         }
                         default: {
                             sqlite3_result_text(ctx, text_value,
-                                lv_iter->lv_sbr.length(), SQLITE_TRANSIENT);
+                                text_len, SQLITE_TRANSIENT);
                             break;
                         }
                         }
@@ -732,6 +739,52 @@ static int vt_filter(sqlite3_vtab_cursor *p_vtc,
             }
             break;
 
+        case VT_COL_LOG_TIME_USECS: {
+            if (sqlite3_value_numeric_type(argv[lpc]) != SQLITE_INTEGER) {
+                break;
+            }
+
+            int64_t usecs = sqlite3_value_int64(argv[lpc]);
+            auto find_usecs = [vt](int64_t us) {
+                struct timeval tv;
+                vis_line_t vl;
+
+                tv.tv_sec = us / 1000000LL;
+                tv.tv_usec = us % 1000000LL;
+                if ((vl = vt->lss->find_from_time(tv)) == -1) {
+                    vl = vis_line_t(vt->lss->text_line_count());
+                }
+                return vl;
+            };
+            log_cursor &lc = p_cur->log_cursor;
+
+            switch (index[lpc].op) {
+                case SQLITE_INDEX_CONSTRAINT_EQ:
+                    lc.lc_curr_line = std::max(lc.lc_curr_line,
+                                               find_usecs(usecs));
+                    lc.lc_end_line = std::min(lc.lc_end_line,
+                                              find_usecs(usecs + 1));
+                    break;
+                case SQLITE_INDEX_CONSTRAINT_GE:
+                    lc.lc_curr_line = std::max(lc.lc_curr_line,
+                                               find_usecs(usecs));
+                    break;
+                case SQLITE_INDEX_CONSTRAINT_GT:
+                    lc.lc_curr_line = std::max(lc.lc_curr_line,
+                                               find_usecs(usecs + 1));
+                    break;
+                case SQLITE_INDEX_CONSTRAINT_LE:
+                    lc.lc_end_line = std::min(lc.lc_end_line,
+                                              find_usecs(usecs + 1));
+                    break;
+                case SQLITE_INDEX_CONSTRAINT_LT:
+                    lc.lc_end_line = std::min(lc.lc_end_line,
+                                              find_usecs(usecs));
+                    break;
+            }
+            break;
+        }
+
         }
     }
 
@@ -776,6 +829,7 @@ static int vt_best_index(sqlite3_vtab *tab, sqlite3_index_info *p_info)
 
             switch (p_info->aConstraint[lpc].iColumn) {
             case VT_COL_LOG_TIME:
+            case VT_COL_LOG_TIME_USECS:
                 argvInUse += 1;
                 indexes.push_back(p_info->aConstraint[lpc]);
                 p_info->aConstraintUsage[lpc].argvIndex = argvInUse;
@@ -945,7 +999,10 @@ static int progress_callback(void *ptr)
 {
     int retval = 0;
 
-    if (log_vtab_data.lvd_progress != NULL) {
+    if (log_vtab_data.lvd_poll != nullptr) {
+        retval = log_vtab_data.lvd_poll();
+    }
+    else if (log_vtab_data.lvd_progress != NULL) {
         retval = log_vtab_data.lvd_progress(log_cursor_latest);
     }
 
@@ -982,6 +1039,8 @@ string log_vtab_manager::register_vtab(log_vtab_impl *vi)
                           NULL,
                           errmsg.out());
         if (rc != SQLITE_OK) {
+            // The caller still owns the table if it could not be created.
+            this->vm_impls.erase(vi->get_name());
             retval = errmsg;
         }
     }
@@ -1011,7 +1070,10 @@ string log_vtab_manager::unregister_vtab(intern_string_t name)
                            NULL,
                            NULL);
 
-        this->vm_impls.erase(name);
+        auto iter = this->vm_impls.find(name);
+
+        delete iter->second;
+        this->vm_impls.erase(iter);
     }
 
     return retval;
@@ -44,6 +44,7 @@ enum {
     VT_COL_PARTITION,
     VT_COL_LOG_TIME,
     VT_COL_LOG_ACTUAL_TIME,
+    VT_COL_LOG_TIME_USECS,
     VT_COL_IDLE_MSECS,
     VT_COL_LEVEL,
     VT_COL_MARK,
@@ -194,9 +195,15 @@ protected:
 };
 
 typedef int (*sql_progress_callback_t)(const log_cursor &lc);
+/**
+ * Called from the SQLite progress handler, so it runs for every kind of
+ * query and not just ones that read a log table.
+ */
+typedef int (*sql_poll_callback_t)();
 
 extern struct _log_vtab_data {
     sql_progress_callback_t lvd_progress;
+    sql_poll_callback_t lvd_poll;
     std::string lvd_source;
     int lvd_line_number{0};
 } log_vtab_data;
@@ -205,14 +212,17 @@ class sql_progress_guard {
 public:
     sql_progress_guard(sql_progress_callback_t cb,
                        const std::string &source,
-                       int line_number) {
+                       int line_number,
+                       sql_poll_callback_t poll = nullptr) {
         log_vtab_data.lvd_progress = cb;
+        log_vtab_data.lvd_poll = poll;
         log_vtab_data.lvd_source = source;
         log_vtab_data.lvd_line_number = line_number;
     };
 
     ~sql_progress_guard() {
         log_vtab_data.lvd_progress = NULL;
+        log_vtab_data.lvd_poll = nullptr;
         log_vtab_data.lvd_source.clear();
         log_vtab_data.lvd_line_number = 0;
     };
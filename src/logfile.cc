@@ -345,6 +345,7 @@ logfile::rebuild_result_t logfile::rebuild_index()
         this->lf_sort_needed = false;
 
         auto prev_range = file_range{off};
+        this->lf_partial_index = false;
         while (true) {
             auto load_result = this->lf_line_buffer.load_next_line(prev_range);
 
@@ -406,6 +407,9 @@ logfile::rebuild_result_t logfile::rebuild_index()
             }
 
             if (!has_format && this->lf_format != nullptr) {
+                // The rest of the file is indexed on the next pass, now that
+                // the format is known.
+                this->lf_partial_index = true;
                 break;
             }
         }
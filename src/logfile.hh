@@ -343,6 +343,14 @@ public:
      */
     rebuild_result_t rebuild_index();
 
+    /**
+     * @return True if the last call to rebuild_index() stopped before
+     * reaching the end of the data that was available.
+     */
+    bool has_unindexed_data() const {
+        return this->lf_partial_index;
+    };
+
     void reobserve_from(iterator iter);
 
     void set_logfile_observer(logfile_observer *lo) {
@@ -412,6 +420,7 @@ protected:
     struct timeval lf_time_offset{0, 0};
     bool lf_is_closed{false};
     bool lf_partial_line{false};
+    bool lf_partial_index{false};
     logline_observer *lf_logline_observer{nullptr};
     logfile_observer *lf_logfile_observer{nullptr};
     size_t lf_longest_line{0};
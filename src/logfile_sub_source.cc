@@ -181,10 +181,102 @@ void logfile_sub_source::text_value_for_line(textview_curses &tc,
     this->lss_token_file   = this->find(line);
     this->lss_token_line   = this->lss_token_file->begin() + line;
 
+    if (flags & (RF_FULL | RF_REWRITE)) {
+        this->render_line(row, value_out);
+    } else {
+        view_colors &vc = view_colors::singleton();
+        content_line_t cl = this->at(vis_line_t(row));
+        render_cache_entry &rce = this->lss_render_cache[cl % RENDER_CACHE_SIZE];
+        file_range fr = this->lss_token_file->get_file_range(
+            this->lss_token_line, false);
+        struct timeval tv = this->lss_token_line->get_timeval();
+
+        if (rce.matches(cl, this->lss_render_generation,
+                        vc.vc_theme_generation, fr, tv)) {
+            this->lss_token_value = rce.rce_token_value;
+            this->lss_token_attrs = rce.rce_attrs;
+            this->lss_token_value_attrs = rce.rce_value_attrs;
+            this->lss_token_shift_start = rce.rce_shift_start;
+            this->lss_token_shift_size = rce.rce_shift_size;
+            value_out = rce.rce_value_out;
+        } else {
+            this->render_line(row, value_out);
+
+            rce.rce_valid = true;
+            rce.rce_line = cl;
+            rce.rce_generation = this->lss_render_generation;
+            rce.rce_theme_generation = vc.vc_theme_generation;
+            rce.rce_range = fr;
+            rce.rce_time = tv;
+            rce.rce_token_value = this->lss_token_value;
+            rce.rce_value_out = value_out;
+            rce.rce_attrs = this->lss_token_attrs;
+            rce.rce_value_attrs = this->lss_token_value_attrs;
+            rce.rce_shift_start = this->lss_token_shift_start;
+            rce.rce_shift_size = this->lss_token_shift_size;
+        }
+    }
+
+    if (this->lss_flags & F_FILENAME || this->lss_flags & F_BASENAME) {
+        size_t file_offset_end;
+        std::string name;
+        if (this->lss_flags & F_FILENAME) {
+            file_offset_end = this->lss_filename_width;
+            name = this->lss_token_file->get_filename();
+            if (file_offset_end < name.size()) {
+                file_offset_end = name.size();
+                this->lss_filename_width = name.size();
+            }
+        } else {
+            file_offset_end = this->lss_basename_width;
+            name = this->lss_token_file->get_unique_path();
+            if (file_offset_end < name.size()) {
+                file_offset_end = name.size();
+                this->lss_basename_width = name.size();
+            }
+        }
+        value_out.insert(0, file_offset_end - name.size() + 1, ' ');
+        value_out.insert(0, name);
+    } else {
+        // Insert space for the file/search-hit markers.
+        value_out.insert(0, 1, ' ');
+    }
+
+    if (this->lss_flags & F_TIME_OFFSET) {
+        int64_t start_millis, curr_millis;
+
+        vis_line_t prev_mark =
+            tc.get_bookmarks()[&textview_curses::BM_USER].prev(vis_line_t(row));
+        if (prev_mark == -1) {
+            prev_mark = vis_line_t(0);
+        }
+
+        logline *first_line = this->find_line(this->at(prev_mark));
+        start_millis = first_line->get_time_in_millis();
+        curr_millis = this->lss_token_line->get_time_in_millis();
+        int64_t diff = curr_millis - start_millis;
+
+        value_out = "|" + value_out;
+        string relstr;
+        size_t rel_length = str2reltime(diff, relstr);
+        value_out.insert(0, relstr);
+        if (rel_length < 12) {
+            value_out.insert(0, 12 - rel_length, ' ');
+        }
+    }
+}
+
+void logfile_sub_source::render_line(int row, string &value_out)
+{
+    view_colors &vc = view_colors::singleton();
+    int line = std::distance(this->lss_token_file->begin(),
+                             this->lss_token_line);
+    std::vector<logline_value> values;
+
     this->lss_token_attrs.clear();
-    this->lss_token_values.clear();
+    this->lss_token_value_attrs.clear();
     this->lss_share_manager.invalidate_refs();
-    if (flags & text_sub_source::RF_FULL) {
+    if (this->lss_token_flags & text_sub_source::RF_FULL) {
         shared_buffer_ref sbr;
 
         this->lss_token_file->read_full_message(this->lss_token_line, sbr);
@@ -205,17 +297,26 @@ void logfile_sub_source::text_value_for_line(textview_curses &tc,
         format->scrub(value_out);
     }
 
+    // The values refer to the text of the message, so they need to point
+    // at a copy when a rewrite is going to replace the token value.
+    const string *msg_text = &this->lss_token_value;
+    string rewrite_src;
+
+    if (this->lss_token_flags & RF_REWRITE) {
+        rewrite_src = this->lss_token_value;
+        msg_text = &rewrite_src;
+    }
+
     shared_buffer_ref sbr;
 
     sbr.share(this->lss_share_manager,
-              (char *)this->lss_token_value.c_str(), this->lss_token_value.size());
-    format->annotate(line, sbr, this->lss_token_attrs, this->lss_token_values,
-                     false);
+              (char *)msg_text->c_str(), msg_text->size());
+    format->annotate(line, sbr, this->lss_token_attrs, values, false);
     if (this->lss_token_line->get_sub_offset() != 0) {
         this->lss_token_attrs.clear();
     }
-    if (flags & RF_REWRITE) {
-        exec_context ec(&this->lss_token_values, pretty_sql_callback, pretty_pipe_callback);
+    if (this->lss_token_flags & RF_REWRITE) {
+        exec_context ec(&values, pretty_sql_callback, pretty_pipe_callback);
         string rewritten_line;
 
         ec.ec_top_line = vis_line_t(row);
@@ -273,52 +374,33 @@ void logfile_sub_source::text_value_for_line(textview_curses &tc,
         }
     }
 
-    if (this->lss_flags & F_FILENAME || this->lss_flags & F_BASENAME) {
-        size_t file_offset_end;
-        std::string name;
-        if (this->lss_flags & F_FILENAME) {
-            file_offset_end = this->lss_filename_width;
-            name = this->lss_token_file->get_filename();
-            if (file_offset_end < name.size()) {
-                file_offset_end = name.size();
-                this->lss_filename_width = name.size();
-            }
-        } else {
-            file_offset_end = this->lss_basename_width;
-            name = this->lss_token_file->get_unique_path();
-            if (file_offset_end < name.size()) {
-                file_offset_end = name.size();
-                this->lss_basename_width = name.size();
-            }
+    for (const auto &line_value : values) {
+        if ((!(this->lss_token_flags & RF_FULL) &&
+            line_value.lv_sub_offset != this->lss_token_line->get_sub_offset()) ||
+            !line_value.lv_origin.is_valid()) {
+            continue;
         }
-        value_out.insert(0, file_offset_end - name.size() + 1, ' ');
-        value_out.insert(0, name);
-    } else {
-        // Insert space for the file/search-hit markers.
-        value_out.insert(0, 1, ' ');
-    }
 
-    if (this->lss_flags & F_TIME_OFFSET) {
-        int64_t start_millis, curr_millis;
+        if (line_value.lv_hidden) {
+            this->lss_token_value_attrs.emplace_back(
+                line_value.lv_origin, &textview_curses::SA_HIDDEN);
+        }
 
-        vis_line_t prev_mark =
-            tc.get_bookmarks()[&textview_curses::BM_USER].prev(vis_line_t(row));
-        if (prev_mark == -1) {
-            prev_mark = vis_line_t(0);
+        if (!line_value.lv_identifier || !line_value.lv_origin.is_valid()) {
+            continue;
         }
 
-        logline *first_line = this->find_line(this->at(prev_mark));
-        start_millis = first_line->get_time_in_millis();
-        curr_millis = this->lss_token_line->get_time_in_millis();
-        int64_t diff = curr_millis - start_millis;
+        int id_attrs = vc.attrs_for_ident(line_value.text_value(),
+                                          line_value.text_length());
 
-        value_out = "|" + value_out;
-        string relstr;
-        size_t rel_length = str2reltime(diff, relstr);
-        value_out.insert(0, relstr);
-        if (rel_length < 12) {
-            value_out.insert(0, 12 - rel_length, ' ');
+        line_range ident_range = line_value.lv_origin;
+        if (this->lss_token_flags & RF_FULL) {
+            ident_range = line_value.origin_in_full_msg(
+                this->lss_token_value.c_str(), this->lss_token_value.length());
         }
+
+        this->lss_token_value_attrs.emplace_back(
+            ident_range, &view_curses::VC_STYLE, id_attrs);
     }
 }
 
@@ -346,8 +428,6 @@ void logfile_sub_source::text_attrs_for_line(textview_curses &lv,
         attrs |= A_UNDERLINE;
     }
 
-    const std::vector<logline_value> &line_values = this->lss_token_values;
-
     lr.lr_start = 0;
     lr.lr_end = this->lss_token_value.length();
     value_out.emplace_back(lr, &textview_curses::SA_ORIGINAL_LINE);
@@ -356,34 +436,9 @@ void logfile_sub_source::text_attrs_for_line(textview_curses &lv,
     lr.lr_end   = -1;
 
     value_out.emplace_back(lr, &view_curses::VC_STYLE, attrs);
-
-    for (const auto &line_value : line_values) {
-        if ((!(this->lss_token_flags & RF_FULL) &&
-            line_value.lv_sub_offset != this->lss_token_line->get_sub_offset()) ||
-            !line_value.lv_origin.is_valid()) {
-            continue;
-        }
-
-        if (line_value.lv_hidden) {
-            value_out.emplace_back(
-                line_value.lv_origin, &textview_curses::SA_HIDDEN);
-        }
-
-        if (!line_value.lv_identifier || !line_value.lv_origin.is_valid()) {
-            continue;
-        }
-
-        int id_attrs = vc.attrs_for_ident(line_value.text_value(),
-                                          line_value.text_length());
-
-        line_range ident_range = line_value.lv_origin;
-        if (this->lss_token_flags & RF_FULL) {
-            ident_range = line_value.origin_in_full_msg(
-                this->lss_token_value.c_str(), this->lss_token_value.length());
-        }
-
-        value_out.emplace_back(ident_range, &view_curses::VC_STYLE, id_attrs);
-    }
+    value_out.insert(value_out.end(),
+                     this->lss_token_value_attrs.begin(),
+                     this->lss_token_value_attrs.end());
 
     if (this->lss_token_shift_size) {
         shift_string_attrs(value_out, this->lss_token_shift_start + 1,
@@ -540,22 +595,23 @@ void logfile_sub_source::text_attrs_for_line(textview_curses &lv,
 logfile_sub_source::rebuild_result logfile_sub_source::rebuild_index()
 {
     iterator iter;
-    size_t total_lines = 0;
+    size_t total_lines = this->lss_index.size();
     bool full_sort = false;
     int file_count = 0;
     bool force = this->lss_force_rebuild;
     rebuild_result retval = rebuild_result::rr_no_change;
+    std::vector<logfile_data *> dirty_files;
 
     this->lss_force_rebuild = false;
     if (force) {
         retval = rebuild_result::rr_full_rebuild;
     }
 
-    for (iter = this->lss_files.begin();
-         iter != this->lss_files.end();
-         iter++) {
-        logfile_data &ld = *(*iter);
+    dirty_files.swap(this->lss_dirty_files);
+    for (auto ld_ptr : dirty_files) {
+        logfile_data &ld = *ld_ptr;
 
+        ld.ld_dirty = false;
         if (ld.get_file() == NULL) {
             if (ld.ld_lines_indexed > 0) {
                 force  = true;
@@ -565,7 +621,18 @@ logfile_sub_source::rebuild_result logfile_sub_source::rebuild_index()
         else {
             logfile &lf = *ld.get_file();
 
-            switch (lf.rebuild_index()) {
+            auto rebuild_res = lf.rebuild_index();
+
+            // A file that was still growing, or that was only partly read,
+            // might not produce a change notification for the rest of its
+            // data, so keep checking it until it has caught up.
+            if (rebuild_res == logfile::RR_NEW_LINES ||
+                rebuild_res == logfile::RR_NEW_ORDER ||
+                lf.has_unindexed_data()) {
+                this->mark_dirty(ld_ptr);
+            }
+
+            switch (rebuild_res) {
                 case logfile::RR_NO_NEW_LINES:
                     // No changes
                     break;
@@ -594,7 +661,23 @@ logfile_sub_source::rebuild_result logfile_sub_source::rebuild_index()
                     break;
             }
             file_count += 1;
-            total_lines += (*iter)->get_file()->size();
+            if (lf.size() > ld.ld_lines_indexed) {
+                total_lines += lf.size() - ld.ld_lines_indexed;
+            }
+        }
+    }
+
+    if (force) {
+        // Everything is going to be indexed again, so the totals need to
+        // come from all of the files and not just the ones that changed.
+        total_lines = 0;
+        file_count = 0;
+        for (auto ld : this->lss_files) {
+            if (ld->get_file() == nullptr) {
+                continue;
+            }
+            file_count += 1;
+            total_lines += ld->get_file()->size();
         }
     }
 
@@ -612,6 +695,7 @@ logfile_sub_source::rebuild_result logfile_sub_source::rebuild_index()
 
         this->lss_index.clear();
         this->lss_filtered_index.clear();
+        this->lss_index_generation += 1;
         this->lss_longest_line = 0;
         this->lss_basename_width = 0;
         this->lss_filename_width = 0;
@@ -620,8 +704,12 @@ logfile_sub_source::rebuild_result logfile_sub_source::rebuild_index()
     if (retval != rebuild_result::rr_no_change || force) {
         size_t index_size = 0, start_size = this->lss_index.size();
         logline_cmp line_cmper(*this);
+        // Only the files that were checked can have new lines or longer
+        // names, unless everything is being indexed again.
+        std::vector<logfile_data *> &updated_files =
+            full_sort ? this->lss_files : dirty_files;
 
-        for (auto ld : this->lss_files) {
+        for (auto ld : updated_files) {
             std::shared_ptr<logfile> lf = ld->get_file();
 
             if (lf == nullptr) {
@@ -658,10 +746,7 @@ logfile_sub_source::rebuild_result logfile_sub_source::rebuild_index()
             kmerge_tree_c<logline, logfile_data, logfile::iterator> merge(
                 file_count);
 
-            for (iter = this->lss_files.begin();
-                 iter != this->lss_files.end();
-                 iter++) {
-                logfile_data *ld = *iter;
+            for (auto ld : dirty_files) {
                 shared_ptr<logfile> lf = ld->get_file();
                 if (lf == NULL) {
                     continue;
@@ -694,13 +779,11 @@ logfile_sub_source::rebuild_result logfile_sub_source::rebuild_index()
             }
         }
 
-        for (iter = this->lss_files.begin();
-             iter != this->lss_files.end();
-             iter++) {
-            if ((*iter)->get_file() == NULL)
+        for (auto ld : updated_files) {
+            if (ld->get_file() == NULL)
                 continue;
 
-            (*iter)->ld_lines_indexed = (*iter)->get_file()->size();
+            ld->ld_lines_indexed = ld->get_file()->size();
         }
 
         this->lss_filtered_index.reserve(this->lss_index.size());
@@ -740,6 +823,7 @@ logfile_sub_source::rebuild_result logfile_sub_source::rebuild_index()
         case rebuild_result::rr_no_change:
             break;
         case rebuild_result::rr_full_rebuild:
+            this->invalidate_render_cache();
             this->tss_view->redo_search();
             break;
         case rebuild_result::rr_appended_lines:
@@ -853,6 +937,7 @@ void logfile_sub_source::text_filters_changed()
     }
 
     this->lss_filtered_index.clear();
+    this->lss_index_generation += 1;
     for (size_t index_index = 0; index_index < this->lss_index.size(); index_index++) {
         content_line_t cl = (content_line_t) this->lss_index[index_index];
         uint64_t line_number;
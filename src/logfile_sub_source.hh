@@ -275,6 +275,24 @@ public:
         return this->lss_marked_only;
     };
 
+    /**
+     * Drop the cached renderings of log messages.  This needs to be called
+     * when something that affects how a message is displayed changes, like
+     * the set of hidden fields.
+     */
+    void invalidate_render_cache() {
+        this->lss_render_generation += 1;
+    };
+
+    /**
+     * @return A counter that changes whenever the visible lines are
+     *   renumbered, like when the filters change.  If the counter is the same
+     *   as before, any new lines were appended to the end of the index.
+     */
+    uint64_t get_index_generation() const {
+        return this->lss_index_generation;
+    };
+
     size_t text_line_count()
     {
         return this->lss_filtered_index.size();
@@ -390,10 +408,12 @@ public:
             }
 
             this->lss_files.push_back(new logfile_data(this->lss_files.size(), this->get_filters(), lf));
+            existing = this->lss_files.end() - 1;
         }
         else {
             (*existing)->set_file(lf);
         }
+        this->mark_dirty(*existing);
         this->lss_force_rebuild = true;
 
         return true;
@@ -444,6 +464,40 @@ public:
 
     rebuild_result rebuild_index();
 
+    /**
+     * Mark a file as needing to be checked for new lines by the next call to
+     * rebuild_index().  Files that are not marked are assumed to be
+     * unchanged.
+     *
+     * @param lf The file that changed.
+     */
+    void mark_dirty(const std::shared_ptr<logfile> &lf)
+    {
+        auto iter = std::find_if(this->lss_files.begin(),
+                                 this->lss_files.end(),
+                                 logfile_data_eq(lf));
+
+        if (iter != this->lss_files.end()) {
+            this->mark_dirty(*iter);
+        }
+    };
+
+    void mark_all_dirty()
+    {
+        for (auto ld : this->lss_files) {
+            this->mark_dirty(ld);
+        }
+    };
+
+    /**
+     * @return True if some files still need to be checked for new lines,
+     * because they were growing or have not been fully indexed.
+     */
+    bool has_dirty_files() const
+    {
+        return !this->lss_dirty_files.empty();
+    };
+
     void text_update_marks(vis_bookmarks &bm);
 
     void set_user_mark(bookmark_type_t *bm, content_line_t cl)
@@ -577,7 +631,8 @@ public:
             : ld_file_index(index),
               ld_filter_state(fs, lf),
               ld_lines_indexed(0),
-              ld_enabled(true) {
+              ld_enabled(true),
+              ld_dirty(false) {
             lf->set_logline_observer(&this->ld_filter_state);
         };
 
@@ -603,6 +658,7 @@ public:
         line_filter_observer ld_filter_state;
         size_t ld_lines_indexed;
         bool ld_enabled;
+        bool ld_dirty;
     };
 
     typedef std::vector<logfile_data *>::iterator iterator;
@@ -753,6 +809,7 @@ public:
 
 private:
     static const size_t LINE_SIZE_CACHE_SIZE = 512;
+    static const size_t RENDER_CACHE_SIZE = 256;
 
     enum {
         B_SCRUB,
@@ -860,6 +917,14 @@ private:
         logfile_sub_source & llss_controller;
     };
 
+    void mark_dirty(logfile_data *ld)
+    {
+        if (!ld->ld_dirty) {
+            ld->ld_dirty = true;
+            this->lss_dirty_files.push_back(ld);
+        }
+    };
+
     /**
      * Functor for comparing the ld_file field of the logfile_data struct.
      */
@@ -874,6 +939,44 @@ private:
         std::shared_ptr<logfile> lde_file;
     };
 
+    /**
+     * The result of reading, annotating, and adjusting the timestamp of a
+     * log message.  The decorations that depend on the row (file name, time
+     * offset, bookmarks) are not included since they are cheap to redo and
+     * change with the filters.
+     */
+    struct render_cache_entry {
+        bool matches(content_line_t cl,
+                     uint64_t generation,
+                     uint64_t theme_generation,
+                     const file_range &fr,
+                     const struct timeval &tv) const {
+            return this->rce_valid &&
+                   this->rce_line == cl &&
+                   this->rce_generation == generation &&
+                   this->rce_theme_generation == theme_generation &&
+                   this->rce_range.fr_offset == fr.fr_offset &&
+                   this->rce_range.fr_size == fr.fr_size &&
+                   this->rce_time.tv_sec == tv.tv_sec &&
+                   this->rce_time.tv_usec == tv.tv_usec;
+        };
+
+        bool rce_valid{false};
+        content_line_t rce_line;
+        uint64_t rce_generation{0};
+        uint64_t rce_theme_generation{0};
+        file_range rce_range;
+        struct timeval rce_time{0, 0};
+        std::string rce_token_value;
+        std::string rce_value_out;
+        string_attrs_t rce_attrs;
+        string_attrs_t rce_value_attrs;
+        int rce_shift_start{0};
+        int rce_shift_size{0};
+    };
+
+    void render_line(int row, std::string &value_out);
+
     void clear_line_size_cache() {
         memset(this->lss_line_size_cache, 0, sizeof(this->lss_line_size_cache));
         this->lss_line_size_cache[0].first = -1;
@@ -895,6 +998,7 @@ private:
     unsigned long             lss_flags;
     bool lss_force_rebuild;
     std::vector<logfile_data *> lss_files;
+    std::vector<logfile_data *> lss_dirty_files;
 
     big_array<indexed_content> lss_index;
     std::vector<uint32_t> lss_filtered_index;
@@ -906,12 +1010,15 @@ private:
     std::shared_ptr<logfile> lss_token_file;
     std::string       lss_token_value;
     string_attrs_t    lss_token_attrs;
-    std::vector<logline_value> lss_token_values;
+    string_attrs_t    lss_token_value_attrs;
     int lss_token_shift_start;
     int lss_token_shift_size;
     shared_buffer     lss_share_manager;
     logfile::iterator lss_token_line;
     std::pair<int, size_t> lss_line_size_cache[LINE_SIZE_CACHE_SIZE];
+    render_cache_entry lss_render_cache[RENDER_CACHE_SIZE];
+    uint64_t lss_render_generation{0};
+    uint64_t lss_index_generation{0};
     log_level_t  lss_min_log_level;
     struct timeval    lss_min_log_time;
     struct timeval    lss_max_log_time;
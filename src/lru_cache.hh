@@ -0,0 +1,109 @@
+/**
+ * Copyright (c) 2019, Timothy Stack
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * * Neither the name of Timothy Stack nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __lru_cache_hh
+#define __lru_cache_hh
+
+#include <list>
+#include <unordered_map>
+#include <utility>
+
+/**
+ * A map with a maximum size that evicts the least recently used entry when
+ * it is full.
+ */
+template<typename K, typename V, typename Hash = std::hash<K>>
+class lru_cache {
+public:
+    explicit lru_cache(size_t max_size) : lc_max_size(max_size) {
+    };
+
+    /**
+     * @param key The key to look up.
+     * @return A pointer to the value for the key or nullptr if it is not in
+     *   the cache.  The entry becomes the most recently used.
+     */
+    V *get(const K &key) {
+        auto iter = this->lc_index.find(key);
+
+        if (iter == this->lc_index.end()) {
+            return nullptr;
+        }
+
+        this->lc_entries.splice(this->lc_entries.begin(),
+                                this->lc_entries,
+                                iter->second);
+        return &iter->second->second;
+    };
+
+    /**
+     * Add or replace the value for a key, evicting the least recently used
+     * entry if the cache is full.
+     */
+    V &put(const K &key, V value) {
+        auto iter = this->lc_index.find(key);
+
+        if (iter != this->lc_index.end()) {
+            iter->second->second = std::move(value);
+            this->lc_entries.splice(this->lc_entries.begin(),
+                                    this->lc_entries,
+                                    iter->second);
+            return iter->second->second;
+        }
+
+        if (this->lc_entries.size() >= this->lc_max_size &&
+            !this->lc_entries.empty()) {
+            this->lc_index.erase(this->lc_entries.back().first);
+            this->lc_entries.pop_back();
+        }
+
+        this->lc_entries.emplace_front(key, std::move(value));
+        this->lc_index[key] = this->lc_entries.begin();
+
+        return this->lc_entries.front().second;
+    };
+
+    void clear() {
+        this->lc_index.clear();
+        this->lc_entries.clear();
+    };
+
+    size_t size() const {
+        return this->lc_entries.size();
+    };
+
+private:
+    typedef std::list<std::pair<K, V>> entry_list_t;
+
+    size_t lc_max_size;
+    entry_list_t lc_entries;
+    std::unordered_map<K, typename entry_list_t::iterator, Hash> lc_index;
+};
+
+#endif
@@ -33,18 +33,9 @@
 
 #include <stdio.h>
 
-#include <assert.h>
-#include <errno.h>
-#include <string.h>
-#include <sys/types.h>
-#include <sys/socket.h>
-#include <netdb.h>
-#include <arpa/inet.h>
-#include <netinet/in.h>
-
 #include "sqlite3.h"
 
-#include "auto_mem.hh"
+#include "dns_resolver.hh"
 #include "vtab_module.hh"
 #include "sqlite-extension-func.hh"
 
@@ -52,76 +43,12 @@ using namespace std;
 
 static string sql_gethostbyname(const char *name_in)
 {
-    char             buffer[INET6_ADDRSTRLEN];
-    auto_mem<struct addrinfo> ai(freeaddrinfo);
-    void *           addr_ptr = NULL;
-    int rc;
-
-    while ((rc = getaddrinfo(name_in, NULL, NULL, ai.out())) == EAI_AGAIN) {
-        sqlite3_sleep(10);
-    }
-    if (rc != 0) {
-        return name_in;
-    }
-
-    switch (ai.in()->ai_family) {
-    case AF_INET:
-        addr_ptr = &((struct sockaddr_in *)ai.in()->ai_addr)->sin_addr;
-        break;
-
-    case AF_INET6:
-        addr_ptr = &((struct sockaddr_in6 *)ai.in()->ai_addr)->sin6_addr;
-        break;
-
-    default:
-        return name_in;
-    }
-
-    inet_ntop(ai.in()->ai_family, addr_ptr, buffer, sizeof(buffer));
-
-    return buffer;
+    return dns_cache::singleton().name_to_addr(name_in);
 }
 
 static string sql_gethostbyaddr(const char *addr_str)
 {
-    union {
-        struct sockaddr_in  sin;
-        struct sockaddr_in6 sin6;
-    }           sa;
-    char        buffer[NI_MAXHOST];
-    int         family, socklen;
-    char *      addr_raw;
-    int         rc;
-
-    memset(&sa, 0, sizeof(sa));
-    if (strchr(addr_str, ':')) {
-        family              = AF_INET6;
-        socklen             = sizeof(struct sockaddr_in6);
-        sa.sin6.sin6_family = family;
-        addr_raw            = (char *)&sa.sin6.sin6_addr;
-    }
-    else {
-        family            = AF_INET;
-        socklen           = sizeof(struct sockaddr_in);
-        sa.sin.sin_family = family;
-        addr_raw          = (char *)&sa.sin.sin_addr;
-    }
-
-    if (inet_pton(family, addr_str, addr_raw) != 1) {
-        return addr_str;
-    }
-
-    while ((rc = getnameinfo((struct sockaddr *)&sa, socklen,
-                             buffer, sizeof(buffer), NULL, 0,
-                             0)) == EAI_AGAIN) {
-        sqlite3_sleep(10);
-    }
-
-    if (rc != 0) {
-        return addr_str;
-    }
-
-    return buffer;
+    return dns_cache::singleton().addr_to_name(addr_str);
 }
 
 int network_extension_functions(struct FuncDef **basic_funcs,
@@ -37,7 +37,6 @@
 #include <paths.h>
 #include <fcntl.h>
 #include <sys/types.h>
-#include <sys/wait.h>
 #include <sys/param.h>
 #include <sys/time.h>
 #include <signal.h>
@@ -45,30 +44,122 @@
 #include <stdlib.h>
 #include <poll.h>
 
+#include <algorithm>
+#include <memory>
+
 #include "base/lnav_log.hh"
+#include "lnav_util.hh"
 #include "piper_proc.hh"
 #include "line_buffer.hh"
+#include "spool_file.hh"
 
 using namespace std;
 
 static const char *STDIN_EOF_MSG = "---- END-OF-STDIN ----";
 
-static ssize_t write_timestamp(int fd, off_t woff)
-{
-    char           time_str[64];
-    struct timeval tv;
-    char           ms_str[8];
-
-    gettimeofday(&tv, NULL);
-    strftime(time_str, sizeof(time_str), "%FT%T", localtime(&tv.tv_sec));
-    snprintf(ms_str, sizeof(ms_str), ".%03d", (int)(tv.tv_usec / 1000));
-    strcat(time_str, ms_str);
-    strcat(time_str, "  ");
-    return pwrite(fd, time_str, strlen(time_str), woff);
+/**
+ * The maximum amount of time, in milliseconds, that data read from the pipe
+ * can sit in a partially filled spool block before it is written out.
+ */
+static const mstime_t SPOOL_FLUSH_DELAY = 250;
+
+namespace {
+
+/**
+ * The destination for the data read from the pipe.  Data is either written
+ * as-is to a user-specified file or compressed into a spool file.
+ */
+class piper_output {
+public:
+    piper_output(int fd, spool_file_writer *writer)
+        : po_fd(fd), po_offset(0), po_writer(writer), po_pending_since(0)
+    {
+    };
+
+    bool write(const char *data, size_t len) {
+        if (this->po_writer) {
+            if (!this->po_writer->has_pending()) {
+                this->po_pending_since = getmstime();
+            }
+            return this->po_writer->append(data, len);
+        }
+
+        /* Need to do pwrite here since the fd is used by the main
+         * lnav process as well.
+         */
+        ssize_t wrc = pwrite(this->po_fd, data, len, this->po_offset);
+
+        if (wrc == -1) {
+            return false;
+        }
+        this->po_offset += wrc;
+
+        return true;
+    };
+
+    bool write_timestamp() {
+        char           time_str[64];
+        struct timeval tv;
+        char           ms_str[8];
+
+        gettimeofday(&tv, NULL);
+        strftime(time_str, sizeof(time_str), "%FT%T", localtime(&tv.tv_sec));
+        snprintf(ms_str, sizeof(ms_str), ".%03d", (int)(tv.tv_usec / 1000));
+        strcat(time_str, ms_str);
+        strcat(time_str, "  ");
+        return this->write(time_str, strlen(time_str));
+    };
+
+    off_t tell() const {
+        return this->po_offset;
+    };
+
+    /**
+     * Move back to an earlier position so a truncated line is overwritten
+     * by the next write.  Spooled data cannot be rewritten, so it is kept.
+     */
+    void rewind(off_t off) {
+        if (!this->po_writer) {
+            this->po_offset = off;
+        }
+    };
+
+    /**
+     * @return The number of milliseconds to wait for more data before the
+     *   pending spool data should be flushed, or -1 if there is nothing
+     *   pending.
+     */
+    int flush_timeout() const {
+        if (!this->po_writer || !this->po_writer->has_pending()) {
+            return -1;
+        }
+
+        mstime_t age = getmstime() - this->po_pending_since;
+
+        return std::max((mstime_t) 0, SPOOL_FLUSH_DELAY - age);
+    };
+
+    bool flush() {
+        if (this->po_writer) {
+            return this->po_writer->flush();
+        }
+        return true;
+    };
+
+private:
+    int po_fd;
+    off_t po_offset;
+    spool_file_writer *po_writer;
+    mstime_t po_pending_since;
+};
+
 }
 
 piper_proc::piper_proc(int pipefd, bool timestamp, const char *filename)
-    : pp_fd(-1), pp_child(-1)
+    : pp_fd(-1),
+      pp_timestamp(timestamp),
+      pp_started(false),
+      pp_exited(false)
 {
     require(pipefd >= 0);
 
@@ -98,153 +189,147 @@ piper_proc::piper_proc(int pipefd, bool timestamp, const char *filename)
 
     log_perror(fcntl(this->pp_fd.get(), F_SETFD, FD_CLOEXEC));
 
-    this->pp_child = fork();
-    switch (this->pp_child) {
-    case -1:
+    if ((this->pp_in_fd = dup(pipefd)) == -1 ||
+        (this->pp_out_fd = dup(this->pp_fd)) == -1 ||
+        this->pp_stop_pipe.open() == -1) {
         throw error(errno);
+    }
+    log_perror(fcntl(this->pp_in_fd.get(), F_SETFD, FD_CLOEXEC));
+    log_perror(fcntl(this->pp_out_fd.get(), F_SETFD, FD_CLOEXEC));
+    log_perror(fcntl(this->pp_stop_pipe.read_end().get(), F_SETFD, FD_CLOEXEC));
+    log_perror(fcntl(this->pp_stop_pipe.write_end().get(), F_SETFD, FD_CLOEXEC));
 
-    case 0:
-    {
-        auto_fd     infd(pipefd);
-        line_buffer lb;
-        off_t       woff = 0, last_woff = 0;
-        file_range last_range;
-        int nullfd;
-
-        nullfd = open("/dev/null", O_RDWR);
-        if (pipefd != STDIN_FILENO) {
-            dup2(nullfd, STDIN_FILENO);
-        }
-        dup2(nullfd, STDOUT_FILENO);
-        for (int fd_to_close = 0; fd_to_close < 1024; fd_to_close++) {
-            int flags;
+    if (filename == NULL) {
+        this->pp_writer = make_unique<spool_file_writer>(this->pp_out_fd);
+    }
 
-            if (fd_to_close == this->pp_fd.get()) {
-                continue;
+    /*
+     * Signals should be handled by the main thread so that they interrupt
+     * its poll(), so block them all in the reader thread.
+     */
+    sigset_t all_signals, old_signals;
+    int rc;
+
+    sigfillset(&all_signals);
+    pthread_sigmask(SIG_BLOCK, &all_signals, &old_signals);
+    rc = pthread_create(&this->pp_thread, NULL, trampoline, this);
+    pthread_sigmask(SIG_SETMASK, &old_signals, NULL);
+    if (rc != 0) {
+        throw error(rc);
+    }
+    this->pp_started = true;
+}
+
+void *piper_proc::trampoline(void *arg)
+{
+    piper_proc *pp = (piper_proc *) arg;
+
+    return pp->run();
+}
+
+void *piper_proc::run()
+{
+    piper_output out(this->pp_out_fd, this->pp_writer.get());
+    line_buffer lb;
+    file_range last_range;
+    bool stopped = false;
+
+    log_perror(fcntl(this->pp_in_fd.get(), F_SETFL, O_NONBLOCK));
+    lb.set_fd(this->pp_in_fd);
+    do {
+        struct pollfd pfds[] = {
+            { lb.get_fd(), POLLIN, 0 },
+            { this->pp_stop_pipe.read_end(), POLLIN, 0 },
+        };
+        int rc = poll(pfds, 2, out.flush_timeout());
+
+        if (rc == 0 || out.flush_timeout() == 0) {
+            /* Nothing new has arrived for a while, let the reader see it. */
+            if (!out.flush()) {
+                perror("Unable to write to output file for stdin");
+                break;
             }
-            if ((flags = fcntl(fd_to_close, F_GETFD)) == -1) {
+            if (rc == 0) {
                 continue;
             }
-            if (flags & FD_CLOEXEC) {
-                close(fd_to_close);
-            }
         }
-        log_perror(fcntl(infd.get(), F_SETFL, O_NONBLOCK));
-        lb.set_fd(infd);
-        do {
-            struct pollfd pfd = {
-                    lb.get_fd(),
-                    POLLIN,
-                    0
-            };
-
-            poll(&pfd, 1, -1);
-            while (true) {
-                auto load_result = lb.load_next_line(last_range);
-
-                if (load_result.isErr()) {
-                    break;
-                }
-
-                auto li = load_result.unwrap();
-
-                if (li.li_partial && !lb.is_pipe_closed()) {
-                    break;
-                }
-
-                if (li.li_file_range.empty()) {
-                    break;
-                }
-
-                auto read_result = lb.read_range(li.li_file_range);
-
-                if (read_result.isErr()) {
-                    break;
-                }
-
-                auto sbr = read_result.unwrap();
-
-                ssize_t wrc;
-
-                last_woff = woff;
-                if (timestamp) {
-                    wrc = write_timestamp(this->pp_fd, woff);
-                    if (wrc == -1) {
-                        perror("Unable to write to output file for stdin");
-                        break;
-                    }
-                    woff += wrc;
-                }
-
-                /* Need to do pwrite here since the fd is used by the main
-                 * lnav process as well.
-                 */
-                wrc = pwrite(this->pp_fd, sbr.get_data(), sbr.length(), woff);
-                if (wrc == -1) {
-                    perror("Unable to write to output file for stdin");
-                    break;
-                }
-                woff += wrc;
-
-                last_range = li.li_file_range;
-                if (sbr.get_data()[sbr.length() - 1] != '\n' &&
-                        (last_range.next_offset() != lb.get_file_size())) {
-                    woff = last_woff;
-                }
+        if (pfds[1].revents) {
+            stopped = true;
+            break;
+        }
+        while (true) {
+            auto load_result = lb.load_next_line(last_range);
+
+            if (load_result.isErr()) {
+                break;
+            }
+
+            auto li = load_result.unwrap();
+
+            if (li.li_partial && !lb.is_pipe_closed()) {
+                break;
+            }
+
+            if (li.li_file_range.empty()) {
+                break;
+            }
+
+            auto read_result = lb.read_range(li.li_file_range);
+
+            if (read_result.isErr()) {
+                break;
             }
-        } while (lb.is_pipe() && !lb.is_pipe_closed());
 
-        if (timestamp) {
-            ssize_t wrc;
+            auto sbr = read_result.unwrap();
+            off_t last_woff = out.tell();
 
-            wrc = write_timestamp(this->pp_fd, woff);
-            if (wrc == -1) {
+            if (this->pp_timestamp && !out.write_timestamp()) {
                 perror("Unable to write to output file for stdin");
                 break;
             }
-            woff += wrc;
-            wrc   = pwrite(this->pp_fd,
-                           STDIN_EOF_MSG, strlen(STDIN_EOF_MSG),
-                           woff);
-            if (wrc == -1) {
+
+            if (!out.write(sbr.get_data(), sbr.length())) {
                 perror("Unable to write to output file for stdin");
                 break;
             }
+
+            last_range = li.li_file_range;
+            if (sbr.get_data()[sbr.length() - 1] != '\n' &&
+                    (last_range.next_offset() != lb.get_file_size())) {
+                out.rewind(last_woff);
+            }
         }
-    }
-        _exit(0);
-        break;
+    } while (lb.is_pipe() && !lb.is_pipe_closed());
 
-    default:
-        break;
+    if (!stopped && this->pp_timestamp) {
+        if (!out.write_timestamp() ||
+            !out.write(STDIN_EOF_MSG, strlen(STDIN_EOF_MSG))) {
+            perror("Unable to write to output file for stdin");
+        }
+    }
+    if (!out.flush()) {
+        perror("Unable to write to output file for stdin");
     }
+
+    this->pp_exited = true;
+
+    return NULL;
 }
 
 bool piper_proc::has_exited()
 {
-    if (this->pp_child > 0) {
-        int rc, status;
-
-        rc = waitpid(this->pp_child, &status, WNOHANG);
-        if (rc == -1 || rc == 0) {
-            return false;
-        }
-        this->pp_child = -1;
-    }
-
-    return true;
+    return this->pp_exited;
 }
 
 piper_proc::~piper_proc()
 {
-    if (this->pp_child > 0) {
-        int status;
+    if (this->pp_started) {
+        void *result;
 
-        kill(this->pp_child, SIGTERM);
-        while (waitpid(this->pp_child, &status, 0) < 0 && (errno == EINTR)) {
-            ;
+        if (write(this->pp_stop_pipe.write_end(), "", 1) == -1) {
+            log_error("unable to stop piper thread -- %s", strerror(errno));
         }
-
-        this->pp_child = -1;
+        pthread_join(this->pp_thread, &result);
+        this->pp_started = false;
     }
 }
@@ -32,15 +32,22 @@
 #ifndef __piper_proc_hh
 #define __piper_proc_hh
 
-#include <string>
+#include <pthread.h>
 #include <sys/types.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+
 #include "auto_fd.hh"
 
+class spool_file_writer;
+
 /**
- * Creates a subprocess that reads data from a pipe and writes it to a file so
- * lnav can treat it like any other file and do preads.
- *
- * TODO: Add support for gzipped files.
+ * Starts a thread that reads data from a pipe and writes it to a file so
+ * lnav can treat it like any other file and do preads.  If the data is going
+ * to a temporary file, it is written in the compressed spool_file format to
+ * keep the file small.
  */
 class piper_proc {
 public:
@@ -54,10 +61,11 @@ public:
     };
 
     /**
-     * Forks a subprocess that will read data from the given file descriptor
+     * Starts a thread that will read data from the given file descriptor
      * and write it to a temporary file.
      *
-     * @param pipefd The file descriptor to read the file contents from.
+     * @param pipefd The file descriptor to read the file contents from.  The
+     *   descriptor is dup(2)'d, so the caller is free to close it.
      * @param timestamp True if an ISO 8601 timestamp should be prepended onto
      *   the lines read from pipefd.
      * @param filename The name of the file to save the input to, otherwise a
@@ -68,20 +76,42 @@ public:
     bool has_exited();
 
     /**
-     * Terminates the child process.
+     * Stops the reader thread.
      */
     virtual ~piper_proc();
 
     /** @return The file descriptor for the temporary file. */
     int get_fd() { return this->pp_fd.release(); };
 
-    pid_t get_child_pid() const { return this->pp_child; };
-
 private:
+    static void *trampoline(void *arg);
+
+    void *run();
+
     /** A file descriptor that refers to the temporary file. */
     auto_fd pp_fd;
 
-    /** The child process' pid. */
-    pid_t pp_child;
+    /** The reader thread's copy of the output file descriptor. */
+    auto_fd pp_out_fd;
+
+    /** The file descriptor to read data from. */
+    auto_fd pp_in_fd;
+
+    /** Written to by the destructor to get the reader thread to exit. */
+    auto_pipe pp_stop_pipe;
+
+    bool pp_timestamp;
+
+    /**
+     * The writer for the temporary file, it is created up front so the file
+     * header is in place before the file is handed to a line_buffer.
+     */
+    std::unique_ptr<spool_file_writer> pp_writer;
+
+    bool pp_started;
+    pthread_t pp_thread;
+
+    /** Set by the reader thread when it has finished. */
+    std::atomic<bool> pp_exited;
 };
 #endif
@@ -507,7 +507,9 @@ void readline_curses::start()
 
         signal(SIGALRM, sigalrm);
         signal(SIGWINCH, sigwinch);
-        signal(SIGINT, sigterm);
+        // A Ctrl-C is sent to the whole foreground process group, but it is
+        // meant for the parent, which uses it to cancel a query.
+        signal(SIGINT, SIG_IGN);
         signal(SIGTERM, sigterm);
 
         dup2(this->rc_pty[RCF_SLAVE], STDIN_FILENO);
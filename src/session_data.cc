@@ -1449,4 +1449,5 @@ void reset_session()
             vd.second->vd_user_hidden = false;
         }
     }
+    lnav_data.ld_log_source.invalidate_render_cache();
 }
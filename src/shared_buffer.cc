@@ -61,6 +61,19 @@ void shared_buffer_ref::share(shared_buffer &sb, char *data, size_t len)
     ensure(this->sb_length < (5 * 1024 * 1024));
 }
 
+void shared_buffer_ref::share(const shared_segment &segment,
+                              char *data,
+                              size_t len)
+{
+    this->disown();
+
+    this->sb_segment = segment;
+    this->sb_data = data;
+    this->sb_length = len;
+
+    ensure(this->sb_length < (5 * 1024 * 1024));
+}
+
 bool shared_buffer_ref::subset(shared_buffer_ref &other, off_t offset, size_t len)
 {
     this->disown();
@@ -68,7 +81,10 @@ bool shared_buffer_ref::subset(shared_buffer_ref &other, off_t offset, size_t le
     if (offset != -1) {
         this->sb_owner = other.sb_owner;
         this->sb_length = len;
-        if (this->sb_owner == NULL) {
+        if (other.sb_segment) {
+            this->sb_segment = other.sb_segment;
+            this->sb_data = &other.sb_data[offset];
+        } else if (this->sb_owner == NULL) {
             if ((this->sb_data = (char *)malloc(this->sb_length)) == NULL) {
                 return false;
             }
@@ -88,6 +104,13 @@ shared_buffer_ref::shared_buffer_ref(shared_buffer_ref &&other)
         this->sb_owner = nullptr;
         this->sb_data = nullptr;
         this->sb_length = 0;
+    } else if (other.sb_segment) {
+        this->sb_owner = nullptr;
+        this->sb_segment = std::move(other.sb_segment);
+        this->sb_data = other.sb_data;
+        this->sb_length = other.sb_length;
+        other.sb_data = nullptr;
+        other.sb_length = 0;
     } else if (other.sb_owner != nullptr) {
         other.sb_owner->add_ref(*this);
         this->sb_owner = other.sb_owner;
@@ -37,6 +37,7 @@
 #include <sys/types.h>
 #include <sys/queue.h>
 
+#include <memory>
 #include <string>
 
 #include "auto_mem.hh"
@@ -44,6 +45,31 @@
 
 class shared_buffer;
 
+/**
+ * A reference-counted block of memory.  The data in a segment that has been
+ * shared is never changed, so a reference to it stays valid for as long as
+ * the reference is alive.  An owner that needs to change shared data starts
+ * a new segment instead.
+ */
+typedef std::shared_ptr<char> shared_segment;
+
+inline shared_segment make_shared_segment(size_t size)
+{
+    char *data = (char *) malloc(size);
+
+    if (data == nullptr) {
+        return nullptr;
+    }
+
+    return shared_segment(data, free);
+}
+
+/**
+ * A reference to some data that is either: owned by the reference, kept
+ * alive by a shared_segment, or borrowed from a shared_buffer.  Borrowed
+ * data is copied into the reference when the shared_buffer invalidates its
+ * references.
+ */
 struct shared_buffer_ref {
 public:
     shared_buffer_ref(char *data = nullptr, size_t len = 0)
@@ -108,10 +134,13 @@ public:
 
     void share(shared_buffer &sb, char *data, size_t len);
 
+    void share(const shared_segment &segment, char *data, size_t len);
+
     bool subset(shared_buffer_ref &other, off_t offset, size_t len);
 
     bool take_ownership() {
-        if (this->sb_owner != nullptr && this->sb_data != nullptr) {
+        if ((this->sb_owner != nullptr || this->sb_segment) &&
+            this->sb_data != nullptr) {
             char *new_data;
         
             if ((new_data = (char *)malloc(this->sb_length)) == nullptr) {
@@ -120,14 +149,19 @@ public:
 
             memcpy(new_data, this->sb_data, this->sb_length);
             this->sb_data = new_data;
-            LIST_REMOVE(this, sb_link);
-            this->sb_owner = nullptr;
+            if (this->sb_owner != nullptr) {
+                LIST_REMOVE(this, sb_link);
+                this->sb_owner = nullptr;
+            }
+            this->sb_segment.reset();
         }
         return true;
     };
 
     void disown() {
-        if (this->sb_owner == nullptr) {
+        if (this->sb_segment) {
+            this->sb_segment.reset();
+        } else if (this->sb_owner == nullptr) {
             if (this->sb_data != nullptr) {
                 free(this->sb_data);
             }
@@ -147,6 +181,11 @@ private:
             this->sb_data = nullptr;
             this->sb_length = 0;
         }
+        else if (other.sb_segment) {
+            this->sb_segment = other.sb_segment;
+            this->sb_data = other.sb_data;
+            this->sb_length = other.sb_length;
+        }
         else if (other.sb_owner != nullptr) {
             this->share(*other.sb_owner, other.sb_data, other.sb_length);
         } else {
@@ -158,6 +197,7 @@ private:
     }
 
     auto_mem<char *> sb_backtrace;
+    shared_segment sb_segment;
     shared_buffer *sb_owner;
     char *sb_data;
     size_t sb_length;
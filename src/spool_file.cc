@@ -0,0 +1,126 @@
+/**
+ * Copyright (c) 2019, Timothy Stack
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * * Neither the name of Timothy Stack nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include <algorithm>
+
+#include "base/lnav_log.hh"
+#include "spool_file.hh"
+
+const char spool_file::FILE_MAGIC[8] = {
+    'L', 'N', 'A', 'V', 'S', 'P', 'L', '1'
+};
+
+bool spool_file::is_spool(const char *data, size_t len)
+{
+    return len >= sizeof(FILE_MAGIC) &&
+           memcmp(data, FILE_MAGIC, sizeof(FILE_MAGIC)) == 0;
+}
+
+spool_file_writer::spool_file_writer(int fd)
+    : sfw_fd(fd), sfw_offset(0)
+{
+    ssize_t rc = pwrite(this->sfw_fd,
+                        spool_file::FILE_MAGIC,
+                        sizeof(spool_file::FILE_MAGIC),
+                        this->sfw_offset);
+
+    if (rc == sizeof(spool_file::FILE_MAGIC)) {
+        this->sfw_offset += rc;
+    }
+    else {
+        log_error("unable to write spool file header -- %s", strerror(errno));
+    }
+    this->sfw_pending.reserve(spool_file::BLOCK_SIZE);
+}
+
+bool spool_file_writer::append(const char *data, size_t len)
+{
+    while (len > 0) {
+        size_t amount = std::min(
+            len, spool_file::BLOCK_SIZE - this->sfw_pending.size());
+
+        this->sfw_pending.append(data, amount);
+        data += amount;
+        len -= amount;
+        if (this->sfw_pending.size() == spool_file::BLOCK_SIZE &&
+            !this->flush()) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool spool_file_writer::flush()
+{
+    if (this->sfw_pending.empty()) {
+        return true;
+    }
+
+    spool_file::block_header hdr;
+    uLongf compressed_size = compressBound(this->sfw_pending.size());
+
+    // The header and the data are written together so that a reader never
+    // sees a header without the data that goes with it.
+    this->sfw_compressed.resize(sizeof(hdr) + compressed_size);
+    if (compress2((Bytef *) &this->sfw_compressed[sizeof(hdr)],
+                  &compressed_size,
+                  (const Bytef *) this->sfw_pending.data(),
+                  this->sfw_pending.size(),
+                  Z_BEST_SPEED) != Z_OK) {
+        log_error("unable to compress spool block");
+        return false;
+    }
+
+    hdr.bh_size = this->sfw_pending.size();
+    hdr.bh_compressed_size = compressed_size;
+    memcpy(&this->sfw_compressed[0], &hdr, sizeof(hdr));
+
+    size_t total = sizeof(hdr) + compressed_size;
+    ssize_t rc = pwrite(this->sfw_fd,
+                        this->sfw_compressed.data(),
+                        total,
+                        this->sfw_offset);
+
+    if (rc != (ssize_t) total) {
+        log_error("unable to write spool block -- %s", strerror(errno));
+        return false;
+    }
+
+    this->sfw_offset += total;
+    this->sfw_pending.clear();
+
+    return true;
+}
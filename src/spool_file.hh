@@ -0,0 +1,102 @@
+/**
+ * Copyright (c) 2019, Timothy Stack
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * * Neither the name of Timothy Stack nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __spool_file_hh
+#define __spool_file_hh
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <string>
+
+/**
+ * The format of the files that data read from pipes is spooled to.  The file
+ * starts with a FILE_MAGIC header and is followed by blocks of data that have
+ * been compressed with zlib.  Each block is preceded by a block_header and
+ * can be decompressed on its own, so a reader can seek to any offset in the
+ * uncompressed data by finding the block that contains it.  Blocks are only
+ * ever appended to the file.
+ */
+struct spool_file {
+    static const char FILE_MAGIC[8];
+
+    /** The maximum amount of uncompressed data in a single block. */
+    static const size_t BLOCK_SIZE = 64 * 1024;
+
+    struct block_header {
+        uint32_t bh_size;            /*< The size of the uncompressed data. */
+        uint32_t bh_compressed_size; /*< The size of the data in the file. */
+    };
+
+    /**
+     * @param data The start of the file.
+     * @param len The amount of data.
+     * @return True if the data is the start of a spool file.
+     */
+    static bool is_spool(const char *data, size_t len);
+};
+
+/**
+ * Writes data into a spool file in blocks.  Data is buffered until a block
+ * is full or flush() is called.
+ */
+class spool_file_writer {
+public:
+    /**
+     * @param fd The file to write to, the file header is written right away
+     *   so readers can recognize the file before any data arrives.
+     */
+    explicit spool_file_writer(int fd);
+
+    /**
+     * Append data to the current block, writing out the block if it fills.
+     *
+     * @return False if there was an error writing to the file.
+     */
+    bool append(const char *data, size_t len);
+
+    /**
+     * Write out any buffered data as a block.
+     *
+     * @return False if there was an error writing to the file.
+     */
+    bool flush();
+
+    bool has_pending() const {
+        return !this->sfw_pending.empty();
+    };
+
+private:
+    int sfw_fd;
+    off_t sfw_offset;
+    std::string sfw_pending;
+    std::string sfw_compressed;
+};
+
+#endif
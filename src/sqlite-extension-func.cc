@@ -49,6 +49,7 @@ sqlite_registration_func_t sqlite_registration_funcs[] = {
     fs_extension_functions,
     json_extension_functions,
     time_extension_functions,
+    collation_extension_functions,
 
     NULL
 };
@@ -64,6 +64,9 @@ typedef int (*sqlite_registration_func_t)(struct FuncDef **basic_funcs,
 int common_extension_functions(struct FuncDef **basic_funcs,
                                struct FuncDefAgg **agg_funcs);
 
+int collation_extension_functions(struct FuncDef **basic_funcs,
+                                  struct FuncDefAgg **agg_funcs);
+
 int state_extension_functions(struct FuncDef **basic_funcs,
                               struct FuncDefAgg **agg_funcs);
 
@@ -13,8 +13,8 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sqlite3.h>
-#include <pcrecpp.h>
 
+#include <memory>
 #include <unordered_map>
 
 #include "pcrepp/pcrepp.hh"
@@ -27,6 +27,7 @@
 #include "data_parser.hh"
 #include "elem_to_json.hh"
 #include "vtab_module.hh"
+#include "lru_cache.hh"
 
 #include "optional.hpp"
 #include "mapbox/variant.hpp"
@@ -34,52 +35,197 @@
 using namespace std;
 using namespace mapbox;
 
-typedef struct {
-    shared_ptr<pcrecpp::RE> re;
-    shared_ptr<pcrepp> re2;
-} cache_entry;
+/**
+ * The number of compiled patterns kept around for patterns that are not
+ * constant within a statement.
+ */
+static const size_t REGEX_CACHE_SIZE = 128;
 
-static cache_entry *find_re(const char *re)
-{
-    static unordered_map<string, cache_entry> CACHE;
+/**
+ * The maximum number of captures that can be referenced in the replacement
+ * string passed to regexp_replace().
+ */
+static const int REPLACE_CAPTURE_MAX = 30;
+
+/**
+ * A regular expression used by the SQL functions.  The pattern is compiled in
+ * UTF-8 mode and, only if a subject turns out not to be valid UTF-8, a second
+ * time in byte mode.
+ */
+class sql_regex {
+public:
+    explicit sql_regex(const char *pattern)
+        : sr_pattern(pattern), sr_re(compile(this->sr_pattern, PCRE_UTF8)) {
+    };
+
+    /**
+     * Matches the pattern against a single subject.  The first match checks
+     * that the subject is valid UTF-8 and picks the pattern to use, later
+     * matches pass PCRE_NO_UTF8_CHECK so PCRE does not check the whole
+     * subject again each time.  Any start offsets passed to exec() must be
+     * at the start of a character.
+     */
+    class matcher {
+    public:
+        matcher(sql_regex &re, const char *str, int len)
+            : m_regex(re), m_str(str), m_len(len) {
+        };
+
+        /**
+         * Execute the pattern against the subject, the arguments and return
+         * value are the same as pcre_exec().
+         */
+        int exec(int start, int options, int *ovector, int ovecsize) {
+            if (this->m_re != nullptr) {
+                return this->run(*this->m_re,
+                                 start, options | this->m_options,
+                                 ovector, ovecsize);
+            }
 
-    string re_str = re;
-    auto iter = CACHE.find(re_str);
+            int rc = this->run(*this->m_regex.sr_re,
+                               start, options,
+                               ovector, ovecsize);
 
-    if (iter == CACHE.end()) {
-        cache_entry c;
+            if (rc == PCRE_ERROR_BADUTF8 || rc == PCRE_ERROR_BADUTF8_OFFSET) {
+                if (!this->m_regex.sr_bytes_re) {
+                    this->m_regex.sr_bytes_re =
+                        compile(this->m_regex.sr_pattern, 0);
+                }
+                this->m_re = this->m_regex.sr_bytes_re.get();
+                this->m_options = 0;
+
+                return this->run(*this->m_re,
+                                 start, options,
+                                 ovector, ovecsize);
+            }
 
-        c.re2 = make_shared<pcrepp>(re_str);
-        c.re = make_shared<pcrecpp::RE>(re);
-        if (!c.re->error().empty()) {
-            auto_mem<char> e2(sqlite3_free);
+            this->m_re = this->m_regex.sr_re.get();
+            this->m_options = PCRE_NO_UTF8_CHECK;
+
+            return rc;
+        };
+
+    private:
+        int run(pcrepp &re, int start, int options,
+                int *ovector, int ovecsize) const {
+            return pcre_exec(re.p_code, re.p_code_extra.in(),
+                             this->m_str, this->m_len, start, options,
+                             ovector, ovecsize);
+        };
+
+        sql_regex &m_regex;
+        const char *m_str;
+        int m_len;
+        pcrepp *m_re{nullptr};
+        int m_options{0};
+    };
 
-            e2 = sqlite3_mprintf("%s: %s", re, c.re->error().c_str());
-            throw pcrepp::error(e2.in(), 0);
+    /**
+     * Compile a pattern with the given PCRE options.  The options are always
+     * given explicitly since the pcrepp constructors do not agree on whether
+     * UTF-8 mode is the default.
+     */
+    static std::unique_ptr<pcrepp> compile(const std::string &pattern,
+                                           int options) {
+        try {
+            return std::unique_ptr<pcrepp>(
+                new pcrepp(pattern.c_str(), options));
+        } catch (const pcrepp::error &e) {
+            throw pcrepp::error(pattern + ": " + e.e_msg, e.e_offset);
         }
-        CACHE[re_str] = c;
+    };
 
-        iter = CACHE.find(re_str);
-    }
+    const std::string sr_pattern;
+    std::unique_ptr<pcrepp> sr_re;
+    std::unique_ptr<pcrepp> sr_bytes_re;
+};
 
-    return &iter->second;
-}
+/**
+ * Converts a pattern argument into a compiled regex.  Constant patterns are
+ * attached to the statement as auxiliary data so they are only compiled and
+ * looked up once, other patterns go through a bounded LRU cache.
+ *
+ * SQLite does not say whether an argument is constant, it just throws the
+ * auxiliary data away after each call when it is not.  Attaching the data
+ * allocates, so it is no longer attached for a call site once it has been
+ * thrown away AUX_DROP_LIMIT times in a row.
+ */
+template<>
+struct from_sqlite_with_context<shared_ptr<sql_regex>> {
+    static const int AUX_DROP_LIMIT = 2;
+    static const size_t AUX_SITE_MAX = 64;
+
+    static void free_aux(void *ptr) {
+        delete (shared_ptr<sql_regex> *) ptr;
+    };
+
+    shared_ptr<sql_regex> operator()(sqlite3_context *ctx,
+                                     int argc, sqlite3_value **val, int argi) {
+        static unordered_map<sqlite3_context *, int> AUX_DROPS;
+
+        auto aux = (shared_ptr<sql_regex> *) sqlite3_get_auxdata(ctx, argi);
+
+        if (aux != nullptr) {
+            // A constant pattern, forget about any drops from an earlier
+            // run of the statement.
+            if (!AUX_DROPS.empty()) {
+                AUX_DROPS.erase(ctx);
+            }
+            return *aux;
+        }
+
+        static lru_cache<string, shared_ptr<sql_regex>> CACHE(
+            REGEX_CACHE_SIZE);
+
+        string pattern = from_sqlite<const char *>()(argc, val, argi);
+        shared_ptr<sql_regex> *cached = CACHE.get(pattern);
+        shared_ptr<sql_regex> retval;
+
+        if (cached != nullptr) {
+            retval = *cached;
+        } else {
+            retval = make_shared<sql_regex>(pattern.c_str());
+            CACHE.put(pattern, retval);
+        }
+
+        if (AUX_DROPS.size() >= AUX_SITE_MAX && AUX_DROPS.count(ctx) == 0) {
+            // The contexts belong to statements that come and go, so just
+            // start over instead of keeping track of them.
+            AUX_DROPS.clear();
+        }
+
+        auto inserted = AUX_DROPS.emplace(ctx, 0);
+        int &drops = inserted.first->second;
 
-static bool regexp(const char *re, const char *str)
+        if (!inserted.second && drops < AUX_DROP_LIMIT) {
+            // The data attached by the last call was thrown away.
+            drops += 1;
+        }
+
+        if (drops < AUX_DROP_LIMIT) {
+            sqlite3_set_auxdata(ctx, argi,
+                                new shared_ptr<sql_regex>(retval),
+                                free_aux);
+        }
+
+        return retval;
+    };
+};
+
+static bool regexp(shared_ptr<sql_regex> re, const char *str)
 {
-    cache_entry *reobj = find_re(re);
+    sql_regex::matcher m(*re, str, strlen(str));
 
-    return reobj->re->PartialMatch(str);
+    return m.exec(0, 0, nullptr, 0) >= 0;
 }
 
 static
 util::variant<int64_t, double, const char*, string_fragment, json_string>
-regexp_match(const char *re, const char *str)
+regexp_match(shared_ptr<sql_regex> re, const char *str)
 {
-    cache_entry *reobj = find_re(re);
     pcre_context_static<30> pc;
     pcre_input pi(str);
-    pcrepp &extractor = *reobj->re2;
+    pcrepp &extractor = *re->sr_re;
 
     if (extractor.get_capture_count() == 0) {
         throw pcrepp::error("regular expression does not have any captures");
@@ -184,13 +330,91 @@ json_string extract(const char *str)
     return json_string(gen);
 }
 
+/**
+ * Append the replacement for a match to the destination, expanding
+ * back-references to the captures.
+ */
+static void append_replacement(string &dest, const char *repl,
+                               const char *str, const int *ovector, int count)
+{
+    for (const char *ch = repl; *ch; ch++) {
+        if (*ch != '\\') {
+            dest.push_back(*ch);
+            continue;
+        }
+
+        ch += 1;
+        if (isdigit(*ch)) {
+            int group = *ch - '0';
+
+            if (group >= count) {
+                return;
+            }
+
+            int cap_start = ovector[group * 2];
+
+            if (cap_start >= 0) {
+                dest.append(&str[cap_start], ovector[group * 2 + 1] - cap_start);
+            }
+        } else if (*ch == '\\') {
+            dest.push_back('\\');
+        } else {
+            return;
+        }
+    }
+}
+
 static
-string regexp_replace(const char *str, const char *re, const char *repl)
+string regexp_replace(const char *str, shared_ptr<sql_regex> re, const char *repl)
 {
-    cache_entry *reobj = find_re(re);
-    string dest(str);
+    int ovector[REPLACE_CAPTURE_MAX * 3];
+    int len = strlen(str);
+    int start = 0;
+    bool last_match_was_empty = false;
+    sql_regex::matcher m(*re, str, len);
+    string dest;
+
+    // Same semantics as pcrecpp::RE::GlobalReplace(), after an empty match,
+    // look for a non-empty one at the same position before moving ahead.
+    while (start <= len) {
+        int rc;
+
+        if (last_match_was_empty) {
+            rc = m.exec(start, PCRE_ANCHORED | PCRE_NOTEMPTY,
+                        ovector, REPLACE_CAPTURE_MAX * 3);
+            if (rc < 0) {
+                int next = start + 1;
+
+                while (next < len && (str[next] & 0xc0) == 0x80) {
+                    next += 1;
+                }
+                if (start < len) {
+                    dest.append(&str[start], next - start);
+                }
+                start = next;
+                last_match_was_empty = false;
+                continue;
+            }
+        } else {
+            rc = m.exec(start, 0, ovector, REPLACE_CAPTURE_MAX * 3);
+            if (rc < 0) {
+                break;
+            }
+        }
+        if (rc == 0) {
+            rc = REPLACE_CAPTURE_MAX;
+        }
+
+        dest.append(&str[start], ovector[0] - start);
+        append_replacement(dest, repl, str, ovector, rc);
+        start = ovector[1];
+        last_match_was_empty = (ovector[0] == ovector[1]);
+    }
+
+    if (start < len) {
+        dest.append(&str[start], len - start);
+    }
 
-    reobj->re->GlobalReplace(repl, &dest);
     return dest;
 }
 
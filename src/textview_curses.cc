@@ -319,29 +319,64 @@ void textview_curses::textview_value_for_row(vis_line_t row,
         format_name = sa_iter->to_string();
     }
 
-    for (auto &tc_highlight : this->tc_highlights) {
-        // XXX testing for '$search' here sucks
-        bool internal_hl = tc_highlight.first[0] == '$'
-                           && tc_highlight.first != "$search"
-                           && tc_highlight.first != "$preview";
-
-        if (tc_highlight.second.h_text_format != text_format_t::TF_UNKNOWN &&
-            source_format != tc_highlight.second.h_text_format) {
-            continue;
-        }
+    highlight_cache_entry &hce =
+        this->tc_highlight_cache[row % HIGHLIGHT_CACHE_SIZE];
+
+    if (hce.matches(row,
+                    this->tc_highlight_generation,
+                    vc.vc_theme_generation,
+                    source_format,
+                    format_name,
+                    body.lr_start,
+                    orig_line.lr_start,
+                    str)) {
+        sa.insert(sa.end(), hce.hce_attrs.begin(), hce.hce_attrs.end());
+    } else {
+        size_t hl_start = sa.size();
+        byte_set present;
+
+        // Scan the line once so that highlighters that cannot match are
+        // skipped without running their regex.
+        present.add(str.c_str(), str.size());
+        for (auto &tc_highlight : this->tc_highlights) {
+            // XXX testing for '$search' here sucks
+            bool internal_hl = tc_highlight.first[0] == '$'
+                               && tc_highlight.first != "$search"
+                               && tc_highlight.first != "$preview";
+
+            if (tc_highlight.second.h_text_format != text_format_t::TF_UNKNOWN &&
+                source_format != tc_highlight.second.h_text_format) {
+                continue;
+            }
 
-        if (!tc_highlight.second.h_format_name.empty() &&
-            tc_highlight.second.h_format_name != format_name) {
-            continue;
+            if (!tc_highlight.second.h_format_name.empty() &&
+                tc_highlight.second.h_format_name != format_name) {
+                continue;
+            }
+
+            // Internal highlights should only apply to the log message body
+            // so that we don't start highlighting other fields.  User-provided
+            // highlights should apply only to the line itself and not any of
+            // the surrounding decorations that are added (for example, the
+            // file lines that are inserted at the beginning of the log view).
+            int start_pos = internal_hl ? body.lr_start : orig_line.lr_start;
+
+            if (!tc_highlight.second.might_match(present,
+                                                 str.size() - start_pos)) {
+                continue;
+            }
+            tc_highlight.second.annotate(value_out, start_pos);
         }
 
-        // Internal highlights should only apply to the log message body so
-        // that we don't start highlighting other fields.  User-provided
-        // highlights should apply only to the line itself and not any of the
-        // surrounding decorations that are added (for example, the file lines
-        // that are inserted at the beginning of the log view).
-        int start_pos = internal_hl ? body.lr_start : orig_line.lr_start;
-        tc_highlight.second.annotate(value_out, start_pos);
+        hce.hce_row = row;
+        hce.hce_generation = this->tc_highlight_generation;
+        hce.hce_theme_generation = vc.vc_theme_generation;
+        hce.hce_text_format = source_format;
+        hce.hce_format_name = format_name;
+        hce.hce_body_start = body.lr_start;
+        hce.hce_orig_start = orig_line.lr_start;
+        hce.hce_value = str;
+        hce.hce_attrs.assign(sa.begin() + hl_start, sa.end());
     }
 
     if (this->tc_hide_fields) {
@@ -438,6 +473,7 @@ void textview_curses::execute_search(const std::string &regex_orig)
 
         this->tc_search_child.reset();
         this->tc_source_search_child.reset();
+        this->tc_highlight_generation += 1;
 
         log_debug("start search for: '%s'", regex.c_str());
 
@@ -837,7 +837,12 @@ public:
 
     typedef std::map<std::string, highlighter> highlight_map_t;
 
-    highlight_map_t &get_highlights() { return this->tc_highlights; };
+    highlight_map_t &get_highlights() {
+        // The caller might modify the map, so assume the cached results of
+        // applying the highlighters are no longer valid.
+        this->tc_highlight_generation += 1;
+        return this->tc_highlights;
+    };
 
     const highlight_map_t &get_highlights() const { return this->tc_highlights; };
 
@@ -958,6 +963,43 @@ protected:
         textview_curses::highlight_map_t &gh_hl_map;
     };
 
+    static const size_t HIGHLIGHT_CACHE_SIZE = 128;
+
+    /**
+     * The attributes produced by running the highlighters over a row.  The
+     * highlighters are a pure function of the text and the parameters below,
+     * so an entry can be reused as long as they all match.
+     */
+    struct highlight_cache_entry {
+        bool matches(vis_line_t row,
+                     uint64_t generation,
+                     uint64_t theme_generation,
+                     text_format_t tf,
+                     const intern_string_t &format_name,
+                     int body_start,
+                     int orig_start,
+                     const std::string &str) const {
+            return this->hce_row == row &&
+                   this->hce_generation == generation &&
+                   this->hce_theme_generation == theme_generation &&
+                   this->hce_text_format == tf &&
+                   this->hce_format_name == format_name &&
+                   this->hce_body_start == body_start &&
+                   this->hce_orig_start == orig_start &&
+                   this->hce_value == str;
+        };
+
+        vis_line_t hce_row{-1};
+        uint64_t hce_generation{0};
+        uint64_t hce_theme_generation{0};
+        text_format_t hce_text_format{text_format_t::TF_UNKNOWN};
+        intern_string_t hce_format_name;
+        int hce_body_start{0};
+        int hce_orig_start{0};
+        std::string hce_value;
+        string_attrs_t hce_attrs;
+    };
+
     text_sub_source *tc_sub_source;
     text_delegate *tc_delegate;
 
@@ -968,6 +1010,8 @@ protected:
     action tc_search_action;
 
     highlight_map_t           tc_highlights;
+    uint64_t tc_highlight_generation{1};
+    highlight_cache_entry tc_highlight_cache[HIGHLIGHT_CACHE_SIZE];
 
     vis_line_t tc_selection_start;
     vis_line_t tc_selection_last;
@@ -46,73 +46,129 @@
 
 using namespace std;
 
-static string timeslice(const char *time_in, nonstd::optional<const char *> slice_in_opt)
+/**
+ * Convert a time value from SQL into microseconds since the epoch.  Integers
+ * are taken to already be in microseconds, like the log_time_usecs column,
+ * so they do not need to be formatted and then parsed again.
+ */
+static bool time_value_to_usecs(sqlite3_value *time_in, int64_t &us_out)
 {
-    const char *slice_in = slice_in_opt.value_or("15m");
-    relative_time::parse_error pe;
+    switch (sqlite3_value_type(time_in)) {
+        case SQLITE_INTEGER:
+            us_out = sqlite3_value_int64(time_in);
+            return true;
+        case SQLITE_NULL:
+            return false;
+    }
+
+    const char *time_str = (const char *) sqlite3_value_text(time_in);
     date_time_scanner dts;
-    relative_time rt;
+    struct exttm tm;
+    struct timeval tv;
     time_t now;
 
     time(&now);
     dts.set_base_time(now);
-
-    if (!rt.parse(slice_in, strlen(slice_in), pe)) {
-        throw sqlite_func_error("unable to parse time slice value");
+    if (dts.scan(time_str, strlen(time_str), NULL, &tm, tv) == NULL) {
+        return false;
     }
 
-    if (rt.empty()) {
-        throw sqlite_func_error("no time slice value given");
-    }
+    us_out = tv.tv_sec * 1000000LL + tv.tv_usec;
+
+    return true;
+}
+
+static string timeslice(sqlite3_value *time_in, nonstd::optional<const char *> slice_in_opt)
+{
+    static string last_slice_str;
+    static int64_t last_slice_us = 0;
+    static int64_t last_us = -1;
+    static string last_retval;
+
+    const char *slice_in = slice_in_opt.value_or("15m");
 
-    if (rt.is_absolute()) {
-        throw sqlite_func_error("absolute time slices are not valid");
+    if (last_slice_str != slice_in) {
+        relative_time::parse_error pe;
+        relative_time rt;
+
+        if (!rt.parse(slice_in, strlen(slice_in), pe)) {
+            throw sqlite_func_error("unable to parse time slice value");
+        }
+
+        if (rt.empty()) {
+            throw sqlite_func_error("no time slice value given");
+        }
+
+        if (rt.is_absolute()) {
+            throw sqlite_func_error("absolute time slices are not valid");
+        }
+
+        last_slice_str = slice_in;
+        last_slice_us = rt.to_microseconds();
+        last_us = -1;
     }
 
-    struct exttm tm;
-    struct timeval tv;
+    int64_t us, remainder;
 
-    if (dts.scan(time_in, strlen(time_in), NULL, &tm, tv) == NULL) {
+    if (!time_value_to_usecs(time_in, us)) {
         throw sqlite_func_error("unable to parse time value");
     }
 
-    int64_t us = tv.tv_sec * 1000000LL + tv.tv_usec, remainder;
-
-    remainder = us % rt.to_microseconds();
+    remainder = us % last_slice_us;
     us -= remainder;
 
+    // Rows are usually grouped by time, so consecutive calls tend to land in
+    // the same slice.
+    if (us == last_us) {
+        return last_retval;
+    }
+
+    struct timeval tv;
+
     tv.tv_sec = us / (1000 * 1000);
     tv.tv_usec = us % (1000 * 1000);
 
     char ts[64];
     sql_strftime(ts, sizeof(ts), tv);
 
-    return ts;
+    last_us = us;
+    last_retval = ts;
+
+    return last_retval;
 }
 
-static
-nonstd::optional<double> sql_timediff(const char *time1, const char *time2)
+/**
+ * Convert an operand of timediff() into microseconds, relative times like
+ * "now" or "an hour ago" are also accepted.
+ */
+static bool time_diff_operand(sqlite3_value *time_in, int64_t &us_out)
 {
-    struct timeval tv1, tv2, retval;
-    date_time_scanner dts1, dts2;
-    relative_time rt1, rt2;
-    struct relative_time::parse_error pe;
-
-    if (rt1.parse(time1, -1, pe)) {
-        tv1 = rt1.add_now().to_timeval();
-    } else if (!dts1.convert_to_timeval(time1, -1, NULL, tv1)) {
-        return nonstd::nullopt;
+    if (sqlite3_value_type(time_in) == SQLITE_TEXT) {
+        const char *time_str = (const char *) sqlite3_value_text(time_in);
+        struct relative_time::parse_error pe;
+        relative_time rt;
+
+        if (rt.parse(time_str, -1, pe)) {
+            struct timeval tv = rt.add_now().to_timeval();
+
+            us_out = tv.tv_sec * 1000000LL + tv.tv_usec;
+            return true;
+        }
     }
 
-    if (rt2.parse(time2, -1, pe)) {
-        tv2 = rt2.add_now().to_timeval();
-    } else if (!dts2.convert_to_timeval(time2, -1, NULL, tv2)) {
+    return time_value_to_usecs(time_in, us_out);
+}
+
+static
+nonstd::optional<double> sql_timediff(sqlite3_value *time1, sqlite3_value *time2)
+{
+    int64_t us1, us2;
+
+    if (!time_diff_operand(time1, us1) || !time_diff_operand(time2, us2)) {
         return nonstd::nullopt;
     }
 
-    timersub(&tv1, &tv2, &retval);
-
-    return (double) retval.tv_sec + (double) retval.tv_usec / 1000000.0;
+    return (double) (us1 - us2) / 1000000.0;
 }
 
 int time_extension_functions(struct FuncDef **basic_funcs,
@@ -688,6 +688,7 @@ public:
         if (view_colors::initialized) {
             vc.init_roles(iter->second, reporter);
         }
+        vc.vc_theme_generation += 1;
     }
 };
 
@@ -447,6 +447,9 @@ public:
 
     std::pair<attr_t, attr_t> vc_level_attrs[LEVEL__MAX];
 
+    /** Incremented each time the theme is (re)loaded. */
+    uint64_t vc_theme_generation{0};
+
     static bool initialized;
 
 private:
@@ -347,8 +347,8 @@ void execute_examples()
                     execute_sql(ec, ex.he_cmd, alt_msg);
 
                     if (dls.dls_rows.size() == 1 &&
-                        dls.dls_rows[0].size() == 1) {
-                        result.append(dls.dls_rows[0][0]);
+                        dls.dls_headers.size() == 1) {
+                        result.append(dls.get_cell(0, 0));
                     } else {
                         attr_line_t al;
                         dos.list_value_for_overlay(db_tc,
@@ -166,6 +166,20 @@ struct from_sqlite<const std::vector<T> &> {
     }
 };
 
+/**
+ * Converts an argument of a SQL function when the conversion needs access to
+ * the function context, for example, to cache a value derived from a
+ * constant argument with sqlite3_set_auxdata().  By default, this falls back
+ * to from_sqlite.
+ */
+template<typename T>
+struct from_sqlite_with_context {
+    inline auto operator()(sqlite3_context *ctx,
+                           int argc, sqlite3_value **val, int argi) {
+        return from_sqlite<T>()(argc, val, argi);
+    }
+};
+
 inline void to_sqlite(sqlite3_context *ctx, const char *str)
 {
     if (str == nullptr) {
@@ -325,7 +339,8 @@ struct sqlite_func_adapter<Return (*)(Args...), f> {
                       int argc, sqlite3_value **argv,
                       std::index_sequence<Idx...>) {
         try {
-            Return retval = f(from_sqlite<Args>()(argc, argv, Idx)...);
+            Return retval = f(from_sqlite_with_context<Args>()(
+                context, argc, argv, Idx)...);
 
             to_sqlite(context, retval);
         } catch (from_sqlite_conversion_error &e) {
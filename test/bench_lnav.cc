@@ -0,0 +1,752 @@
+/**
+ * Copyright (c) 2019, Timothy Stack
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * * Neither the name of Timothy Stack nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * @file bench_lnav.cc
+ *
+ * Benchmarks for the indexing, searching, filtering, and SQL parts of lnav.
+ * The log files are generated from a fixed seed, so the input is the same
+ * from run to run, and the results are written out as JSON so that they can
+ * be compared over time.
+ */
+
+#include "config.h"
+
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#include <zlib.h>
+#ifdef HAVE_BZLIB_H
+#include <bzlib.h>
+#endif
+
+#include <string>
+#include <vector>
+
+#include "fmt/format.h"
+#include "lnav.hh"
+#include "auto_mem.hh"
+#include "grep_proc.hh"
+#include "logfile.hh"
+#include "logfile_sub_source.hh"
+#include "log_format_loader.hh"
+#include "log_vtab_impl.hh"
+#include "sqlite-extension-func.hh"
+#include "regexp_vtab.hh"
+#include "yajlpp/yajlpp.hh"
+
+using namespace std;
+
+struct _lnav_data lnav_data;
+
+void rebuild_hist()
+{
+}
+
+bool setup_logline_table(exec_context &ec)
+{
+    return false;
+}
+
+bool rescan_files(bool required)
+{
+    return false;
+}
+
+void wait_for_children()
+{
+}
+
+void rebuild_indexes()
+{
+}
+
+readline_context::command_map_t lnav_commands;
+
+extern "C" {
+const char *help_txt = "";
+}
+
+/**
+ * A small linear congruential generator so that the generated logs do not
+ * depend on the C library's rand().
+ */
+class bench_random {
+public:
+    bench_random(uint64_t seed) : br_state(seed) { };
+
+    uint32_t next() {
+        this->br_state = this->br_state * 6364136223846793005ULL +
+                         1442695040888963407ULL;
+        return (uint32_t) (this->br_state >> 33U);
+    };
+
+    uint32_t pick(uint32_t count) {
+        return this->next() % count;
+    };
+
+    template<size_t N>
+    const char *pick(const char *(&choices)[N]) {
+        return choices[this->pick(N)];
+    };
+
+private:
+    uint64_t br_state;
+};
+
+static const char *HOSTS[] = {
+    "frontend1", "frontend2", "backend1", "db-primary", "db-replica",
+};
+
+static const char *PROCS[] = {
+    "sshd", "cron", "kernel", "dhclient", "nginx", "postgres",
+};
+
+static const char *MESSAGES[] = {
+    "Accepted publickey for user%u from 10.0.%u.%u port %u ssh2",
+    "pam_unix(sshd:session): session opened for user user%u by (uid=0)",
+    "error: connection reset by peer after %u bytes, retry %u of %u",
+    "DHCPACK from 192.168.%u.%u (xid=0x%x)",
+    "Out of memory: Kill process %u (worker) score %u or sacrifice child",
+    "checkpoint complete: wrote %u buffers (%u.%u%%); 0 transaction log file(s) added",
+    "warning: request to /api/v1/items/%u took %u ms",
+};
+
+static const char *PATHS[] = {
+    "/index.html", "/api/v1/items", "/api/v1/users", "/static/app.js",
+    "/static/style.css", "/login", "/favicon.ico",
+};
+
+static const char *METHODS[] = {
+    "GET", "GET", "GET", "POST", "PUT", "DELETE",
+};
+
+static const char *AGENTS[] = {
+    "Mozilla/5.0 (X11; Linux x86_64)",
+    "curl/7.58.0",
+    "Wget/1.19.4 (linux-gnu)",
+};
+
+static const char *STATUSES[] = {
+    "200", "200", "200", "200", "304", "404", "500",
+};
+
+static const char *FRAMES[] = {
+    "com.example.server.RequestHandler.handle(RequestHandler.java:%u)",
+    "com.example.server.Dispatcher.dispatch(Dispatcher.java:%u)",
+    "com.example.db.ConnectionPool.acquire(ConnectionPool.java:%u)",
+    "java.lang.Thread.run(Thread.java:%u)",
+};
+
+static const time_t START_TIME = 1546300800;
+
+struct bench_log {
+    const char *bl_name;
+    void (*bl_generator)(bench_random &rng, time_t tv, string &out);
+    const char *bl_table;
+};
+
+static void format_message(bench_random &rng, string &out)
+{
+    char msg[256];
+
+    snprintf(msg, sizeof(msg), rng.pick(MESSAGES),
+             rng.pick(1000), rng.pick(256), rng.pick(256), rng.pick(65536));
+    out.append(msg);
+}
+
+static void gen_syslog(bench_random &rng, time_t tv, string &out)
+{
+    char ts[64], prefix[128];
+    struct tm tm;
+
+    gmtime_r(&tv, &tm);
+    strftime(ts, sizeof(ts), "%b %e %H:%M:%S", &tm);
+    snprintf(prefix, sizeof(prefix), "%s %s %s[%u]: ",
+             ts, rng.pick(HOSTS), rng.pick(PROCS), 100 + rng.pick(30000));
+    out.append(prefix);
+    format_message(rng, out);
+    out.append("\n");
+}
+
+static void gen_access_log(bench_random &rng, time_t tv, string &out)
+{
+    char ts[64], line[512];
+    struct tm tm;
+
+    gmtime_r(&tv, &tm);
+    strftime(ts, sizeof(ts), "%d/%b/%Y:%H:%M:%S +0000", &tm);
+    snprintf(line, sizeof(line),
+             "10.%u.%u.%u - - [%s] \"%s %s HTTP/1.1\" %s %u \"-\" \"%s\"\n",
+             rng.pick(256), rng.pick(256), rng.pick(256),
+             ts,
+             rng.pick(METHODS),
+             rng.pick(PATHS),
+             rng.pick(STATUSES),
+             rng.pick(100000),
+             rng.pick(AGENTS));
+    out.append(line);
+}
+
+static void gen_json(bench_random &rng, time_t tv, string &out)
+{
+    char prefix[256];
+    string msg;
+
+    format_message(rng, msg);
+    snprintf(prefix, sizeof(prefix),
+             "{ \"__REALTIME_TIMESTAMP\" : \"%lld%06u\", "
+             "\"PRIORITY\" : \"%u\", "
+             "\"SYSLOG_IDENTIFIER\" : \"%s\", "
+             "\"_PID\" : \"%u\", "
+             "\"MESSAGE\" : \"",
+             (long long) tv, rng.pick(1000000),
+             3 + rng.pick(5),
+             rng.pick(PROCS),
+             100 + rng.pick(30000));
+    out.append(prefix);
+    out.append(msg);
+    out.append("\" }\n");
+}
+
+static void gen_multiline(bench_random &rng, time_t tv, string &out)
+{
+    gen_syslog(rng, tv, out);
+    if (rng.pick(4) == 0) {
+        size_t frames = 2 + rng.pick(8);
+
+        out.append("java.lang.IllegalStateException: pool exhausted\n");
+        for (size_t lpc = 0; lpc < frames; lpc++) {
+            char frame[256];
+
+            out.append("\tat ");
+            snprintf(frame, sizeof(frame), rng.pick(FRAMES), rng.pick(2000));
+            out.append(frame);
+            out.append("\n");
+        }
+    }
+}
+
+static bench_log BENCH_LOGS[] = {
+    { "syslog", gen_syslog, "syslog_log" },
+    { "access_log", gen_access_log, "access_log" },
+    { "json", gen_json, "journald_json_log" },
+    { "multiline", gen_multiline, "syslog_log" },
+};
+
+struct bench_options {
+    size_t bo_lines{100000};
+    uint64_t bo_seed{1};
+    string bo_dir;
+    string bo_output;
+    int bo_repeat{3};
+};
+
+struct bench_result {
+    string br_name;
+    string br_input;
+    size_t br_lines{0};
+    size_t br_bytes{0};
+    double br_seconds{0.0};
+    long br_peak_rss_kb{0};
+};
+
+static double now_seconds()
+{
+    struct timeval tv;
+
+    gettimeofday(&tv, nullptr);
+    return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+static long peak_rss_kb()
+{
+    struct rusage ru;
+
+    getrusage(RUSAGE_SELF, &ru);
+#ifdef __APPLE__
+    return ru.ru_maxrss / 1024;
+#else
+    return ru.ru_maxrss;
+#endif
+}
+
+static bool write_plain(const string &path, const string &data)
+{
+    auto_mem<FILE> file(fclose);
+
+    if ((file = fopen(path.c_str(), "w")) == nullptr) {
+        return false;
+    }
+    return fwrite(data.data(), 1, data.size(), file.in()) == data.size();
+}
+
+static bool write_gzip(const string &path, const string &data)
+{
+    gzFile file = gzopen(path.c_str(), "wb");
+    bool retval;
+
+    if (file == nullptr) {
+        return false;
+    }
+    retval = gzwrite(file, data.data(), data.size()) == (int) data.size();
+    gzclose(file);
+
+    return retval;
+}
+
+#ifdef HAVE_BZLIB_H
+static bool write_bzip2(const string &path, const string &data)
+{
+    auto_mem<FILE> file(fclose);
+    BZFILE *bz;
+    int bzerror;
+
+    if ((file = fopen(path.c_str(), "w")) == nullptr) {
+        return false;
+    }
+    if ((bz = BZ2_bzWriteOpen(&bzerror, file.in(), 9, 0, 0)) == nullptr) {
+        return false;
+    }
+    BZ2_bzWrite(&bzerror, bz, (void *) data.data(), data.size());
+    BZ2_bzWriteClose(&bzerror, bz, 0, nullptr, nullptr);
+
+    return bzerror == BZ_OK;
+}
+#endif
+
+static string generate_log(const bench_log &bl, const bench_options &opts)
+{
+    bench_random rng(opts.bo_seed);
+    time_t tv = START_TIME;
+    string retval;
+
+    for (size_t lpc = 0; lpc < opts.bo_lines; lpc++) {
+        bl.bl_generator(rng, tv, retval);
+        tv += rng.pick(3);
+    }
+
+    return retval;
+}
+
+static void add_result(vector<bench_result> &results,
+                       const char *name,
+                       const string &input,
+                       size_t lines,
+                       size_t bytes,
+                       double seconds)
+{
+    bench_result br;
+
+    br.br_name = name;
+    br.br_input = input;
+    br.br_lines = lines;
+    br.br_bytes = bytes;
+    br.br_seconds = seconds;
+    br.br_peak_rss_kb = peak_rss_kb();
+    results.push_back(br);
+
+    fprintf(stderr, "%-16s %-22s %10.0f lines/s %8.1f MB/s\n",
+            name, input.c_str(),
+            seconds > 0.0 ? lines / seconds : 0.0,
+            seconds > 0.0 ? bytes / seconds / (1024.0 * 1024.0) : 0.0);
+}
+
+static shared_ptr<logfile> index_file(const string &path)
+{
+    logfile_open_options loo;
+    auto retval = make_shared<logfile>(path, loo);
+    logfile::rebuild_result_t rr;
+
+    do {
+        rr = retval->rebuild_index();
+    } while (rr == logfile::RR_NEW_LINES || rr == logfile::RR_NEW_ORDER);
+
+    return retval;
+}
+
+class bench_grep_sink : public grep_proc_sink<vis_line_t> {
+public:
+    void grep_match(grep_proc<vis_line_t> &gp,
+                    vis_line_t line,
+                    int start,
+                    int end) override {
+        this->bgs_matches += 1;
+    };
+
+    void grep_capture(grep_proc<vis_line_t> &gp,
+                      vis_line_t line,
+                      int start,
+                      int end,
+                      char *capture) override {
+    };
+
+    void grep_end(grep_proc<vis_line_t> &gp) override {
+        this->bgs_finished = true;
+    };
+
+    size_t bgs_matches{0};
+    bool bgs_finished{false};
+};
+
+static size_t run_grep(textview_curses &tc, const char *pattern)
+{
+    const char *errptr;
+    int eoff;
+    pcre *code = pcre_compile(pattern, PCRE_CASELESS, &errptr, &eoff, nullptr);
+    bench_grep_sink sink;
+
+    if (code == nullptr) {
+        fprintf(stderr, "error: invalid pattern -- %s\n", errptr);
+        exit(EXIT_FAILURE);
+    }
+
+    // Hold a reference so the pattern outlives the grep_proc and is freed
+    // here instead of by the pcrepp inside of it.
+    pcre_refcount(code, 1);
+    {
+        grep_proc<vis_line_t> gp(code, tc);
+
+        gp.set_sink(&sink);
+        gp.queue_request();
+        gp.start();
+
+        while (!sink.bgs_finished) {
+            vector<struct pollfd> pollfds;
+
+            gp.update_poll_set(pollfds);
+            if (pollfds.empty()) {
+                break;
+            }
+            poll(&pollfds[0], pollfds.size(), -1);
+            gp.check_poll_set(pollfds);
+        }
+    }
+    if (pcre_refcount(code, -1) == 0) {
+        pcre_free(code);
+    }
+
+    return sink.bgs_matches;
+}
+
+static int count_rows(void *ptr, int ncols, char **colvalues, char **colnames)
+{
+    size_t *rows = (size_t *) ptr;
+
+    *rows += 1;
+
+    return 0;
+}
+
+static void bench_view(const bench_log &bl,
+                       const string &path,
+                       size_t bytes,
+                       const bench_options &opts,
+                       vector<bench_result> &results)
+{
+    logfile_sub_source lss;
+    textview_curses tc;
+    auto lf = index_file(path);
+    double start;
+
+    tc.set_sub_source(&lss);
+    lss.insert_file(lf);
+
+    start = now_seconds();
+    lss.rebuild_index();
+    add_result(results, "lss_index", bl.bl_name, lss.text_line_count(), bytes,
+               now_seconds() - start);
+
+    start = now_seconds();
+    for (int lpc = 0; lpc < opts.bo_repeat; lpc++) {
+        run_grep(tc, "error|warning");
+    }
+    add_result(results, "grep", bl.bl_name,
+               lss.text_line_count() * opts.bo_repeat,
+               bytes * opts.bo_repeat,
+               now_seconds() - start);
+
+    {
+        filter_stack &fs = lss.get_filters();
+        const char *errptr;
+        int eoff;
+        pcre *code = pcre_compile("error", PCRE_CASELESS, &errptr, &eoff,
+                                  nullptr);
+        auto pf = make_shared<pcre_filter>(text_filter::EXCLUDE,
+                                           "error",
+                                           fs.next_index(),
+                                           code);
+        size_t total_lines = lss.text_line_count();
+
+        start = now_seconds();
+        fs.add_filter(pf);
+        lss.text_filters_changed();
+        add_result(results, "filter_add", bl.bl_name, total_lines, bytes,
+                   now_seconds() - start);
+
+        start = now_seconds();
+        for (int lpc = 0; lpc < opts.bo_repeat; lpc++) {
+            fs.set_filter_enabled(pf, false);
+            lss.text_filters_changed();
+            fs.set_filter_enabled(pf, true);
+            lss.text_filters_changed();
+        }
+        add_result(results, "filter_toggle", bl.bl_name,
+                   total_lines * opts.bo_repeat * 2,
+                   bytes * opts.bo_repeat * 2,
+                   now_seconds() - start);
+
+        fs.delete_filter("error");
+        lss.text_filters_changed();
+    }
+
+    {
+        auto_mem<sqlite3> db(sqlite3_close);
+        vector<string> errors;
+
+        sqlite3_open(":memory:", db.out());
+        {
+            int register_collation_functions(sqlite3 * db);
+
+            register_sqlite_funcs(db.in(), sqlite_registration_funcs);
+            register_collation_functions(db.in());
+        }
+        register_regexp_vtab(db.in());
+
+        log_vtab_manager vtab_manager(db.in(), tc, lss);
+
+        load_format_vtabs(&vtab_manager, errors);
+
+        string queries[] = {
+            fmt::format("SELECT count(*) FROM {}", bl.bl_table),
+            fmt::format("SELECT log_level, count(*) FROM {} GROUP BY log_level",
+                        bl.bl_table),
+            fmt::format("SELECT log_line FROM {} WHERE log_body LIKE '%error%'",
+                        bl.bl_table),
+        };
+        const char *query_names[] = {
+            "sql_count",
+            "sql_group_by",
+            "sql_like",
+        };
+
+        for (size_t lpc = 0; lpc < sizeof(query_names) / sizeof(query_names[0]); lpc++) {
+            auto_mem<char, sqlite3_free> errmsg;
+            size_t rows = 0;
+
+            start = now_seconds();
+            if (sqlite3_exec(db.in(), queries[lpc].c_str(), count_rows, &rows,
+                             errmsg.out()) != SQLITE_OK) {
+                fprintf(stderr, "error: %s failed -- %s\n",
+                        queries[lpc].c_str(), errmsg.in());
+                continue;
+            }
+            add_result(results, query_names[lpc], bl.bl_name,
+                       lss.text_line_count(), bytes, now_seconds() - start);
+        }
+    }
+}
+
+static void write_results(const bench_options &opts,
+                          const vector<bench_result> &results)
+{
+    auto_mem<yajl_gen_t> gen(yajl_gen_free);
+    const unsigned char *buf;
+    size_t len;
+
+    gen = yajl_gen_alloc(nullptr);
+    yajl_gen_config(gen.in(), yajl_gen_beautify, 1);
+
+    {
+        yajlpp_map root(gen.in());
+
+        root.gen("lines-per-file");
+        root.gen(opts.bo_lines);
+        root.gen("seed");
+        root.gen(opts.bo_seed);
+        root.gen("repeat");
+        root.gen(opts.bo_repeat);
+        root.gen("results");
+
+        yajlpp_array result_array(gen.in());
+
+        for (const auto &br : results) {
+            yajlpp_map result_map(gen.in());
+
+            result_map.gen("name");
+            result_map.gen(br.br_name);
+            result_map.gen("input");
+            result_map.gen(br.br_input);
+            result_map.gen("lines");
+            result_map.gen(br.br_lines);
+            result_map.gen("bytes");
+            result_map.gen(br.br_bytes);
+            result_map.gen("seconds");
+            yajl_gen_double(gen.in(), br.br_seconds);
+            result_map.gen("lines-per-second");
+            yajl_gen_double(gen.in(), br.br_seconds > 0.0 ?
+                                      br.br_lines / br.br_seconds : 0.0);
+            result_map.gen("bytes-per-second");
+            yajl_gen_double(gen.in(), br.br_seconds > 0.0 ?
+                                      br.br_bytes / br.br_seconds : 0.0);
+            result_map.gen("peak-rss-kb");
+            result_map.gen(br.br_peak_rss_kb);
+        }
+    }
+
+    yajl_gen_get_buf(gen.in(), &buf, &len);
+    if (opts.bo_output.empty()) {
+        fwrite(buf, 1, len, stdout);
+    } else {
+        auto_mem<FILE> file(fclose);
+
+        if ((file = fopen(opts.bo_output.c_str(), "w")) == nullptr) {
+            fprintf(stderr, "error: unable to open %s -- %s\n",
+                    opts.bo_output.c_str(), strerror(errno));
+            return;
+        }
+        fwrite(buf, 1, len, file.in());
+    }
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "usage: %s [-n lines] [-s seed] [-r repeat] [-d dir] [-o output]\n"
+            "\n"
+            "  -n  The number of messages to generate for each log (%zu).\n"
+            "  -s  The seed for the log generators.\n"
+            "  -r  The number of times to repeat the grep and filter runs.\n"
+            "  -d  The directory to write the generated logs to.\n"
+            "  -o  The file to write the JSON results to (stdout).\n",
+            prog, bench_options().bo_lines);
+}
+
+int main(int argc, char *argv[])
+{
+    int c, retval = EXIT_SUCCESS;
+    vector<bench_result> results;
+    bench_options opts;
+    char dir_template[] = "/tmp/lnav-bench.XXXXXX";
+    bool remove_dir = false;
+
+    log_argv(argc, argv);
+
+    while ((c = getopt(argc, argv, "hn:s:r:d:o:")) != -1) {
+        switch (c) {
+            case 'n':
+                opts.bo_lines = strtoull(optarg, nullptr, 10);
+                break;
+            case 's':
+                opts.bo_seed = strtoull(optarg, nullptr, 10);
+                break;
+            case 'r':
+                opts.bo_repeat = std::max(1, atoi(optarg));
+                break;
+            case 'd':
+                opts.bo_dir = optarg;
+                break;
+            case 'o':
+                opts.bo_output = optarg;
+                break;
+            default:
+                usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    if (opts.bo_dir.empty()) {
+        if (mkdtemp(dir_template) == nullptr) {
+            perror("mkdtemp");
+            return EXIT_FAILURE;
+        }
+        opts.bo_dir = dir_template;
+        remove_dir = true;
+    }
+
+    {
+        std::vector<std::string> paths, errors;
+
+        load_formats(paths, errors);
+        for (const auto &err : errors) {
+            fprintf(stderr, "%s\n", err.c_str());
+        }
+    }
+
+    for (const auto &bl : BENCH_LOGS) {
+        string data = generate_log(bl, opts);
+        string base = opts.bo_dir + "/" + bl.bl_name + ".log";
+        struct {
+            const char *suffix;
+            bool (*writer)(const string &path, const string &data);
+        } variants[] = {
+            { "", write_plain },
+            { ".gz", write_gzip },
+#ifdef HAVE_BZLIB_H
+            { ".bz2", write_bzip2 },
+#endif
+        };
+
+        for (const auto &var : variants) {
+            string path = base + var.suffix;
+            double start;
+
+            if (!var.writer(path, data)) {
+                fprintf(stderr, "error: unable to write %s\n", path.c_str());
+                retval = EXIT_FAILURE;
+                continue;
+            }
+
+            start = now_seconds();
+            auto lf = index_file(path);
+            add_result(results, "logfile_index",
+                       string(bl.bl_name) + ".log" + var.suffix,
+                       lf->size(), data.size(), now_seconds() - start);
+        }
+
+        bench_view(bl, base, data.size(), opts, results);
+
+        if (remove_dir) {
+            for (const auto &var : variants) {
+                remove((base + var.suffix).c_str());
+            }
+        }
+    }
+
+    if (remove_dir) {
+        rmdir(opts.bo_dir.c_str());
+    }
+
+    write_results(opts, results);
+
+    return retval;
+}
@@ -56,6 +56,11 @@ string execute_any(exec_context &ec, const string &cmdline_with_mode)
     return "";
 }
 
+string execute_rewriter(exec_context &ec, const string &rewriter, bool pure)
+{
+    return "";
+}
+
 void add_global_vars(exec_context &ec)
 {
 }
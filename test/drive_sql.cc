@@ -2,6 +2,7 @@
 #include <string.h>
 #include <stdlib.h>
 #include <assert.h>
+#include <unistd.h>
 
 #include <sqlite3.h>
 
@@ -11,6 +12,7 @@
 #include "auto_mem.hh"
 #include "sqlite-extension-func.hh"
 #include "regexp_vtab.hh"
+#include "dns_resolver.hh"
 
 struct callback_state {
     int cs_row;
@@ -66,14 +68,28 @@ const char *help_txt = "";
 
 int main(int argc, char *argv[])
 {
-    int retval = EXIT_SUCCESS;
+    int c, retval = EXIT_SUCCESS;
     auto_mem<sqlite3> db(sqlite3_close);
     std::string stmt;
 
     log_argv(argc, argv);
 
-    if (argc == 2) {
-        stmt = argv[1];
+    while ((c = getopt(argc, argv, "H:")) != -1) {
+        switch (c) {
+            case 'H':
+                // Resolve hostnames from the given file instead of the
+                // network.
+                dns_cache::singleton().set_resolver(
+                    std::make_shared<hosts_file_resolver>(optarg));
+                break;
+        }
+    }
+
+    argc -= optind;
+    argv += optind;
+
+    if (argc == 1) {
+        stmt = argv[0];
     } else {
         std::getline(std::cin, stmt, '\0');
     }
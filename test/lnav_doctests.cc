@@ -33,9 +33,17 @@
 #include "doctest.hh"
 
 #include "lnav_config.hh"
+#include "highlighter.hh"
 #include "view_curses.hh"
 #include "relative_time.hh"
 #include "unique_path.hh"
+#include "db_result_store.hh"
+#include "lru_cache.hh"
+#include "intern_string.hh"
+#include "dns_resolver.hh"
+
+#include <future>
+#include <unordered_set>
 
 using namespace std;
 
@@ -158,3 +166,186 @@ TEST_CASE("unique_path") {
     CHECK(log1->get_unique_path() == "[machine1]/syslog.log");
     CHECK(log2->get_unique_path() == "[machine2]/syslog.log");
 }
+
+TEST_CASE("highlighter prefilter") {
+    const char *errptr;
+    int eoff;
+    highlighter hl(pcre_compile("foo\\d+", 0, &errptr, &eoff, nullptr));
+    highlighter hl_nocase(pcre_compile("bar", PCRE_CASELESS, &errptr, &eoff,
+                                       nullptr));
+    byte_set present;
+
+    present.add("abc 123", 7);
+    CHECK(!hl.might_match(present, 7));
+    CHECK(!hl_nocase.might_match(present, 7));
+
+    present.add("foo", 3);
+    CHECK(hl.might_match(present, 10));
+    CHECK(!hl.might_match(present, 2));
+
+    present.clear();
+    present.add("BAR", 3);
+    CHECK(hl_nocase.might_match(present, 3));
+}
+
+TEST_CASE("db_result_store spill") {
+    auto_mem<sqlite3, sqlite_close_wrapper> db;
+    auto_mem<sqlite3_stmt> stmt(sqlite3_finalize);
+    db_result_store drs;
+
+    sqlite3_open(":memory:", db.out());
+    sqlite3_prepare_v2(db.in(),
+                       "SELECT 1, 2.0, 'abc', NULL, 1e20", -1,
+                       stmt.out(), nullptr);
+    REQUIRE(sqlite3_step(stmt.in()) == SQLITE_ROW);
+
+    for (int lpc = 0; lpc < 5; lpc++) {
+        drs.add_column();
+    }
+    drs.set_memory_limit(1);
+    for (int row = 0; row < 3; row++) {
+        drs.push_row();
+        for (int lpc = 0; lpc < 5; lpc++) {
+            drs.push_value(sqlite3_column_value(stmt.in(), lpc));
+        }
+    }
+
+    CHECK(drs.size() == 3);
+    CHECK(drs.is_spilled());
+
+    for (size_t row = 0; row < drs.size(); row++) {
+        std::string text;
+
+        drs.get_cell(row, 0).render(text);
+        CHECK(text == "1");
+        text.clear();
+        drs.get_cell(row, 1).render(text);
+        CHECK(text == "2.0");
+        text.clear();
+        drs.get_cell(row, 2).render(text);
+        CHECK(text == "abc");
+        CHECK(drs.get_cell(row, 3).is_null());
+        text.clear();
+        drs.get_cell(row, 4).render(text);
+        CHECK(text == "1.0e+20");
+    }
+}
+
+TEST_CASE("db_result_store big text") {
+    auto_mem<sqlite3, sqlite_close_wrapper> db;
+    auto_mem<sqlite3_stmt> stmt(sqlite3_finalize);
+    db_result_store drs;
+
+    sqlite3_open(":memory:", db.out());
+    sqlite3_prepare_v2(db.in(),
+                       "SELECT 'abc', printf('%.*c', 512 * 1024, 'x')", -1,
+                       stmt.out(), nullptr);
+    REQUIRE(sqlite3_step(stmt.in()) == SQLITE_ROW);
+
+    drs.add_column();
+    drs.add_column();
+    for (int row = 0; row < 100; row++) {
+        drs.push_row();
+        drs.push_value(sqlite3_column_value(stmt.in(), 0));
+        drs.push_value(sqlite3_column_value(stmt.in(), 1));
+    }
+
+    CHECK_FALSE(drs.is_spilled());
+    CHECK(drs.get_memory_usage() >= 100 * (512 * 1024 + 1));
+    for (size_t row = 0; row < drs.size(); row++) {
+        CHECK(string(drs.get_cell(row, 0).c_text) == "abc");
+        CHECK(drs.get_cell(row, 1).c_length == 512 * 1024);
+        CHECK(drs.get_cell(row, 1).c_text[512 * 1024 - 1] == 'x');
+    }
+}
+
+TEST_CASE("lru_cache") {
+    lru_cache<std::string, int> cache(2);
+
+    cache.put("a", 1);
+    cache.put("b", 2);
+    REQUIRE(cache.get("a") != nullptr);
+    CHECK(*cache.get("a") == 1);
+
+    cache.put("c", 3);
+    CHECK(cache.size() == 2);
+    CHECK(cache.get("b") == nullptr);
+    CHECK(cache.get("a") != nullptr);
+    CHECK(cache.get("c") != nullptr);
+
+    cache.put("a", 4);
+    CHECK(*cache.get("a") == 4);
+    CHECK(cache.size() == 2);
+}
+
+TEST_CASE("dns_cache") {
+    struct counting_resolver : public dns_resolver {
+        bool lookup_name(const string &name, string &addr_out) override {
+            this->cr_lookups += 1;
+            if (name == "gw.example.com") {
+                addr_out = "10.0.0.1";
+                return true;
+            }
+            return false;
+        };
+
+        bool lookup_addr(const string &addr, string &name_out) override {
+            this->cr_lookups += 1;
+            if (addr == "10.0.0.1") {
+                name_out = "gw.example.com";
+                return true;
+            }
+            return false;
+        };
+
+        int cr_lookups{0};
+    };
+
+    auto resolver = make_shared<counting_resolver>();
+    dns_cache dc(resolver);
+
+    CHECK(dc.addr_to_name("10.0.0.1") == "gw.example.com");
+    CHECK(dc.addr_to_name("10.0.0.1") == "gw.example.com");
+    CHECK(resolver->cr_lookups == 1);
+
+    // Failed lookups are cached too.
+    CHECK(dc.addr_to_name("10.0.0.2") == "10.0.0.2");
+    CHECK(dc.addr_to_name("10.0.0.2") == "10.0.0.2");
+    CHECK(resolver->cr_lookups == 2);
+
+    CHECK(dc.name_to_addr("gw.example.com") == "10.0.0.1");
+    CHECK(dc.name_to_addr("gw.example.com") == "10.0.0.1");
+    CHECK(resolver->cr_lookups == 3);
+
+    dc.clear();
+    CHECK(dc.addr_to_name("10.0.0.1") == "gw.example.com");
+    CHECK(resolver->cr_lookups == 4);
+}
+
+TEST_CASE("intern_string threads") {
+    const int STRING_COUNT = 1000;
+    auto intern_all = []() {
+        vector<const intern_string *> retval;
+
+        for (int lpc = 0; lpc < STRING_COUNT; lpc++) {
+            retval.push_back(
+                intern_string::lookup("thread-field-" + to_string(lpc)));
+        }
+        return retval;
+    };
+    auto first = async(launch::async, intern_all);
+    auto second = async(launch::async, intern_all);
+    auto first_strs = first.get();
+    auto second_strs = second.get();
+
+    CHECK(first_strs == second_strs);
+
+    unordered_set<intern_string_t> ist_set;
+
+    for (auto is : first_strs) {
+        ist_set.insert(is);
+        CHECK(is->hash() == hash_str(is->get(), is->size()));
+    }
+    CHECK(ist_set.size() == STRING_COUNT);
+    CHECK(ist_set.count(intern_string::lookup("thread-field-10")) == 1);
+}
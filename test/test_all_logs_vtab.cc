@@ -0,0 +1,178 @@
+/**
+ * Copyright (c) 2020, Timothy Stack
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * * Neither the name of Timothy Stack nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "logfile.hh"
+#include "log_format_loader.hh"
+#include "all_logs_vtab.hh"
+
+using namespace std;
+
+string execute_any(exec_context &ec, const string &cmdline_with_mode)
+{
+    return "";
+}
+
+string execute_rewriter(exec_context &ec, const string &rewriter, bool pure)
+{
+    return "";
+}
+
+void add_global_vars(exec_context &ec)
+{
+}
+
+/**
+ * Write a syslog message, a few kinds of messages are used so there is more
+ * than one format in the cache.
+ */
+static void write_message(FILE *file, int index)
+{
+    fprintf(file, "Nov  3 09:%02d:%02d veridian ",
+            (index / 60) % 60, index % 60);
+    switch (index % 4) {
+        case 0:
+            fprintf(file, "automount[7998]: lookup(file): lookup for %d "
+                          "failed\n", index);
+            break;
+        case 1:
+            fprintf(file, "sshd[%d]: Accepted publickey for user%d from "
+                          "10.0.0.%d port %d\n",
+                    index, index, index % 256, 1024 + index);
+            break;
+        case 2:
+            fprintf(file, "kernel: eth0: link up, %d Mbps, full duplex\n",
+                    index);
+            break;
+        case 3:
+            fprintf(file, "cron[%d]: (root) CMD (run-parts %d)\n",
+                    index, index);
+            break;
+    }
+}
+
+/**
+ * The log_msg_format and log_msg_schema values for a message.
+ */
+static pair<string, string> extract_format(all_logs_vtab &alv,
+                                           const shared_ptr<logfile> &lf,
+                                           uint64_t line_number)
+{
+    vector<logline_value> values;
+    shared_buffer_ref sbr;
+
+    lf->read_full_message(lf->begin() + line_number, sbr);
+    alv.extract(lf, line_number, sbr, values);
+    assert(values.size() == 3);
+
+    return make_pair(values[1].to_string(), values[2].to_string());
+}
+
+int main(int argc, char *argv[])
+{
+    {
+        std::vector<std::string> paths, errors;
+
+        if (getenv("test_dir") != NULL) {
+            paths.push_back(getenv("test_dir"));
+        }
+        load_formats(paths, errors);
+    }
+
+    char fn_template[] = "test_all_logs_vtab.XXXXXX";
+    int fd = mkstemp(fn_template);
+    FILE *file = fdopen(fd, "w");
+    const int LINE_COUNT = 2000;
+
+    assert(file != nullptr);
+    for (int lpc = 0; lpc < LINE_COUNT; lpc++) {
+        write_message(file, lpc);
+    }
+    // The last message is written in two parts to check that the cache
+    // notices a message that changed at the same offset.
+    fprintf(file, "Nov  3 10:00:00 veridian sshd[1]: Accepted key");
+    fflush(file);
+
+    logfile_open_options loo;
+    auto lf = make_shared<logfile>(fn_template, loo);
+
+    lf->rebuild_index();
+    assert(lf->get_format() != nullptr);
+    lf->rebuild_index();
+    assert(lf->size() == LINE_COUNT + 1);
+
+    {
+        // Read the file in order, like a full table scan, so the lines are
+        // parsed ahead.  The results have to match what is found by a cache
+        // that only sees one line at a time.
+        all_logs_vtab scan_alv, lookup_alv;
+        vector<pair<string, string>> scanned;
+
+        for (uint64_t lpc = 0; lpc < lf->size(); lpc++) {
+            scanned.push_back(extract_format(scan_alv, lf, lpc));
+        }
+        for (uint64_t lpc = lf->size(); lpc > 0; lpc--) {
+            assert(scanned[lpc - 1] ==
+                   extract_format(lookup_alv, lf, lpc - 1));
+        }
+        // Reading the lines again gives the same values from the cache.
+        for (uint64_t lpc = 0; lpc < lf->size(); lpc++) {
+            assert(scanned[lpc] == extract_format(scan_alv, lf, lpc));
+        }
+
+        auto before = extract_format(scan_alv, lf, LINE_COUNT);
+
+        fprintf(file, " for bob from 10.0.0.1 port 22\n");
+        fflush(file);
+        lf->rebuild_index();
+        assert(lf->size() == LINE_COUNT + 1);
+
+        all_logs_vtab fresh_alv;
+        auto after = extract_format(scan_alv, lf, LINE_COUNT);
+
+        assert(after != before);
+        assert(after == extract_format(fresh_alv, lf, LINE_COUNT));
+    }
+
+    fclose(file);
+    remove(fn_template);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,306 @@
+/**
+ * Copyright (c) 2019, Timothy Stack
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * * Neither the name of Timothy Stack nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "arrow_writer.hh"
+
+/**
+ * Just enough of a flatbuffers reader to walk the metadata in an Arrow file.
+ */
+struct fb_table {
+    fb_table(const std::string &buf, size_t pos) : ft_buf(buf), ft_pos(pos) {
+        this->ft_vtable = pos - read<int32_t>(buf, pos);
+        this->ft_vtable_size = read<uint16_t>(buf, this->ft_vtable);
+    };
+
+    template<typename T>
+    static T read(const std::string &buf, size_t pos) {
+        T retval;
+
+        assert(pos + sizeof(T) <= buf.size());
+        memcpy(&retval, &buf[pos], sizeof(T));
+        return retval;
+    };
+
+    size_t field_pos(int index) const {
+        size_t entry = 4 + 2 * index;
+
+        if (entry >= this->ft_vtable_size) {
+            return 0;
+        }
+
+        uint16_t off = read<uint16_t>(this->ft_buf, this->ft_vtable + entry);
+
+        return off == 0 ? 0 : this->ft_pos + off;
+    };
+
+    template<typename T>
+    T scalar(int index, T def = 0) const {
+        size_t pos = this->field_pos(index);
+
+        return pos == 0 ? def : read<T>(this->ft_buf, pos);
+    };
+
+    size_t ref(int index) const {
+        size_t pos = this->field_pos(index);
+
+        assert(pos != 0);
+        return pos + read<uint32_t>(this->ft_buf, pos);
+    };
+
+    fb_table table(int index) const {
+        return fb_table(this->ft_buf, this->ref(index));
+    };
+
+    std::string str(int index) const {
+        size_t pos = this->ref(index);
+
+        return this->ft_buf.substr(pos + 4, read<uint32_t>(this->ft_buf, pos));
+    };
+
+    size_t vector_size(int index) const {
+        return read<uint32_t>(this->ft_buf, this->ref(index));
+    };
+
+    fb_table vector_table(int index, size_t elem) const {
+        size_t pos = this->ref(index) + 4 + elem * 4;
+
+        return fb_table(this->ft_buf, pos + read<uint32_t>(this->ft_buf, pos));
+    };
+
+    template<typename T>
+    T vector_struct_field(int index, size_t elem, size_t struct_size,
+                          size_t field_off) const {
+        size_t pos = this->ref(index) + 4 + elem * struct_size + field_off;
+
+        return read<T>(this->ft_buf, pos);
+    };
+
+    const std::string &ft_buf;
+    size_t ft_pos;
+    size_t ft_vtable;
+    uint16_t ft_vtable_size;
+};
+
+static fb_table root_table(const std::string &buf, size_t pos)
+{
+    return fb_table(buf, pos + fb_table::read<uint32_t>(buf, pos));
+}
+
+/** The offsets of the fields in an Arrow Block struct. */
+static const size_t BLOCK_SIZE = 24;
+static const size_t BLOCK_OFFSET = 0;
+static const size_t BLOCK_METADATA_LENGTH = 8;
+static const size_t BLOCK_BODY_LENGTH = 16;
+
+/** The values of the Arrow Type union and MessageHeader union. */
+static const uint8_t TYPE_INT = 2;
+static const uint8_t TYPE_UTF8 = 5;
+static const uint8_t HEADER_SCHEMA = 1;
+static const uint8_t HEADER_DICTIONARY_BATCH = 2;
+static const uint8_t HEADER_RECORD_BATCH = 3;
+
+struct arrow_file {
+    explicit arrow_file(std::string data) : af_data(std::move(data)) {
+        assert(this->af_data.size() >= 8 + 6 + 4);
+        assert(memcmp(this->af_data.data(), "ARROW1\0\0", 8) == 0);
+        assert(memcmp(&this->af_data[this->af_data.size() - 6],
+                      "ARROW1", 6) == 0);
+
+        int32_t footer_len = fb_table::read<int32_t>(
+            this->af_data, this->af_data.size() - 10);
+
+        assert(footer_len > 0);
+        this->af_footer_pos = this->af_data.size() - 10 - footer_len;
+        assert(this->af_footer_pos >= 8);
+    };
+
+    fb_table footer() const {
+        return root_table(this->af_data, this->af_footer_pos);
+    };
+
+    /**
+     * @return The metadata of the message that starts at the given offset.
+     */
+    fb_table message(size_t offset) const {
+        assert(offset % 8 == 0);
+        assert(fb_table::read<uint32_t>(this->af_data, offset) == 0xffffffff);
+        return root_table(this->af_data, offset + 8);
+    };
+
+    std::string af_data;
+    size_t af_footer_pos;
+};
+
+static std::string write_file(size_t rows)
+{
+    std::string retval;
+    arrow_writer aw([&retval](const char *data, size_t len) {
+        retval.append(data, len);
+    });
+    char name[32];
+
+    aw.add_column("id", arrow_writer::ACT_INT64);
+    aw.add_column("name", arrow_writer::ACT_UTF8);
+    aw.add_column("level", arrow_writer::ACT_LEVEL);
+    for (size_t lpc = 0; lpc < rows; lpc++) {
+        aw.append_int64(0, lpc);
+        if (lpc % 3 == 0) {
+            aw.append_null(1);
+        } else {
+            snprintf(name, sizeof(name), "row%zu", lpc);
+            aw.append_string(1, name, strlen(name));
+        }
+        aw.append_level(2, lpc % 2 ? LEVEL_ERROR : LEVEL_INFO);
+        aw.end_row();
+    }
+    aw.finish();
+
+    assert(aw.get_row_count() == rows);
+
+    return retval;
+}
+
+static void check_schema(const fb_table &schema)
+{
+    assert(schema.vector_size(1) == 3);
+
+    fb_table id = schema.vector_table(1, 0);
+    fb_table name = schema.vector_table(1, 1);
+    fb_table level = schema.vector_table(1, 2);
+
+    assert(id.str(0) == "id");
+    assert(id.scalar<uint8_t>(2) == TYPE_INT);
+    assert(id.table(3).scalar<int32_t>(0) == 64);
+    assert(name.str(0) == "name");
+    assert(name.scalar<uint8_t>(2) == TYPE_UTF8);
+    assert(level.str(0) == "level");
+    assert(level.scalar<uint8_t>(2) == TYPE_UTF8);
+    // The level column is dictionary-encoded.
+    assert(level.field_pos(4) != 0);
+}
+
+/**
+ * Check the file and return the number of rows in each record batch.
+ */
+static std::vector<int64_t> check_file(const arrow_file &af)
+{
+    fb_table footer = af.footer();
+    std::vector<int64_t> retval;
+
+    check_schema(footer.table(1));
+    assert(af.message(8).scalar<uint8_t>(1) == HEADER_SCHEMA);
+    check_schema(af.message(8).table(2));
+
+    for (size_t lpc = 0; lpc < footer.vector_size(2); lpc++) {
+        int64_t off = footer.vector_struct_field<int64_t>(
+            2, lpc, BLOCK_SIZE, BLOCK_OFFSET);
+
+        assert(af.message(off).scalar<uint8_t>(1) == HEADER_DICTIONARY_BATCH);
+    }
+
+    for (size_t lpc = 0; lpc < footer.vector_size(3); lpc++) {
+        int64_t off = footer.vector_struct_field<int64_t>(
+            3, lpc, BLOCK_SIZE, BLOCK_OFFSET);
+        int32_t meta_len = footer.vector_struct_field<int32_t>(
+            3, lpc, BLOCK_SIZE, BLOCK_METADATA_LENGTH);
+        int64_t body_len = footer.vector_struct_field<int64_t>(
+            3, lpc, BLOCK_SIZE, BLOCK_BODY_LENGTH);
+        fb_table msg = af.message(off);
+
+        assert(msg.scalar<uint8_t>(1) == HEADER_RECORD_BATCH);
+        assert(msg.scalar<int64_t>(3) == body_len);
+        assert((size_t) (off + meta_len + body_len) <= af.af_footer_pos);
+
+        fb_table batch = msg.table(2);
+        int64_t length = batch.scalar<int64_t>(0);
+
+        assert(batch.vector_size(1) == 3);
+        for (size_t col = 0; col < 3; col++) {
+            assert(batch.vector_struct_field<int64_t>(1, col, 16, 0) == length);
+        }
+
+        // The first value in the "id" column is the number of rows before
+        // this batch.
+        int64_t id_off = batch.vector_struct_field<int64_t>(2, 1, 16, 0);
+        int64_t first_id = fb_table::read<int64_t>(
+            af.af_data, off + meta_len + id_off);
+        int64_t rows_before = 0;
+
+        for (auto count : retval) {
+            rows_before += count;
+        }
+        assert(first_id == rows_before);
+
+        retval.push_back(length);
+    }
+
+    return retval;
+}
+
+int main(int argc, char *argv[])
+{
+    {
+        arrow_file af(write_file(0));
+        auto batches = check_file(af);
+
+        assert(batches.empty());
+    }
+
+    {
+        arrow_file af(write_file(10));
+        auto batches = check_file(af);
+
+        assert(batches.size() == 1);
+        assert(batches[0] == 10);
+    }
+
+    {
+        size_t rows = arrow_writer::BATCH_ROWS * 2 + 10;
+        arrow_file af(write_file(rows));
+        auto batches = check_file(af);
+
+        assert(batches.size() == 3);
+        assert(batches[0] == (int64_t) arrow_writer::BATCH_ROWS);
+        assert(batches[1] == (int64_t) arrow_writer::BATCH_ROWS);
+        assert(batches[2] == 10);
+    }
+
+    return EXIT_SUCCESS;
+}
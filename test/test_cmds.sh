@@ -580,6 +580,82 @@ check_output "write-json-to is not working" <<EOF
 EOF
 
 
+run_test ${lnav_test} -n \
+    -c ":export-csv-to - SELECT c_ip, sc_bytes, cs_uri_query FROM access_log WHERE log_line < 2" \
+    ${test_dir}/logfile_access_log.0
+
+check_output "export-csv-to is not working" <<EOF
+c_ip,sc_bytes,cs_uri_query
+192.168.202.254,134,<NULL>
+192.168.202.254,46210,<NULL>
+EOF
+
+run_test ${lnav_test} -n \
+    -c ":export-json-to export-test.json.gz SELECT c_ip, sc_bytes FROM access_log WHERE log_line = 0" \
+    ${test_dir}/logfile_access_log.0
+
+check_output "export-json-to wrote to stdout" <<EOF
+EOF
+
+run_test gzip -dc export-test.json.gz
+
+check_output "export-json-to is not working" <<EOF
+[
+    {
+        "c_ip": "192.168.202.254",
+        "sc_bytes": 134
+    }
+]
+EOF
+
+run_test ${lnav_test} -n \
+    -c ":export-arrow-to export-test.arrow SELECT log_time, log_level, sc_bytes FROM access_log" \
+    ${test_dir}/logfile_access_log.0
+
+check_output "export-arrow-to wrote to stdout" <<EOF
+EOF
+
+run_test od -A n -c -N 8 export-test.arrow
+
+check_output "export-arrow-to did not write an Arrow file" <<EOF
+   A   R   R   O   W   1  \0  \0
+EOF
+
+run_test eval "tail -c 6 export-test.arrow | od -A n -c"
+
+check_output "export-arrow-to did not write the file footer" <<EOF
+   A   R   R   O   W   1
+EOF
+
+run_test ${lnav_test} -n \
+    -c ":export-arrow-to export-test.arrow SELECT log_time, log_level, sc_bytes FROM access_log WHERE 0" \
+    ${test_dir}/logfile_access_log.0
+
+check_output "export-arrow-to failed for an empty result" <<EOF
+EOF
+
+run_test eval "tail -c 6 export-test.arrow | od -A n -c"
+
+check_output "export-arrow-to did not finish the file for an empty result" <<EOF
+   A   R   R   O   W   1
+EOF
+
+run_test ${lnav_test} -n \
+    -c ":export-arrow-to export-test.arrow SELECT 1 AS v UNION ALL SELECT 'abc'" \
+    ${test_dir}/logfile_access_log.0
+
+check_error_output "export-arrow-to dropped a value that did not fit the column" <<EOF
+error: a value in column 'v' cannot be exported as int64, the column type comes from the declared type or the first row
+EOF
+
+run_test ${lnav_test} -n \
+    -c ":export-arrow-to export-test.arrow.gz SELECT log_time FROM access_log" \
+    ${test_dir}/logfile_access_log.0
+
+check_error_output "export-arrow-to compressed an Arrow file" <<EOF
+error: Arrow files cannot be compressed with gzip -- export-test.arrow.gz
+EOF
+
 # By setting the LNAVSECURE mode before executing the command, we will disable
 # the access to the write-json-to command and the output would just be the
 # actual display of select query rather than json output.
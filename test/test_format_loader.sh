@@ -21,6 +21,7 @@ warning:    foreign-key <bool> -- Indicates whether or not this field should be
 warning:    hidden <bool> -- Indicates whether or not this field should be hidden
 warning:    action-list# <string> -- Actions to execute when this field is clicked on
 warning:    rewriter <command> -- A command that will rewrite this field when pretty-printing
+warning:    pure-rewriter <bool> -- Indicates whether or not the result of the rewriter only depends on the values in the line, so it can be cached
 warning:    description <string> -- A description of the field
 error:format.json:4:invalid json -- parse error: object key and value must be separated by a colon (':')
           ar_log": {         "abc"     } }
@@ -34,6 +34,8 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <string>
+
 #include "auto_fd.hh"
 #include "line_buffer.hh"
 
@@ -79,7 +81,7 @@ int main(int argc, char *argv[])
         auto lb = line_buffer();
 
         write(fd, TEST_DATA, strlen(TEST_DATA));
-        lseek(fd, SEEK_SET, 0);
+        lseek(fd, 0, SEEK_SET);
 
         lb.set_fd(fd);
 
@@ -90,5 +92,38 @@ int main(int argc, char *argv[])
         assert(result.isErr());
     }
 
+    {
+        char fn_template[] = "test_line_buffer.XXXXXX";
+
+        auto fd = auto_fd(mkstemp(fn_template));
+        remove(fn_template);
+        auto lb = line_buffer();
+        std::string big_data(4 * 1024 * 1024, 'a');
+
+        memcpy(&big_data[0], "first", 5);
+        memcpy(&big_data[big_data.size() - 4], "last", 4);
+        write(fd, big_data.c_str(), big_data.size());
+        lseek(fd, 0, SEEK_SET);
+
+        lb.set_fd(fd);
+
+        auto first_sbr = lb.read_range({0, 5}).unwrap();
+        const char *first_data = first_sbr.get_data();
+        auto last_sbr = lb.read_range({(off_t) big_data.size() - 4, 4}).unwrap();
+
+        // Moving the window must not copy or change the data of older refs.
+        assert(first_sbr.get_data() == first_data);
+        assert(strncmp(first_sbr.get_data(), "first", 5) == 0);
+        assert(strncmp(last_sbr.get_data(), "last", 4) == 0);
+
+        // The buffer has to grow again after compacting around live refs.
+        auto mid_sbr = lb.read_range({1024 * 1024, 2 * 1024 * 1024}).unwrap();
+
+        assert(mid_sbr.length() == 2 * 1024 * 1024);
+        assert(mid_sbr.get_data()[0] == 'a');
+        assert(mid_sbr.get_data()[mid_sbr.length() - 1] == 'a');
+        assert(strncmp(first_sbr.get_data(), "first", 5) == 0);
+    }
+
     return retval;
 }
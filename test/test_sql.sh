@@ -270,6 +270,31 @@ log_time,log_actual_time
 2015-09-13 03:46:03.000,2015-09-13 03:46:03.000
 EOF
 
+run_test ${lnav_test} -n \
+    -c ";select log_line, log_time, log_time_usecs from syslog_log where log_time_usecs >= 1442113924000000 and log_time_usecs < 1442115963000000" \
+    -c ':write-csv-to -' \
+    logfile_syslog_with_mixed_times.0
+
+check_output "log_time_usecs constraints are not working" <<EOF
+log_line,log_time,log_time_usecs
+3,2015-09-13 03:12:04.000,1442113924000000
+4,2015-09-13 03:12:04.000,1442113924000000
+5,2015-09-13 03:12:04.000,1442113924000000
+6,2015-09-13 03:12:04.000,1442113924000000
+7,2015-09-13 03:12:58.000,1442113978000000
+EOF
+
+run_test ${lnav_test} -n \
+    -c ";select log_line, strftime('%H:%M', log_time_usecs / 1000000, 'unixepoch') as hm from syslog_log where log_line < 2" \
+    -c ':write-csv-to -' \
+    logfile_syslog_with_mixed_times.0
+
+check_output "strftime() does not work with log_time_usecs" <<EOF
+log_line,hm
+0,00:58
+1,00:59
+EOF
+
 
 run_test ${lnav_test} -n \
     -c ";update access_log set log_part = 'middle' where log_line = 1" \
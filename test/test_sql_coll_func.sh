@@ -99,3 +99,34 @@ check_output "" <<EOF
 Row 0:
   Column 'info' collate loglevel between 'trace' and 'fatal': 1
 EOF
+
+run_test ./drive_sql "select hex(ipaddress_key('192.168.1.10'))"
+
+check_output "" <<EOF
+Row 0:
+  Column hex(ipaddress_key('192.168.1.10')): 01C0A8010A
+EOF
+
+run_test ./drive_sql "select column1 from (values ('::1'), ('192.168.1.10'), ('foo'), ('::ffff:192.168.1.2')) order by ipaddress_key(column1)"
+
+check_output "" <<EOF
+Row 0:
+  Column    column1: foo
+Row 1:
+  Column    column1: ::ffff:192.168.1.2
+Row 2:
+  Column    column1: 192.168.1.10
+Row 3:
+  Column    column1: ::1
+EOF
+
+run_test ./drive_sql "select column1 from (values ('foo10'), ('foo2'), ('Foo1')) order by naturalnocase_key(column1)"
+
+check_output "" <<EOF
+Row 0:
+  Column    column1: Foo1
+Row 1:
+  Column    column1: foo2
+Row 2:
+  Column    column1: foo10
+EOF
@@ -116,6 +116,18 @@ Row 0:
   Column jget('[null, true, 20, 30, 40]', '/0/foo'): (null)
 EOF
 
+run_test ./drive_sql "select jget(j, '/a'), jget(j, '/b'), jget(j, '/b/1') from (select '{\"a\": \"Hello\", \"b\": [1, {\"c\": 2.5}]}' as j)"
+
+check_error_output "" <<EOF
+EOF
+
+check_output "jget from a shared document does not work" <<EOF
+Row 0:
+  Column jget(j, '/a'): Hello
+  Column jget(j, '/b'): [1,{"c":2.5}]
+  Column jget(j, '/b/1'): {"c":2.5}
+EOF
+
 
 run_test ./drive_sql "select json_group_object(key) from (select 1 as key)"
 
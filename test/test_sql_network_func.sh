@@ -0,0 +1,40 @@
+#! /bin/bash
+
+cat > test_sql_network_func.hosts <<EOF
+# Stand-in for the system resolver
+127.0.0.1 localhost
+10.0.0.1  gw.example.com gw
+fd00::1   six.example.com
+EOF
+
+run_test ./drive_sql -H test_sql_network_func.hosts "select gethostbyname('gw')"
+
+check_output "gethostbyname() does not use the hosts file" <<EOF
+Row 0:
+  Column gethostbyname('gw'): 10.0.0.1
+EOF
+
+run_test ./drive_sql -H test_sql_network_func.hosts "select gethostbyaddr('fd00::1')"
+
+check_output "gethostbyaddr() does not use the hosts file" <<EOF
+Row 0:
+  Column gethostbyaddr('fd00::1'): six.example.com
+EOF
+
+run_test ./drive_sql -H test_sql_network_func.hosts "select gethostbyaddr('10.0.0.2')"
+
+check_output "gethostbyaddr() does not return the address when not found" <<EOF
+Row 0:
+  Column gethostbyaddr('10.0.0.2'): 10.0.0.2
+EOF
+
+run_test ./drive_sql -H test_sql_network_func.hosts "select gethostbyaddr(column1), count(*) from (values ('10.0.0.1'), ('127.0.0.1'), ('10.0.0.1')) group by 1"
+
+check_output "repeated gethostbyaddr() results are wrong" <<EOF
+Row 0:
+  Column gethostbyaddr(column1): gw.example.com
+  Column   count(*): 2
+Row 1:
+  Column gethostbyaddr(column1): localhost
+  Column   count(*): 1
+EOF
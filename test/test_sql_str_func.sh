@@ -77,6 +77,26 @@ Row 0:
   Column regexp_replace('test 1 2 3', '\d+', 'N'): test N N N
 EOF
 
+run_test ./drive_sql "select regexp_replace('123 abc', '(\\w+)', '<\\1>')"
+
+check_output "" <<EOF
+Row 0:
+  Column regexp_replace('123 abc', '(\w+)', '<\1>'): <123> <abc>
+EOF
+
+run_test ./drive_sql "select regexp_replace('abc', 'x*', '-')"
+
+check_output "" <<EOF
+Row 0:
+  Column regexp_replace('abc', 'x*', '-'): -a-b-c-
+EOF
+
+run_test ./drive_sql "select regexp_replace('abc', '(', '-')"
+
+check_error_output "" <<EOF
+error: sqlite3_exec failed -- (: missing )
+EOF
+
 
 run_test ./drive_sql "select regexp_match('abc', 'abc')"
 
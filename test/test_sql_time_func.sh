@@ -75,3 +75,17 @@ check_output "timeslice day" <<EOF
 Row 0:
   Column timediff('foo', 'yesterday'): (null)
 EOF
+
+run_test ./drive_sql "select timeslice(1438948860000000, '5m')"
+
+check_output "timeslice usecs" <<EOF
+Row 0:
+  Column timeslice(1438948860000000, '5m'): 2015-08-07 12:00:00.000
+EOF
+
+run_test ./drive_sql "select timediff(1438948860100000, '2015-08-07 12:01:00')"
+
+check_output "timediff usecs" <<EOF
+Row 0:
+  Column timediff(1438948860100000, '2015-08-07 12:01:00'): 0.1
+EOF